@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Culling.h"
+
+// Bounding volume hierarchy over a list of boxes (one per scene object). Built top down with binned SAH, nodes are
+// stored depth first in one array so that every child comes after its parent. When objects move, refit() updates the
+// node bounds in place without changing the tree; rebuild once the boxes moved far enough for queries to slow down.
+class BVH {
+public:
+	static constexpr int SAH_BINS = 16;
+	static constexpr uint32_t MAX_LEAF_SIZE = 4;
+
+	void build(const std::vector<Culling::AABB>& boxes);
+
+	// boxes must hold as many entries, in the same order, as the ones the tree was built from
+	void refit(const std::vector<Culling::AABB>& boxes);
+
+	// appends the indices of all boxes touching the frustum
+	void queryFrustum(const Culling::Frustum& frustum, std::vector<uint32_t>& result) const;
+
+	// appends the indices of all boxes overlapping range / the sphere
+	void queryRange(const Culling::AABB& range, std::vector<uint32_t>& result) const;
+	void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result) const;
+
+	// index of the box the ray hits first, -1 if none within maxDistance. distance is set to the hit distance
+	int raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance, float maxDistance = 1e30f) const;
+
+	size_t nodeCount() const { return nodes.size(); }
+	size_t size() const { return boxes.size(); }
+
+private:
+	struct Node {
+		Culling::AABB bounds;
+		uint32_t first;   // leaf: first entry in indices. inner node: index of the left child (right is stored after it)
+		uint32_t count;   // 0 for inner nodes
+	};
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> indices;       // box indices, leaves reference ranges of this
+	std::vector<Culling::AABB> boxes;    // copy of the boxes the tree was built or refit with
+	std::vector<glm::vec3> centroids;
+
+	void subdivide(uint32_t nodeIndex);
+	void updateBounds(uint32_t nodeIndex);
+	void appendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& result) const;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+// Headless benchmarks, run from the command line before any window or GL context exists. They print their results
+// to stdout and return the process exit code.
+namespace Benchmarks {
+	// build, refit and query throughput of the BVH over count random boxes  (--bench-bvh [count])
+	int bvh(int count);
+
+	// recomposing count transforms: the old per draw Euler path against TransformSystem  (--bench-transforms [count])
+	int transforms(int count);
+
+	// per frame sorting of count transparent draws with a moving camera: std::sort over SceneObjects against
+	// DepthSort's radix and coherent sorts  (--bench-transparent-sort [count])
+	int transparentSort(int count);
+
+	// CPU light assignment of clustered lighting for count point lights, and a check that every point of the frustum
+	// gets all the lights reaching it from its cluster's list  (--bench-clusters [count])
+	int clusters(int count);
+
+	// cascade fitting for a camera walking and turning through the scene for the given number of frames: how often
+	// each cascade moves (and its static shadow cache is redrawn), and a check that every cascade always holds its
+	// part of the frustum  (--bench-shadows [frames])
+	int shadows(int frames);
+}
@@ -4,6 +4,24 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Culling.h"
+
+// everything derived from the camera for one frame. computed once per frame by Camera::getFrame, draw paths take this
+// instead of the camera so nothing recomputes matrices per object
+struct CameraFrame {
+    glm::vec3 position;
+    glm::vec3 front;
+
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::mat4 inverseView;
+    glm::mat4 inverseProjection;
+    glm::mat4 inverseViewProjection;
+
+    Culling::Frustum frustum;
+};
+
 class Camera {
 public:
     // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
@@ -35,7 +53,10 @@ public:
     Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 worldUp = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = -90.0f, float pitch = 0.0f);
     
     // returns the view matrix calculated using Euler Angles and the LookAt Matrix
-    glm::mat4 getViewMatrix();
+    glm::mat4 getViewMatrix() const;
+
+    // snapshot of the camera with a perspective projection of the current zoom
+    CameraFrame getFrame(float aspectRatio, float nearPlane, float farPlane) const;
 
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void processKeyboard(Camera_Movement direction, float deltaTime);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Camera.h"
+#include "Culling.h"
+#include "SceneObject.h"
+#include "Shader.h"
+#include "ShadowCascades.h"
+
+// Cascaded shadow maps of the scene's directional light (the first one in LightManager), sampled by lighting.glsl
+// through shadows.glsl. The cascades are fitted by ShadowCascades and only move when the camera has gone far enough,
+// so the depth of the static casters is rendered once into a cache layer per cascade and reused until its cascade
+// moves, the light turns or the static casters change. Every frame a cascade's shadow map starts as a copy of its
+// cache and only the dynamic casters are drawn on top, so the cost of the static world is paid on cache misses only.
+class CascadedShadows {
+public:
+	static constexpr int SIZE = 2048; // of every cascade's shadow map
+	static constexpr GLenum FORMAT = GL_DEPTH_COMPONENT32F;
+	static constexpr GLuint TEXTURE_UNIT = 16; // past MaterialTable's arrays
+
+	struct Stats {
+		int staticRenders = 0; // cascades whose cache was redrawn last frame
+		int staticDraws = 0; // draws into the caches last frame
+		int dynamicDraws = 0;
+		int copies = 0; // caches copied into a shadow map
+		int totalStaticRenders = 0; // since the start
+	};
+
+	// the cascades split the camera's view depths [nearPlane, shadowDistance]
+	CascadedShadows(float nearPlane, float shadowDistance);
+	~CascadedShadows();
+	CascadedShadows(const CascadedShadows&) = delete;
+	CascadedShadows& operator=(const CascadedShadows&) = delete;
+
+	// objects that never move, drawn into the caches. setting them again redraws every cache
+	void setStaticCasters(const std::vector<SceneObject*>& casters);
+	// objects drawn into the shadow maps every frame, their transforms have to be up to date when render() runs
+	void setDynamicCasters(const std::vector<SceneObject*>& casters);
+	// the static casters moved or changed, the next render() redraws every cache
+	void invalidate();
+
+	// fits the cascades to the frame, direction is the light's in world space
+	void update(const CameraFrame& frame, const glm::vec3& lightDirection);
+
+	// draws the frame's shadow maps with depthShader (shadowDepthVS.glsl), viewport and framebuffer are left changed
+	void render(Shader& depthShader);
+
+	// the cascades and shadow map for the lit shaders, enabled = false leaves everything lit
+	void setUniforms(Shader& shader, const CameraFrame& frame, bool enabled) const;
+
+	const ShadowCascades::Cascade& getCascade(int index) const { return cascades[index]; }
+	const Stats& getStats() const { return stats; }
+
+private:
+	float nearPlane, shadowDistance;
+	GLuint shadowMap = 0; // a layer per cascade, sampled with depth compare
+	GLuint staticCache = 0; // the static casters' depth of every cascade
+	GLuint framebuffer = 0; // depth attachment set to the layer being drawn
+
+	glm::vec3 lightDirection = glm::vec3(0.0f);
+	ShadowCascades::Cascade cascades[ShadowCascades::COUNT];
+	ShadowCascades::Cascade cachedCascades[ShadowCascades::COUNT]; // the cascades the caches were drawn for
+	bool cacheValid[ShadowCascades::COUNT] = {};
+	bool staticOnly[ShadowCascades::COUNT] = {}; // the shadow map holds exactly its cache, no dynamic caster
+
+	std::vector<SceneObject*> staticCasters, dynamicCasters;
+	Culling::BoxList staticBoxes, dynamicBoxes;
+	std::vector<uint8_t> visible;
+	Stats stats;
+
+	// points the framebuffer at a layer of texture
+	void attach(GLuint texture, int layer);
+	// marks the boxes touching the cascade (or between it and the light) in visible, returns their number
+	size_t cull(const ShadowCascades::Cascade& cascade, const Culling::BoxList& boxes);
+	// draws the casters marked in visible, returns the number drawn
+	int drawVisible(Shader& depthShader, const std::vector<SceneObject*>& casters);
+};
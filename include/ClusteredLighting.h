@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Camera.h"
+#include "Clusters.h"
+#include "Shader.h"
+
+// Clustered forward lighting on the GPU. The point lights live in LightManager's SSBO; every frame a compute pass
+// (shaders/assignLightsCS.glsl) lists the lights reaching each cluster of the view frustum (see Clusters.h), and
+// fragment shaders including clusters.glsl only loop over the list of the cluster they fall into, so the cost of a
+// fragment follows the lights near it instead of all lights in the scene. The lists share one index buffer of
+// Clusters::MAX_CLUSTER_LIGHTS entries, each cluster takes as much of it as its lights need.
+// The list buffers stay bound to their bindings after assign(), shaders read them from then on.
+class ClusteredLighting {
+public:
+	static constexpr GLuint RANGE_BINDING = 8; // must match clusters.glsl
+	static constexpr GLuint INDEX_BINDING = 9;
+	static constexpr GLuint WORKGROUP_SIZE = 128; // must match assignLightsCS.glsl
+
+	ClusteredLighting(float nearPlane, float farPlane);
+	~ClusteredLighting();
+	ClusteredLighting(const ClusteredLighting&) = delete;
+	ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+	// the depth range the slices cover, has to be the projection's
+	void setUniforms(Shader& shader) const;
+
+	// builds the frame's cluster lists from the point lights bound by LightManager::upload()
+	void assign(Shader& assignShader, const CameraFrame& frame);
+
+	// reads the lists of the last assign() back (stalls) and compares them with Clusters::assignLights for the same
+	// frame and lights. returns the number of clusters whose lists differ
+	int verify(const CameraFrame& frame, const std::vector<Clusters::PointLight>& lights);
+
+	// counts of an assign() a few frames ago, read back behind a fence like GPUCulling's so this never stalls
+	struct Counts {
+		GLuint listed = 0;     // light indices the clusters asked for, past MAX_CLUSTER_LIGHTS if it ran out
+		GLuint overflowed = 0; // clusters cut short, their fragments miss some of the lights reaching them
+	};
+	Counts listCounts();
+
+private:
+	float nearPlane, farPlane;
+	GLuint rangeBuffer = 0;
+	GLuint indexBuffer = 0; // Counts, then the lists
+	GLuint readbackBuffer = 0;
+	GLsync readbackFence = nullptr;
+	Counts lastCounts;
+};
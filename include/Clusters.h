@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Culling.h"
+
+// Clustered forward lighting, the part that doesn't need GL. The view frustum is split into a grid of clusters
+// (froxels): screen tiles in x and y, depth slices growing exponentially from the near to the far plane in z. Every
+// cluster gets the list of point lights whose sphere of influence touches it, and a fragment only shades with the
+// lights of the cluster it falls into.
+// assignLights is the CPU reference of the GPU pass (shaders/assignLightsCS.glsl, see ClusteredLighting.h): both
+// produce the same lists, so the GPU result can be checked and the assignment tested without a GL context.
+namespace Clusters {
+	// must match shaders/clusters.glsl
+	const int GRID_X = 16, GRID_Y = 9, GRID_Z = 24;
+	const int COUNT = GRID_X * GRID_Y * GRID_Z;
+	// light indices of all clusters together, the lists are packed one after the other. 4096 of the demo's lights
+	// around the backpack need about 760k seen from inside the crowd; clusters past it are cut short and counted
+	const int MAX_CLUSTER_LIGHTS = 1 << 20;
+
+	// std430 layout of clusters.glsl's PointLight, position in world space
+	struct PointLight {
+		glm::vec3 position = glm::vec3(0.0f);
+		float radius = 0.0f;
+		glm::vec3 ambient = glm::vec3(0.0f);
+		float constant = 1.0f;
+		glm::vec3 diffuse = glm::vec3(0.0f);
+		float linear = 0.0f;
+		glm::vec3 specular = glm::vec3(0.0f);
+		float quadratic = 0.0f;
+	};
+
+	// distance at which the light's brightest channel, attenuated by 1 / (constant + linear d + quadratic d^2), falls
+	// below threshold. the shader fades the light out towards it
+	float lightRadius(const PointLight& light, float threshold = 1.0f / 64.0f);
+
+	inline int index(int x, int y, int z) { return x + GRID_X * (y + GRID_Y * z); }
+
+	// depth slice of a view space distance in front of the camera
+	int slice(float viewDepth, float nearPlane, float farPlane);
+
+	// cluster a view space position in front of the camera falls into, like clusterAt in clusters.glsl
+	int at(const glm::vec3& viewPosition, const glm::mat4& projection, float nearPlane, float farPlane);
+
+	// view space box around the cluster
+	Culling::AABB bounds(int x, int y, int z, const glm::mat4& inverseProjection, float nearPlane, float farPlane);
+
+	// ranges[c] is where the list of cluster c starts in indices and how many lights it has, in ascending order. returns
+	// the number of clusters cut short because the lists ran past MAX_CLUSTER_LIGHTS
+	int assignLights(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& inverseProjection,
+		float nearPlane, float farPlane, std::vector<glm::uvec2>& ranges, std::vector<uint32_t>& indices);
+}
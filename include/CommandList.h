@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "Shader.h"
+#include "Mesh.h"
+#include "SceneObject.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Draws recorded as plain data (which program, material, vertex array, per object uniforms and mesh) so they can be
+// built on any thread and submitted on the GL thread later. A list holds the state changes each draw needs relative to
+// the draw recorded before it, so a list recorded for a slice of a sorted draw order is only correct when replayed
+// right after the list of the slice before it: Replayer puts the lists back into that order by their first draw's key.
+class CommandList {
+public:
+	enum Type : uint8_t { BIND_PROGRAM, BIND_MATERIAL, BIND_VERTEX_ARRAY, OBJECT_UNIFORMS, DRAW };
+
+	struct Counts {
+		int draws = 0;
+		int programs = 0;
+		int materials = 0;
+		int vertexArrays = 0;
+		int uniforms = 0;
+	};
+
+	void clear();
+
+	void bindProgram(Shader& shader);
+	// the bound program's material state for the mesh (textures and samplers, or its material table index)
+	void bindMaterial(const Mesh& mesh);
+	void bindVertexArray(GLuint vao);
+	void setObjectUniforms(const SceneObject::Uniforms& uniforms);
+	// key is the draw's sort key, the list's key is its first draw's
+	void draw(uint64_t key, const Mesh& mesh);
+
+	uint64_t getKey() const { return key; }
+	size_t getPacketCount() const { return packets.size(); }
+	const Counts& getCounts() const { return counts; }
+
+	// submits lists on the GL thread, remembering the uniform locations of every program it has seen
+	class Replayer {
+	public:
+		// in the order of the lists' keys, lists without draws are skipped
+		void replay(std::vector<const CommandList*> lists);
+
+	private:
+		struct Locations {
+			GLint model, normalMat, lightColor;
+		};
+		std::unordered_map<GLuint, Locations> locations;
+		Shader* program = nullptr;
+		const Locations* programLocations = nullptr;
+
+		void replay(const CommandList& list);
+	};
+
+private:
+	struct Packet {
+		Type type;
+		uint32_t index; // into the array for the type, the vertex array itself for BIND_VERTEX_ARRAY
+	};
+
+	std::vector<Packet> packets;
+	std::vector<Shader*> programs;
+	std::vector<const Mesh*> meshes; // of BIND_MATERIAL and DRAW
+	std::vector<SceneObject::Uniforms> uniforms;
+	uint64_t key = 0;
+	Counts counts;
+};
@@ -10,7 +10,11 @@
 class Cubemap {
 public:
 	Cubemap(std::vector<float> vertices, GLuint texture);
-	void draw(Shader& shader, Camera& camera);
+	// background first: the cube around the camera without depth writes, shades every pixel
+	void draw(Shader& shader, const CameraFrame& frame);
+	// background last: a fullscreen triangle on the far plane (skyboxTriangleVS.glsl) tested GL_LEQUAL against the
+	// scene's depth, shades only the pixels the scene left empty
+	void drawBehindScene(Shader& shader, const CameraFrame& frame);
 
 	void setTexture(GLuint texture);
 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// View frustum culling of axis aligned bounding boxes. Boxes are kept as separate center/extent arrays so the test
+// runs on 8 boxes at once with AVX (when compiled with it), 4 with SSE, and one at a time everywhere else.
+namespace Culling {
+	struct AABB {
+		glm::vec3 min = glm::vec3(0.0f);
+		glm::vec3 max = glm::vec3(0.0f);
+
+		glm::vec3 center() const { return (min + max) * 0.5f; }
+		glm::vec3 extent() const { return (max - min) * 0.5f; }
+	};
+
+	// planes point inwards: a point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+	struct Frustum {
+		enum { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, NUM_PLANES };
+		glm::vec4 planes[NUM_PLANES];
+	};
+
+	// Gribb/Hartmann plane extraction from a (projection * view) matrix, planes are normalized
+	Frustum extractFrustum(const glm::mat4& viewProjection);
+
+	// box enclosing the given box after transforming it (Arvo's method)
+	AABB transformAABB(const AABB& box, const glm::mat4& transform);
+	AABB merge(const AABB& a, const AABB& b);
+
+	// boxes to test, stored structure of arrays
+	class BoxList {
+	public:
+		void clear();
+		void add(const AABB& box);
+		// resize, then set every box (from any thread, one box per index)
+		void resize(size_t count);
+		void set(size_t index, const AABB& box);
+		size_t size() const { return centerX.size(); }
+
+	private:
+		friend size_t cullBoxRange(const Frustum& frustum, const BoxList& boxes, std::vector<uint8_t>& visible, size_t first, size_t last);
+		std::vector<float> centerX, centerY, centerZ;
+		std::vector<float> extentX, extentY, extentZ;
+	};
+
+	// sets visible[i] to 1 for every box touching the frustum and 0 for the rest, returns the number of visible boxes.
+	// conservative: boxes crossing a frustum corner outside of it may still count as visible
+	size_t cullBoxes(const Frustum& frustum, const BoxList& boxes, std::vector<uint8_t>& visible);
+	// the same spread over the job system's workers
+	size_t cullBoxes(const Frustum& frustum, const BoxList& boxes, std::vector<uint8_t>& visible, JobSystem& jobs);
+	// boxes [first, last) only, visible has to hold boxes.size() entries already. first has to be a multiple of 8
+	size_t cullBoxRange(const Frustum& frustum, const BoxList& boxes, std::vector<uint8_t>& visible, size_t first, size_t last);
+
+	// name of the code path cullBoxes takes ("AVX", "SSE" or "scalar")
+	const char* simdPath();
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "Shader.h"
+
+// Deferred shading of the lit opaque geometry. Instead of lighting every fragment it draws (objectFS), the geometry
+// pass (gbufferFS.glsl) only writes the surface: albedo and specular intensity (RGBA8) and the view space normal,
+// octahedral encoded (RG16), with the position reconstructed from the depth buffer later. light() then shades each
+// pixel once, so the lighting cost follows the screen's pixels rather than how many surfaces were drawn over them.
+// The targets are the render graph's transient textures, in these formats. 8 bytes per pixel plus depth.
+class DeferredShading {
+public:
+	static constexpr GLenum ALBEDO_SPECULAR_FORMAT = GL_RGBA8;
+	static constexpr GLenum NORMAL_FORMAT = GL_RG16;
+
+	DeferredShading();
+	~DeferredShading();
+	DeferredShading(const DeferredShading&) = delete;
+	DeferredShading& operator=(const DeferredShading&) = delete;
+
+	// clears framebuffer's G-buffer (albedo/specular on color attachment 0, normals on 1, depth stencil), draw the
+	// geometry with a gbufferFS shader afterwards
+	void begin(GLuint framebuffer);
+
+	// shades the G-buffer's pixels into the bound framebuffer from a fullscreen triangle (fullscreenTriangleVS.glsl).
+	// pixels nothing was drawn to are discarded. region is the rendered part of the targets (dynamic resolution)
+	void light(Shader& lightingShader, GLuint albedoSpecular, GLuint normals, GLuint depth, const CameraFrame& frame, glm::ivec2 region);
+
+private:
+	GLuint emptyVAO = 0;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sorting of (depth key, index) pairs, for draws that have to go in depth order (transparents). The pairs are 8 bytes,
+// whatever they refer to stays where it is.
+namespace DepthSort {
+	struct Entry {
+		uint32_t key;
+		uint32_t index;
+	};
+
+	// key that sorts ascending from far to near, distance clamped to [0, farDepth]
+	uint32_t farToNearKey(float distance, float farDepth);
+
+	// stable LSD radix sort, 8 bits per pass, passes where every key has the same byte are skipped
+	void radixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch);
+
+	// stable insertion sort that gives up after maxMoves element moves, returns false if it did (entries are then
+	// only partially sorted)
+	bool insertionSort(std::vector<Entry>& entries, size_t maxMoves);
+
+	// insertion sort when entries are almost in order already (last frame's order with the camera moved a little),
+	// radix sort otherwise. returns true if insertion sort was enough
+	bool sortCoherent(std::vector<Entry>& entries, std::vector<Entry>& scratch);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Dynamic resolution: the scene is rendered into the bottom left width * scale x height * scale of its (full size)
+// targets, and the scale follows the GPU time of the frame towards a budget. The GPU time is measured with a pair of
+// timestamps per frame (glQueryCounter, so it doesn't collide with GL_TIME_ELAPSED queries in between) read back a few
+// frames late. A smoothed time drives the scale: pixel count is roughly what the cost follows, so the area is scaled
+// by budget / time, limited per frame and ignored inside a small dead band so it doesn't hunt.
+class DynamicResolution {
+public:
+	DynamicResolution(int width, int height);
+	~DynamicResolution();
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+	// new size of the targets, the scale carries over
+	void resize(int width, int height);
+
+	// reads back the frames that finished since and picks this frame's scale
+	void update();
+	// around everything the scale affects
+	void begin();
+	void end();
+
+	void setBudget(float milliseconds) { budgetMilliseconds = milliseconds; }
+	void setScaleRange(float minScale, float maxScale);
+	// disabled keeps the scale fixed at whatever setScale() last set
+	void setEnabled(bool enabled) { this->enabled = enabled; }
+	void setScale(float scale);
+
+	float getScale() const { return scale; }
+	// the region to render into this frame (bottom left of the targets)
+	glm::ivec2 getRenderSize() const { return renderSize; }
+	// the region's size relative to the targets, for sampling them
+	glm::vec2 getUVScale() const { return glm::vec2(renderSize) / glm::vec2(width, height); }
+	float getGPUMilliseconds() const { return smoothedMilliseconds; }
+
+private:
+	static constexpr int RING_SIZE = 4;
+	GLuint startQueries[RING_SIZE] = {};
+	GLuint endQueries[RING_SIZE] = {};
+	bool pending[RING_SIZE] = {};
+	int next = 0;
+
+	int width, height;
+	glm::ivec2 renderSize;
+	float scale = 1.0f;
+	float minScale = 0.5f, maxScale = 1.0f;
+	float budgetMilliseconds = 16.0f;
+	float smoothedMilliseconds = 0.0f;
+	bool enabled = true;
+
+	void collect(int index, bool wait);
+	void adjust(float milliseconds);
+	void updateRenderSize();
+};
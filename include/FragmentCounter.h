@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Counts the samples that pass the depth and stencil tests between begin() and end() (GL_SAMPLES_PASSED), which
+// with early depth testing are the fragments that get shaded. Queries rotate through a small ring and are read back
+// once the GPU has finished them, so the count lags a few frames and never stalls: a query still not finished when
+// its slot comes around again is dropped instead of waited for.
+class FragmentCounter {
+public:
+	FragmentCounter();
+	~FragmentCounter();
+	FragmentCounter(const FragmentCounter&) = delete;
+	FragmentCounter& operator=(const FragmentCounter&) = delete;
+
+	void begin();
+	void end();
+
+	// the most recent finished count, 0 until the first one finishes
+	GLuint64 latest();
+	// queries dropped because they weren't finished in time, never shown
+	int getDroppedSamples() const { return droppedSamples; }
+
+private:
+	static constexpr int RING_SIZE = 4;
+	GLuint queries[RING_SIZE] = {};
+	bool pending[RING_SIZE] = {};
+	int next = 0;
+	GLuint64 result = 0;
+	int droppedSamples = 0;
+
+	void collect(int index);
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Culling.h"
+#include "HiZ.h"
+#include "Mesh.h"
+#include "Shader.h"
+
+// GPU driven drawing of many instances of one mesh. The instance transforms live in an SSBO; every frame a compute
+// pass (shaders/cullInstancesCS.glsl) tests each instance's box against the frustum and appends a draw command for
+// the visible ones, which glMultiDrawElementsIndirectCount then consumes straight from the GPU buffers.
+// The vertex shader (compiled with GPU_CULLING) fetches its transform with gl_BaseInstance.
+//
+// With a Hi-Z pyramid the pass also rejects occluded instances, in two phases: MAIN tests against the pyramid of the
+// previous frame and draws what passes. Rejected instances are queued and, once the pyramid was rebuilt from this
+// frame's depth, RETEST tests them again and draws the ones that turned out visible (camera moved, occluder gone),
+// so nothing pops in a frame late.
+class GPUCulling {
+public:
+	enum Phase { MAIN, RETEST };
+
+	static constexpr GLuint INSTANCE_BINDING = 2;  // must match the bindings in cullInstancesCS.glsl and the vertex shaders
+	static constexpr GLuint COMMAND_BINDING = 3;
+	static constexpr GLuint COUNT_BINDING = 4;
+	static constexpr GLuint RETEST_BINDING = 5;
+	static constexpr GLuint WORKGROUP_SIZE = 64;
+
+	// mesh has to be indexed
+	GPUCulling(Mesh& mesh);
+	~GPUCulling();
+	GPUCulling(const GPUCulling&) = delete;
+	GPUCulling& operator=(const GPUCulling&) = delete;
+
+	// (re)uploads the instance transforms, call again whenever they change
+	void setInstances(const std::vector<glm::mat4>& transforms);
+
+	// MAIN culls all instances (occlusion only if hiZ is given), RETEST the ones MAIN found occluded.
+	// each phase has to be followed by draw() with the same phase
+	void cull(Shader& cullShader, Phase phase, const Culling::Frustum& frustum, const glm::mat4& viewProjection, const HiZ* hiZ);
+
+	void draw(Shader& shader, Phase phase);
+
+	// counts as of a few frames ago. they're copied into a readback buffer behind a fence and only read once the GPU
+	// is done with them, so this never stalls (diagnostics only, drawing doesn't depend on it)
+	struct Counts {
+		GLuint drawnMain = 0;     // visible against the previous frame's pyramid
+		GLuint drawnRetest = 0;   // rejected by MAIN, visible against this frame's pyramid
+		GLuint occluded = 0;      // rejected by MAIN (drawnRetest of them came back)
+	};
+	Counts visibleCounts();
+
+	size_t instanceCount() const { return instances; }
+
+private:
+	Mesh& mesh;
+	GLuint instanceBuffer = 0;
+	GLuint commandBuffer = 0;
+	GLuint countBuffer = 0;
+	GLuint retestBuffer = 0;
+	GLuint readbackBuffer = 0;
+	GLsync readbackFence = nullptr;
+	Counts lastCounts;
+	bool occlusionThisFrame = false; // the MAIN phase queued instances for RETEST
+	GLsizei instances = 0;
+
+	void releaseBuffers();
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <functional>
+#include <string>
+
+// Central registry of GPU allocations. Everything that creates a texture, buffer or renderbuffer records its
+// (estimated) size here under a category. Resources registered as evictable are freed least recently used first
+// whenever the total goes over the budget.
+// Objects are identified like glObjectLabel does: GL_TEXTURE, GL_BUFFER or GL_RENDERBUFFER plus the object name.
+namespace GPUMemory {
+	enum Category {
+		TEXTURE,
+		CUBEMAP,
+		MESH,
+		FRAMEBUFFER,
+		BUFFER,
+		NUM_CATEGORIES
+	};
+
+	extern const char* categoryNames[NUM_CATEGORIES];
+
+	struct Stats {
+		size_t categoryBytes[NUM_CATEGORIES] = {};
+		size_t categoryCount[NUM_CATEGORIES] = {};
+		size_t totalBytes = 0;
+		size_t budget = 0;
+		size_t evictableBytes = 0;
+		size_t evictions = 0;      // since startup
+		size_t evictedBytes = 0;   // since startup
+	};
+
+	// estimated size of a texture. 3 channel formats are counted as 4, that's how drivers store them
+	size_t textureBytes(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers = 1, GLsizei levels = 1);
+	GLsizei fullMipCount(GLsizei width, GLsizei height);
+
+	// records an allocation (replacing any earlier record of the same object) and labels the object for debuggers
+	void track(GLenum identifier, GLuint name, Category category, size_t bytes, const std::string& label = "");
+	void untrack(GLenum identifier, GLuint name);
+
+	// evict has to free the GL object, the registry drops the record itself. objects used this frame are never evicted
+	void setEvictable(GLenum identifier, GLuint name, std::function<void()> evict);
+	void markUsed(GLenum identifier, GLuint name);
+
+	void setBudget(size_t bytes);
+	size_t getBudget();
+
+	// evicts least recently used evictable objects while over budget, then starts a new frame
+	void endFrame();
+
+	Stats getStats();
+}
@@ -4,18 +4,121 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include <string>
+#include <vector>
+
+class Profiler;
+
 namespace GUI {
 	struct GUISettings {
 		// post processing options
-		int numPostProcessingModes = 7;
-		const char* postProcessingModes[7] = {"Regular", "Inverse", "Grey Scale", "Weighted Grey Scale", "Sharpen", "Emboss", "Test"};
+		int numPostProcessingModes = 8;
+		const char* postProcessingModes[8] = {"Regular", "Inverse", "Grey Scale", "Weighted Grey Scale", "Sharpen", "Emboss", "Test", "Edge Detect 5x5"};
 		int postProcessingMode = 0;
 		float convMatrixOffset = 500.0f;
+		struct PassTiming {
+			std::string name;
+			float milliseconds;
+		};
+		std::vector<PassTiming> postProcessTimings; // gpu time per compute pass, a few frames late
+
+		// lit geometry is written to a G-buffer and shaded once per pixel instead of as it's drawn
+		bool deferredShading = false;
+
+		// clustered lighting, the two orbiting lights plus extraPointLights scattered around the backpack
+		int extraPointLights = 0;
+		int pointLights = 0;
+		int lightUploads = 0; // light buffer uploads of the last frame, only changed lights are sent
+		float lightUploadKB = 0.0f;
+		int clusterListedLights = 0; // light indices the cluster lists needed, a few frames ago
+		int clusterOverflows = 0; // clusters cut short because the index buffer ran out
+		bool checkClusters = false; // set by the button, compares the next frame's GPU cluster lists with the CPU ones
+		int clusterMismatches = -1; // clusters that differed at the last check, -1 before the first
+
+		// cascaded shadow maps of the sun, the static casters' depth is cached per cascade
+		bool shadows = true;
+		int shadowCacheRenders = 0; // cascades whose static cache was redrawn last frame
+		int shadowCacheRendersTotal = 0;
+		int shadowStaticDraws = 0;
+		int shadowDynamicDraws = 0;
+		int shadowCopies = 0; // caches copied into the shadow maps last frame
+
+		// dynamic resolution, the scale follows the GPU frame time when enabled and is set by hand otherwise
+		bool dynamicResolution = true;
+		float frameBudgetMS = 16.6f;
+		float minRenderScale = 0.5f;
+		float renderScale = 1.0f;
+		float upscaleSharpness = 0.5f;
+		float gpuFrameMS = 0.0f; // smoothed, a few frames late
+		int renderWidth = 0;
+		int renderHeight = 0;
 
 		// skybox options
 		int numSkyBoxOptions = 0;
 		const char** skyboxOptions = nullptr;
 		int skyboxTextureIndex = 0;
+
+		// culling options
+		enum CullingMode { CULLING_OFF, CULLING_FLAT, CULLING_BVH, CULLING_GPU };
+		const char* cullingModes[4] = { "Off", "Flat (SIMD)", "BVH", "GPU (compute)" };
+		int cullingMode = CULLING_BVH;
+		int visibleObjects = 0;
+		int culledObjects = 0;
+		bool occlusionCulling = true;
+		int gpuVisibleInstances = 0; // read back from the GPU culling pass, a few frames late
+		int gpuOccludedInstances = 0;
+		int gpuRetestedInstances = 0; // rejected against last frame's Hi-Z, visible against this frame's
+
+		// object under the cursor (or screen center) at the last left click, -1 if nothing was hit
+		int pickedObject = -1;
+		float pickedDistance = 0.0f;
+
+		// overdraw options, fragments counted a few frames late and divided by the screen's pixel count
+		bool depthPrepass = false;
+		bool skyboxLast = true;
+		float opaqueFragmentsPerPixel = 0.0f;
+		float skyboxFragmentsPerPixel = 0.0f;
+
+		// transparency options
+		enum TransparencyMode { TRANSPARENCY_SORTED, TRANSPARENCY_OIT };
+		const char* transparencyModes[2] = { "Depth sorted", "Weighted blended OIT" };
+		int transparencyMode = TRANSPARENCY_SORTED;
+
+		// render queue, counted over the last frame's queued draws
+		bool sortDraws = true;
+		int queueDraws = 0;
+		int queueStateChanges = 0;
+		int queueProgramChanges = 0;
+		int queueMaterialChanges = 0;
+		int queueVAOChanges = 0;
+		int queueUnsortedChanges = 0; // what drawing in submission order would have needed
+		bool queueTransparentCoherent = false; // transparents only needed an insertion sort from last frame's order
+		int queueCommandLists = 0;
+		int queuePackets = 0;
+
+		// render graph, as compiled for the last frame
+		std::vector<std::string> graphPasses;
+		int graphCulledPasses = 0;
+		int graphResources = 0;
+		int graphTextures = 0;
+		int graphPooledTextures = 0;
+		float graphPooledMB = 0.0f;
+		int graphBarriers = 0;
+
+		// job system, per worker over the last frame (the main thread first)
+		struct WorkerUtilization {
+			float busy;
+			int jobs;
+			int steals;
+		};
+		std::vector<WorkerUtilization> workerUtilization;
+
+		// gpu memory options
+		float memoryBudgetMB = 2048.0f;
+
+		// frame profiler, its scopes are read straight from it
+		const Profiler* profiler = nullptr;
+		bool profilerGraphsGPU = true; // the graphs show GPU times, CPU times otherwise
 	};
 
 	void initGUI(GLFWwindow* window);
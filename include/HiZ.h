@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+// Hierarchical depth buffer: an R32F texture with a full mip chain where every texel holds the farthest depth of the
+// texels it covers one level up. Level 0 is a copy of a depth texture, so a box whose nearest depth is behind the
+// farthest depth of the (at most 2x2) texels it covers at a coarse enough level is hidden.
+class HiZ {
+public:
+	static constexpr GLuint WORKGROUP_SIZE = 8; // must match hiZDownsampleCS.glsl
+
+	HiZ(int width, int height);
+	~HiZ();
+	HiZ(const HiZ&) = delete;
+	HiZ& operator=(const HiZ&) = delete;
+
+	// reallocates the pyramid for a depth texture of a new size, it holds the far plane until the next build
+	void resize(int width, int height);
+
+	// rebuilds the pyramid from a depth (or depth stencil) texture of the same size, of which only the bottom left
+	// region was rendered to (dynamic resolution). The rest has to hold the far plane so it never occludes anything
+	void build(Shader& downsampleShader, GLuint depthTexture, glm::ivec2 region);
+	void build(Shader& downsampleShader, GLuint depthTexture) { build(downsampleShader, depthTexture, glm::ivec2(width, height)); }
+
+	GLuint getTexture() const { return texture; }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	int getLevels() const { return levels; }
+	// the rendered region of the last build relative to the whole texture, screen uvs have to be scaled by it
+	glm::vec2 getUVScale() const { return uvScale; }
+
+private:
+	GLuint texture = 0;
+	int width, height, levels;
+	glm::vec2 uvScale = glm::vec2(1.0f);
+
+	void allocate();
+	void release();
+};
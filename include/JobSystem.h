@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing job scheduler for the frame's CPU work. Every worker (the main thread is worker 0) owns a deque:
+// it pushes and pops its own jobs at the back (newest first, still warm in cache) and idle workers steal from the
+// front of someone else's (oldest first, usually the biggest pieces of work).
+// A job finishes once its own work and all of its children are done; wait() runs other jobs until then, so waiting
+// never blocks a worker. Jobs live until endFrame(), which waits for every job of the frame, so job pointers are
+// only valid within the frame that created them.
+// Only the main thread may call beginFrame(), endFrame() and wait() from outside of a job.
+class JobSystem {
+public:
+	struct Job {
+		std::function<void()> work;
+		Job* parent = nullptr;
+		std::atomic<int> unfinished = 1; // itself plus unfinished children
+	};
+
+	// worker threads besides the main thread, by default one per remaining hardware thread
+	explicit JobSystem(unsigned workerThreads = std::max(1u, std::thread::hardware_concurrency()) - 1);
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// a job that runs work once run() is called. a parent only finishes after all of its children did
+	Job* create(std::function<void()> work, Job* parent = nullptr);
+	void run(Job* job);
+	void wait(Job* job);
+
+	// splits [0, count) into ranges of at most grain, runs them as children of one job and waits for all of them
+	void parallelFor(size_t count, size_t grain, const std::function<void(size_t first, size_t last)>& work);
+
+	void beginFrame();
+	// waits for everything created this frame and updates the stats
+	void endFrame();
+
+	// including the main thread
+	unsigned workerCount() const { return unsigned(workers.size()); }
+
+	struct WorkerStats {
+		float utilization = 0.0f; // busy time over the frame's time
+		uint32_t jobs = 0;
+		uint32_t steals = 0;
+	};
+	// per worker over the last frame, the main thread first (its utilization only counts the jobs it ran)
+	const std::vector<WorkerStats>& getStats() const { return stats; }
+
+private:
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Job*> queue;
+		std::deque<Job> storage; // this frame's jobs created on the worker, a deque keeps them in place
+		std::thread thread;
+
+		// this frame's numbers, written by the worker only
+		std::atomic<int64_t> busyNanoseconds = 0;
+		std::atomic<uint32_t> jobs = 0;
+		std::atomic<uint32_t> steals = 0;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<int> queuedJobs = 0;
+	std::atomic<int> unfinishedJobs = 0; // created this frame and not finished yet
+	std::atomic<bool> stopping = false;
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+
+	std::chrono::steady_clock::time_point frameStart;
+	std::vector<WorkerStats> stats;
+
+	int currentWorker() const;
+	void workerLoop(int index);
+	Job* findJob(int index);
+	void execute(Job* job, int index);
+	void finish(Job* job);
+};
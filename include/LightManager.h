@@ -0,0 +1,124 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Clusters.h"
+
+// Every light of the scene, in one SSBO per kind that shaders index directly (lighting.glsl, clusters.glsl). Each
+// buffer starts with the light count (padded to 16 bytes) followed by the lights, tightly packed in std430 layout.
+// Lights are added and removed at runtime: removing one moves the last light of its kind into the gap, so the arrays
+// stay dense and the shaders only see a different count. Changes only mark the lights they touch, upload() sends the
+// runs of changed lights (and the count if it changed) instead of whole buffers.
+class LightManager {
+public:
+	// the kind in the top two bits, an id that survives other lights being removed in the rest
+	using Handle = uint32_t;
+	static constexpr Handle NONE = 0xFFFFFFFF;
+
+	static constexpr GLuint POINT_BINDING = 7; // must match clusters.glsl
+	static constexpr GLuint SPOT_BINDING = 10; // must match lighting.glsl
+	static constexpr GLuint DIRECTIONAL_BINDING = 11;
+
+	using PointLight = Clusters::PointLight;
+
+	struct SpotLight {
+		glm::vec3 position = glm::vec3(0.0f);
+		float innerCutOff = 1.0f; // cosines of the cone's angles
+		glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+		float outerCutOff = 1.0f;
+		glm::vec3 ambient = glm::vec3(0.0f);
+		float constant = 1.0f;
+		glm::vec3 diffuse = glm::vec3(0.0f);
+		float linear = 0.0f;
+		glm::vec3 specular = glm::vec3(0.0f);
+		float quadratic = 0.0f;
+	};
+
+	struct DirectionalLight {
+		glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+		float padding0 = 0.0f;
+		glm::vec3 ambient = glm::vec3(0.0f);
+		float padding1 = 0.0f;
+		glm::vec3 diffuse = glm::vec3(0.0f);
+		float padding2 = 0.0f;
+		glm::vec3 specular = glm::vec3(0.0f);
+		float padding3 = 0.0f;
+	};
+
+	LightManager();
+	~LightManager();
+	LightManager(const LightManager&) = delete;
+	LightManager& operator=(const LightManager&) = delete;
+
+	// a point light's radius has to be set (Clusters::lightRadius)
+	Handle add(const PointLight& light);
+	Handle add(const SpotLight& light);
+	Handle add(const DirectionalLight& light);
+	void remove(Handle handle);
+
+	// the handle has to be of the light's kind
+	void set(Handle handle, const PointLight& light);
+	void set(Handle handle, const SpotLight& light);
+	void set(Handle handle, const DirectionalLight& light);
+	const PointLight& getPointLight(Handle handle) const;
+	const SpotLight& getSpotLight(Handle handle) const;
+	const DirectionalLight& getDirectionalLight(Handle handle) const;
+
+	// in the order the shaders see them
+	const std::vector<PointLight>& getPointLights() const { return points.lights; }
+
+	// sends the changes since the last call and binds the buffers
+	void upload();
+
+	// of the last upload()
+	struct Stats {
+		int uploads = 0; // glNamedBufferSubData calls
+		size_t bytes = 0;
+		int reallocations = 0;
+	};
+	const Stats& getStats() const { return stats; }
+
+private:
+	enum Kind { KIND_POINT, KIND_SPOT, KIND_DIRECTIONAL };
+
+	// runs of changed lights closer than this many unchanged ones are sent as one upload
+	static constexpr size_t MERGE_GAP = 4;
+	static constexpr size_t HEADER_BYTES = 16;
+
+	template <typename T>
+	struct LightArray {
+		std::vector<T> lights;
+		std::vector<uint32_t> ids;    // the id of each light
+		std::vector<uint32_t> slots;  // the index of each id's light, NONE once removed
+		std::vector<uint32_t> freeIds;
+		std::vector<uint8_t> dirty;   // per light
+		size_t dirtyCount = 0;
+		bool countDirty = true;
+
+		GLuint buffer = 0;
+		size_t capacity = 0; // lights the buffer has room for
+		GLuint binding;
+		const char* name;
+
+		LightArray(GLuint binding, const char* name) : binding(binding), name(name) {}
+		uint32_t add(const T& light);
+		void remove(uint32_t id);
+		void set(uint32_t id, const T& light);
+		void markDirty(size_t index);
+		void upload(Stats& stats);
+		void release();
+	};
+
+	LightArray<PointLight> points{ POINT_BINDING, "point lights" };
+	LightArray<SpotLight> spots{ SPOT_BINDING, "spot lights" };
+	LightArray<DirectionalLight> directionals{ DIRECTIONAL_BINDING, "directional lights" };
+	Stats stats;
+
+	static Handle makeHandle(Kind kind, uint32_t id) { return (uint32_t(kind) << 30) | id; }
+	static Kind kindOf(Handle handle) { return Kind(handle >> 30); }
+	static uint32_t idOf(Handle handle) { return handle & 0x3FFFFFFF; }
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Mesh.h"
+#include "Shader.h"
+
+class TextureStreamer;
+
+// GPU-side table of materials, so that meshes drawn with a MATERIAL_TABLE shader need no texture binds at all.
+// With ARB_bindless_texture every entry holds resident 64 bit texture handles. Without it, textures of the same size,
+// format and wrap mode are copied into GL_TEXTURE_2D_ARRAYs (bound once to fixed units) and entries hold (array, layer).
+// Either way the entries live in an SSBO that shaders index with the per draw "materialIndex" uniform.
+// Streamed textures also carry their finest resident mip level, which the shaders clamp sampling to.
+class MaterialTable {
+public:
+	static constexpr GLuint SSBO_BINDING = 1;
+	static constexpr int MAX_TEXTURE_ARRAYS = 8;      // must match MAX_MATERIAL_ARRAYS in materialTable.glsl
+	static constexpr GLuint FIRST_ARRAY_UNIT = 8;     // texture units used by the fallback arrays
+
+	// checks for ARB_bindless_texture and loads its entry points. must be called once after gladLoadGLLoader
+	static bool loadBindlessExtension(GLADloadproc load);
+	static bool bindlessAvailable();
+
+	// defines to compile material table shaders with, matching the mode the table runs in
+	static std::vector<std::string> shaderDefines();
+
+	MaterialTable();
+	~MaterialTable();
+	MaterialTable(const MaterialTable&) = delete;
+	MaterialTable& operator=(const MaterialTable&) = delete;
+
+	// returns the index of the material made of the given textures (uses the first diffuse and specular map).
+	// identical texture sets share one entry. returns -1 if the material can't be represented
+	int addMaterial(const std::vector<Texture>& textures);
+
+	// textures owned by the streamer are tracked for residency changes, set before upload()
+	void setStreamer(TextureStreamer* streamer) { this->streamer = streamer; }
+
+	// builds (or rebuilds) the GPU buffer and, in fallback mode, the texture arrays
+	void upload();
+
+	// picks up mip levels the streamer made resident since the last call. call once per frame after the streamer update
+	void refresh();
+
+	// binds the SSBO and fallback arrays; sets the array sampler uniforms of the given shaders
+	void bind(const std::vector<Shader*>& shaders) const;
+
+	bool isBindless() const { return bindless; }
+	size_t size() const { return materials.size(); }
+
+private:
+	struct MaterialDesc {
+		GLuint diffuse;
+		GLuint specular;
+	};
+
+	// std430 layout of one entry, see materialTable.glsl
+	struct GPUMaterial {
+		GLuint diffuse[2];   // bindless: handle (low, high). fallback: (array slot, layer)
+		GLuint specular[2];
+		float minLod[2];     // finest resident level of the diffuse and specular map
+	};
+
+	// (width, height, internal format, wrap mode) of the textures sharing a fallback array
+	using ArrayKey = std::tuple<GLint, GLint, GLint, GLint>;
+
+	bool bindless;
+	TextureStreamer* streamer = nullptr;
+	uint64_t residencyVersion = 0;
+	GLuint ssbo = 0;
+	GLuint defaultTexture = 0; // 1x1 black texture standing in for missing maps
+
+	std::vector<MaterialDesc> materials;
+	std::map<std::pair<GLuint, GLuint>, int> materialLookup;
+
+	std::vector<GLuint> residentTextures;
+	std::vector<GLuint> textureArrays;
+	std::map<GLuint, std::pair<GLuint, GLuint>> arrayLocations; // texture id -> (array slot, layer)
+	std::map<GLuint, int> copiedBaseLevel;                       // fallback: finest level copied into the array
+	std::vector<GPUMaterial> entries;
+
+	void packTextureArrays();
+	void releaseGPUResources();
+	void reference(GLuint texture, GLuint out[2]);
+	float minLod(GLuint texture) const;
+	void copyLevels(GLuint texture, int firstLevel, int endLevel);
+};
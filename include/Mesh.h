@@ -6,7 +6,10 @@
 #include <vector>
 
 #include "Shader.h"
+#include "Culling.h"
 
+class MaterialTable;
+class TextureAtlas;
 
 struct Texture {
     GLuint id;
@@ -19,11 +22,43 @@ public:
     Mesh(const std::vector<float>& vertices, const std::vector<unsigned int>& attribSizes,const std::vector<Texture>& textures,const std::vector<unsigned int>& indices = {});
     void draw(Shader& shader);
 
+    // draws with commands and their count generated on the GPU (DrawElementsIndirectCommand layout, indexed meshes only)
+    void drawIndirectCount(Shader& shader, GLuint commandBuffer, GLuint countBuffer, GLsizei maxDrawCount, GLintptr commandOffset = 0, GLintptr countOffset = 0);
+
+    // registers this mesh's textures as a material, shaders compiled with MATERIAL_TABLE then skip the texture binds
+    void registerMaterial(MaterialTable& table);
+
+    // moves the mesh onto an atlas page: the given texture coordinate attribute is remapped into the image's region and
+    // the diffuse map replaced by the page. call before registerMaterial. returns false if the atlas doesn't hold name
+    bool useAtlasRegion(const TextureAtlas& atlas, const std::string& name, unsigned int texCoordAttrib);
+
+    const std::vector<Texture>& getTextures() const { return textures; }
+
+    // radius of the sphere around the local origin enclosing every vertex position (attribute 0)
+    float getBoundingRadius() const { return boundingRadius; }
+
+    // draw split into its state changes, for callers that skip binding what's already bound (see RenderQueue).
+    // drawGeometry expects the shader in use, the textures bound and getVAO() bound
+    void bindTextures(Shader& shader) const;
+    void drawGeometry() const;
+    GLuint getVAO() const { return VAO; }
+    int getMaterialIndex() const { return materialIndex; }
+
+    bool isIndexed() const { return indicesSize != 0; }
+    GLsizei getIndexCount() const { return indicesSize; }
+
+    // local space box around every vertex position
+    const Culling::AABB& getLocalBounds() const { return localBounds; }
+
 private:
     GLuint VAO, VBO, EBO;
     GLsizei indicesSize;
     GLsizei vertexCount;
     std::vector<Texture> textures;
+    std::vector<unsigned int> attribSizes;
+    int materialIndex = -1;
+    float boundingRadius = 0.0f;
+    Culling::AABB localBounds;
 
     void setUpAttributes(const std::vector<unsigned int>& attribSizes);
 
@@ -18,6 +18,9 @@ class Model
 public:
     Model(std::string path);
     void draw(Shader& shader);
+    void registerMaterials(MaterialTable& table);
+
+    const std::vector<Mesh>& getMeshes() const { return meshes; }
 
 private:
     // model data
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+#include <string>
+#include <vector>
+
+// Post-processing as a chain of compute passes (postProcessCS.glsl), each writing an RGBA8 image the next one reads.
+// A pass is either a per pixel color operation or a convolution with a W x H kernel whose taps are spacing texels
+// apart. Kernels that fit reach into a shared memory tile per workgroup (one texel fetch per texel instead of one per
+// tap), bigger ones fetch every tap directly. Separable kernels are added as a horizontal and a vertical pass.
+// Every pass is timed on the GPU, the timings are read back a few frames late. With dynamic resolution only the bottom
+// left region of the images is processed, present() upscales it to the screen.
+// The images belong to the caller (the render graph's transient textures), which also has to put a texture fetch
+// barrier between a pass and whatever reads its image.
+class PostProcessStack {
+public:
+	static constexpr GLuint TILE_SIZE = 16; // must match postProcessCS.glsl
+	static constexpr int MAX_TILE_HALO = 8; // must match postProcessCS.glsl
+
+	enum ColorOp { COLOR_INVERSE, COLOR_GREY, COLOR_GREY_WEIGHTED };
+
+	PostProcessStack();
+	~PostProcessStack();
+	PostProcessStack(const PostProcessStack&) = delete;
+	PostProcessStack& operator=(const PostProcessStack&) = delete;
+
+	void clear();
+	void addColor(const std::string& name, ColorOp op);
+	// width x height kernel (both odd), weights row by row starting at the top row
+	void addKernel(const std::string& name, int width, int height, const std::vector<float>& weights);
+	void addKernel(const std::string& name, int size, const std::vector<float>& weights) { addKernel(name, size, size, weights); }
+	// the kernel horizontal * vertical^T as two 1D passes, vertical starting at the top
+	void addSeparable(const std::string& name, const std::vector<float>& horizontal, const std::vector<float>& vertical);
+
+	// distance in texels between neighbouring kernel taps
+	void setSpacing(glm::ivec2 spacing) { this->spacing = glm::max(spacing, glm::ivec2(1)); }
+
+	size_t getPassCount() const { return passes.size(); }
+	const std::string& getPassName(size_t pass) const { return passes[pass].name; }
+
+	// runs one pass over the bottom left region of source into the same region of destination (an RGBA8 image)
+	void execute(size_t pass, Shader& computeShader, GLuint source, GLuint destination, glm::ivec2 region);
+
+	// draws the bottom left uvScale of image as a fullscreen triangle (fullscreenTriangleVS.glsl) into the bound
+	// framebuffer, sharpening by 0 (plain bilinear) to 1 to make up for some of the upscale's blur
+	void present(Shader& displayShader, GLuint image, glm::vec2 uvScale, float sharpness = 0.0f);
+
+	struct Timing {
+		std::string name;
+		float milliseconds;
+	};
+	std::vector<Timing> getTimings() const;
+
+private:
+	static constexpr int QUERY_RING = 4;
+
+	enum PassType { PASS_COLOR, PASS_KERNEL };
+
+	struct Pass {
+		std::string name;
+		PassType type;
+		ColorOp colorOp = COLOR_INVERSE;
+		glm::ivec2 size = glm::ivec2(1);
+		int weightOffset = 0;
+
+		GLuint queries[QUERY_RING] = {};
+		bool pending[QUERY_RING] = {};
+		int nextQuery = 0;
+		float milliseconds = 0.0f;
+	};
+
+	GLuint weightBuffer = 0;
+	GLsizeiptr weightBufferSize = 0;
+	GLuint emptyVAO = 0;
+
+	std::vector<Pass> passes;
+	std::vector<float> weights;
+	bool weightsDirty = false;
+	glm::ivec2 spacing = glm::ivec2(1);
+
+	Pass& addPass(const std::string& name, PassType type);
+	void uploadWeights();
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Nested CPU and GPU timings of named scopes of the frame, for the GUI's timeline and graphs. Every scope takes the
+// CPU clock and issues a GL_TIMESTAMP query (glQueryCounter, so scopes nest and don't collide with GL_TIME_ELAPSED
+// queries around them) where it begins and ends. The queries of a frame are read back FRAME_LATENCY frames later, and
+// only once the GPU says they're available: a frame whose results still aren't in when its queries are needed again
+// is dropped instead of waited for, so profiling never stalls the pipeline.
+// Scopes are GL thread only, work spread over the job system shows up as the main thread's scope around it.
+class Profiler {
+public:
+	static constexpr int FRAME_LATENCY = 4; // frames in flight, each with its own queries
+	static constexpr int MAX_SCOPES = 64; // per frame, the frame itself included. later ones aren't timed
+	static constexpr int HISTORY = 240; // frames kept for the graphs
+
+	struct Scope {
+		std::string name;
+		int depth; // 0 is the frame
+		// milliseconds since the frame's start on the CPU and on the GPU
+		float cpuBegin, cpuEnd;
+		float gpuBegin, gpuEnd;
+	};
+
+	// ms per frame of a scope directly below the frame, HISTORY frames in a ring with the oldest at getHistoryNext()
+	// (0 where the scope didn't run)
+	struct History {
+		std::string name;
+		float cpu[HISTORY] = {};
+		float gpu[HISTORY] = {};
+	};
+
+	Profiler();
+	~Profiler();
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// collects the frames the GPU finished since, then opens the frame's scope. everything up to endFrame is in it
+	void beginFrame();
+	void endFrame();
+
+	void begin(const std::string& name);
+	void end();
+
+	// begin and end around its lifetime
+	class ScopedTimer {
+	public:
+		ScopedTimer(Profiler* profiler, const std::string& name) : profiler(profiler) {
+			if (profiler)
+				profiler->begin(name);
+		}
+		~ScopedTimer() {
+			if (profiler)
+				profiler->end();
+		}
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+	private:
+		Profiler* profiler;
+	};
+
+	// the newest frame with its GPU times in, its scopes in the order they began (the frame first). empty before
+	// the first frame came back
+	const std::vector<Scope>& getLatest() const { return latest; }
+	const std::vector<History>& getHistories() const { return histories; }
+	int getHistoryNext() const { return historyNext; }
+	// frames whose results weren't available in time, never shown
+	int getDroppedFrames() const { return droppedFrames; }
+
+private:
+	struct Frame {
+		GLuint queries[2 * MAX_SCOPES] = {}; // begin and end of every scope
+		std::vector<Scope> scopes;
+		bool pending = false;
+	};
+
+	Frame frames[FRAME_LATENCY];
+	int current = 0;
+	std::chrono::steady_clock::time_point frameStart;
+	std::vector<int> open; // scopes begun but not ended, -1 for those past MAX_SCOPES
+
+	std::vector<Scope> latest;
+	std::vector<History> histories;
+	int historyNext = 0;
+	int droppedFrames = 0;
+
+	float cpuMilliseconds() const;
+	// false if the frame's results aren't available yet
+	bool collect(Frame& frame);
+	void record(const std::vector<Scope>& scopes);
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class Profiler;
+
+// Frame graph over the frame's render passes. Every frame the passes are declared again (addPass) together with the
+// textures they create, read and write, then compile() works out what actually runs:
+//  - passes nothing live depends on (through what they write) are culled, unless they have a side effect
+//  - transient textures get a GL texture from a pool that outlives the frame. Textures with the same format and size
+//    whose lifetimes (first to last live pass using them) don't overlap share one GL texture, so memory follows the
+//    peak of what is alive at once instead of the sum of everything declared
+//  - glMemoryBarrier is issued before a pass that uses a GL texture some earlier pass wrote with image stores, with
+//    the bits matching how it's used now (reads and writes alike). What's owed is kept per pooled GL texture and
+//    carried into the next frame, so a resource that's given a texture another one wrote with image stores, this
+//    frame or an earlier one, still gets its barrier
+//  - attachments of raster passes are put into framebuffers, cached by their set of GL textures
+// Textures sized relative to the screen are reallocated when the screen size changes, fixed size ones are kept.
+class RenderGraph {
+public:
+	using Resource = int; // index into this frame's declared textures, -1 is none
+
+	struct TextureDesc {
+		GLenum format = GL_RGBA8;
+		// size relative to the screen, unless width and height are set
+		float scale = 1.0f;
+		int width = 0, height = 0;
+	};
+
+	enum Access { SAMPLED, IMAGE, ATTACHMENT };
+
+	class PassBuilder {
+	public:
+		// a new transient texture, written by this pass
+		Resource create(const std::string& name, const TextureDesc& desc, Access access = ATTACHMENT);
+		Resource read(Resource resource, Access access = SAMPLED);
+		Resource write(Resource resource, Access access = ATTACHMENT);
+		// run even if nothing reads what the pass writes (drawing to the screen, readbacks, state kept across frames)
+		void sideEffect();
+
+	private:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph& graph, int pass) : graph(graph), pass(pass) {}
+		RenderGraph& graph;
+		int pass;
+	};
+
+	// what a pass's execute function gets: its framebuffer (already bound, 0 if it has no attachments) and the GL
+	// textures behind its resources
+	class PassContext {
+	public:
+		GLuint texture(Resource resource) const;
+		glm::ivec2 size(Resource resource) const;
+		GLuint framebuffer = 0;
+
+	private:
+		friend class RenderGraph;
+		PassContext(const RenderGraph& graph) : graph(graph) {}
+		const RenderGraph& graph;
+	};
+
+	struct Stats {
+		int passes = 0;
+		int culledPasses = 0;
+		int resources = 0;     // transient textures declared by live passes
+		int textures = 0;      // GL textures they were given
+		int pooledTextures = 0; // GL textures in the pool, including ones unused this frame
+		size_t pooledBytes = 0;
+		int barriers = 0;
+	};
+
+	RenderGraph(int screenWidth, int screenHeight);
+	~RenderGraph();
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// frees the pooled textures sized relative to the screen, the rest of the pool stays
+	void setScreenSize(int width, int height);
+	glm::ivec2 getScreenSize() const { return screenSize; }
+
+	// starts declaring a new frame
+	void reset();
+	void addPass(const std::string& name, std::function<void(PassBuilder&)> setup, std::function<void(const PassContext&)> execute);
+	void compile();
+	// with a profiler every live pass is timed as a scope of its name
+	void execute(Profiler* profiler = nullptr);
+
+	const Stats& getStats() const { return stats; }
+	// live passes of the last compile in execution order
+	const std::vector<std::string>& getPassNames() const { return passNames; }
+
+private:
+	static constexpr int UNUSED_FRAMES_BEFORE_RELEASE = 60;
+
+	struct Use {
+		Resource resource;
+		Access access;
+		bool write;
+	};
+
+	struct Pass {
+		std::string name;
+		std::function<void(const PassContext&)> execute;
+		std::vector<Use> uses;
+		bool sideEffect = false;
+		bool live = false;
+		GLbitfield barriers = 0;
+		GLuint framebuffer = 0;
+	};
+
+	struct VirtualTexture {
+		std::string name;
+		TextureDesc desc;
+		glm::ivec2 size;
+		int firstPass = -1, lastPass = -1;
+		int physical = -1;
+	};
+
+	struct PhysicalTexture {
+		GLenum format;
+		glm::ivec2 size;
+		bool screenRelative;
+		GLuint texture = 0;
+		int busyUntil = -1; // last pass of this frame's current holder
+		int unusedFrames = 0;
+		GLbitfield owedBarriers = 0; // since its last image store write, not issued yet
+	};
+
+	struct CachedFramebuffer {
+		std::vector<GLuint> colors;
+		GLuint depth = 0;
+		GLuint framebuffer = 0;
+	};
+
+	glm::ivec2 screenSize;
+	std::vector<Pass> passes;
+	std::vector<VirtualTexture> resources;
+	std::vector<PhysicalTexture> pool;
+	std::vector<CachedFramebuffer> framebuffers;
+	std::vector<std::string> passNames;
+	Stats stats;
+
+	void cull();
+	void allocate();
+	void placeBarriers();
+	GLuint framebufferFor(const Pass& pass);
+	int acquire(const VirtualTexture& texture, int pass);
+	void release(size_t physical);
+	void releaseUnused();
+};
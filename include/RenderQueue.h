@@ -0,0 +1,119 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "Shader.h"
+#include "Mesh.h"
+#include "SceneObject.h"
+#include "DepthSort.h"
+#include "CommandList.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class JobSystem;
+
+// Collects the frame's draws as one item per mesh, each with a packed 64 bit sort key, and draws them sorted so
+// that state is only changed when the key says it differs. The keys are radix sorted every frame.
+//
+//   | pass 4 | program 8 | material 16 | vao 12 | depth 24 |   grouped by state, front to back inside a group
+//
+// depth is the distance from the camera quantized over [0, far]. program, material and vao are small ids the queue
+// hands out the first time it sees a shader, texture set or vertex array.
+//
+// Transparent draws only sort by depth, far to near, as (depth key, item) pairs. When the same draws are submitted in
+// the same order as last frame they start out in last frame's sorted order and an insertion sort usually finishes
+// them in about one pass, otherwise they're radix sorted.
+//
+// Drawing is split in two: record() turns each pass's sorted draws into command lists, one per slice of the order and
+// in parallel on the job system, and execute() replays a pass's lists on the GL thread.
+class RenderQueue {
+public:
+	// PASS_GBUFFER is opaque geometry drawn into the G-buffer for deferred shading (DeferredShading.h).
+	// PASS_OIT is for transparents drawn with weighted blended OIT (WeightedOIT.h): their order doesn't matter, so
+	// they get state keys like opaque draws instead of a depth sort
+	enum Pass { PASS_OPAQUE, PASS_GBUFFER, PASS_OIT, PASS_TRANSPARENT, NUM_PASSES };
+
+	struct Stats {
+		int draws = 0;
+		int programChanges = 0;
+		int materialChanges = 0;
+		int vaoChanges = 0;
+		int unsortedChanges = 0; // program + material + vao changes the submission order would have needed
+		bool transparentCoherent = false; // the transparent draws only needed the insertion sort
+		int commandLists = 0;
+		int packets = 0;
+	};
+
+	// starts a new frame, depth keys are measured from the frame's camera
+	void begin(const CameraFrame& frame, float farDepth);
+
+	// queues every mesh of the object
+	void submit(Pass pass, Shader& shader, const SceneObject& object);
+	// queues every mesh of the objects that aren't culled, the items and keys are built across the job system's
+	// workers. not for PASS_TRANSPARENT, whose submissions are compared against last frame's in order
+	void submitAll(Pass pass, Shader& shader, const std::vector<SceneObject>& objects, JobSystem& jobs);
+
+	// sorts the queued keys (or keeps the submission order) and resets the stats, call once after the last submit.
+	// with a job system the opaque keys, the transparent pairs and the stats are done at the same time
+	void sort(bool sorted = true, JobSystem* jobs = nullptr);
+
+	// records the command lists of every pass and counts their state changes, call after sort()
+	void record(const CameraFrame& frame, JobSystem* jobs = nullptr);
+
+	// draws everything queued for the pass, record() has to have been called
+	void execute(Pass pass);
+
+	// draws the pass's geometry with one shader that only needs the model matrix (a depth pre-pass), in key order and
+	// without materials. not for PASS_TRANSPARENT, not counted in the stats
+	void executeDepthOnly(Pass pass, Shader& depthShader);
+
+	const Stats& getStats() const { return stats; }
+
+private:
+	struct Item {
+		Shader* shader;
+		const Mesh* mesh;
+		const SceneObject* object;
+		uint32_t program, material, vao; // the ids in the key
+	};
+
+	struct SortEntry {
+		uint64_t key;
+		uint32_t item;
+	};
+
+	std::vector<Item> items;
+	std::vector<SortEntry> entries, scratch;
+	Stats stats;
+
+	// entries index transparentItems, which holds the item index of each transparent submission
+	std::vector<DepthSort::Entry> transparent, transparentScratch;
+	std::vector<uint32_t> transparentItems;
+	// the transparent submissions (object and mesh) of this and last frame, and last frame's sorted order
+	std::vector<std::pair<const SceneObject*, const Mesh*>> transparentSubmitted, previousSubmitted;
+	std::vector<uint32_t> previousOrder;
+
+	bool sorted = true; // the last sort() sorted, otherwise the keys are in submission order
+	std::vector<CommandList> commandLists[NUM_PASSES];
+	CommandList::Replayer replayer;
+
+	glm::vec3 cameraPosition = glm::vec3(0.0f);
+	float farDepth = 100.0f;
+
+	std::unordered_map<const Shader*, uint32_t> programIds;
+	std::unordered_map<const Mesh*, uint32_t> materialIds; // textured meshes without a material table entry
+	std::unordered_map<GLuint, uint32_t> vaoIds;
+
+	uint32_t materialId(const Mesh& mesh);
+	uint64_t stateKey(Pass pass, const Item& item, float distance) const;
+	int countChanges() const; // over items in submission order, what drawing them unsorted would bind
+	void sortTransparent();
+	// the range of entries holding the pass's keys
+	std::pair<size_t, size_t> passRange(Pass pass) const;
+	static void recordItem(CommandList& list, uint64_t key, const Item& item, const Item* previous, const CameraFrame& frame);
+
+	// LSD radix sort on the keys, 8 bits per pass, passes where every key has the same byte are skipped
+	static void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+};
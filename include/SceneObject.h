@@ -5,23 +5,61 @@
 #include "Shader.h"
 #include "Model.h"
 #include "Camera.h"
+#include "TransformSystem.h"
 
+#include <optional>
+
+class TextureStreamer;
 
 
 class SceneObject {
 public:
-	glm::vec3 position = glm::vec3(0.0f);
-	glm::vec3 rotation = glm::vec3(0.0f);
-	glm::vec3 scale = glm::vec3(1.0f);
-
 	Model* model = nullptr;
 	Mesh* mesh = nullptr;
 
-	SceneObject(Model* model);
-	SceneObject(Mesh* mesh);
+	// set by the frustum culling pass, culled objects are skipped when drawing
+	bool culled = false;
+
+	// flat color for shaders with a lightColor uniform (the light cubes)
+	std::optional<glm::vec3> emissiveColor;
+
+	// the transform lives in the given system, copies of an object share it
+	SceneObject(Model* model, TransformSystem& transforms);
+	SceneObject(Mesh* mesh, TransformSystem& transforms);
+
+	void setPosition(const glm::vec3& position);
+	// euler angles in degrees, applied x then y then z
+	void setRotation(const glm::vec3& rotation);
+	void setScale(const glm::vec3& scale);
+
+	glm::vec3 getPosition() const;
+	glm::vec3 getScale() const;
+
+	void draw(Shader& shader, const CameraFrame& frame);
+
+	// the per object uniforms draw sets, shader has to be in use
+	void setUniforms(Shader& shader, const CameraFrame& frame) const;
+
+	// their values, without touching GL (safe from any thread once the transforms are updated)
+	struct Uniforms {
+		glm::mat4 model;
+		glm::mat3 normalMat;
+		glm::vec3 lightColor;
+		bool emissive;
+	};
+	Uniforms getUniforms(const CameraFrame& frame) const;
+
+	// world space box around the object's mesh or model
+	Culling::AABB getWorldBounds() const;
+
+	// tells the streamer how large this object's textures appear on screen.
+	// pixelsPerUnit: on-screen pixels covered by one world unit at distance 1 (viewport height / 2 * projection[1][1])
+	void requestTextureDetail(TextureStreamer& streamer, const glm::vec3& cameraPosition, float pixelsPerUnit) const;
 
-	void draw(Shader& shader, Camera& camera);
+	// valid after the transform system's last update()
+	const glm::mat4& getModelmatrix() const;
 
 private:
-	glm::mat4 getModelmatrix() const;
+	TransformSystem* transforms;
+	TransformSystem::Handle transform;
 };
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -13,19 +14,35 @@
 class Shader{
 public:
     unsigned int ID;
-    Shader(const char* vertexPath, const char* fragmentPath);
+
+    // defines are injected as "#define <define>" lines right after the #version directive of both stages
+    Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = {});
+
+    // compute shader program
+    Shader(const char* computePath, const std::vector<std::string>& defines = {});
     void use();
 
+    bool hasDefine(const std::string& name) const;
+
     // utility uniform functions
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
     void setFloat(const std::string& name, float value) const;
     void setMat4(const std::string& name, glm::mat4 value) const;
     void setMat3(const std::string& name, glm::mat3 value) const;
+    void setVec2(const std::string& name, glm::vec2 value) const;
     void setVec3(const std::string& name, glm::vec3 value) const;
     void setVec3(const std::string& name, float x, float y, float z) const;
+    void setVec4(const std::string& name, glm::vec4 value) const;
+    void setUint(const std::string& name, unsigned int value) const;
 
 private:
+    std::vector<std::string> defines;
+
     void checkCompileErrors(unsigned int shader, std::string type);
 
+    // reads a shader file, expanding #include "file" directives relative to the including file
+    static std::string readSource(const std::string& path, int depth = 0);
+    static std::string injectDefines(const std::string& source, const std::vector<std::string>& defines);
+
 };
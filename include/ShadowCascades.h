@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Camera.h"
+
+// Cascaded shadow maps of a directional light, the part that doesn't need GL (see CascadedShadows.h for the maps).
+// The view frustum is cut into COUNT depth ranges, each covered by its own orthographic shadow map: near ranges are
+// short and get fine texels, far ones long and coarse.
+// Every cascade is a box around the bounding sphere of its range of the frustum, so its size doesn't change as the
+// camera turns, placed on a grid of whole texels in light space so the shadow edges don't crawl as the camera moves.
+// The box is a margin larger than the sphere and stays where it is while the sphere is still inside: its matrix only
+// changes when the camera has moved far enough, which is what lets the static casters' depth be cached per cascade.
+namespace ShadowCascades {
+	const int COUNT = 4; // must match shaders/shadows.glsl
+	const float SPLIT_LAMBDA = 0.75f; // blend of logarithmic (1) and uniform (0) splits
+	const float MARGIN = 0.125f; // extra box size per sphere radius, how far the camera moves before a cascade does
+
+	struct Cascade {
+		float splitNear = 0.0f, splitFar = 0.0f; // view depth range covered
+		float radius = 0.0f; // of the range's bounding sphere, rounded up so it doesn't jitter
+		glm::vec3 center = glm::vec3(0.0f); // of the box in light view space, on the snapping grid
+		float texelSize = 0.0f; // world units per shadow map texel
+		glm::mat4 viewProjection = glm::mat4(1.0f); // world to the cascade's clip space
+
+		bool operator==(const Cascade& other) const { return viewProjection == other.viewProjection; }
+	};
+
+	// COUNT + 1 view depths from nearPlane to farPlane, cascade i covers [splits[i], splits[i + 1]]
+	std::vector<float> splitDistances(float nearPlane, float farPlane);
+
+	// world to light view space, looking along direction
+	glm::mat4 lightView(const glm::vec3& direction);
+
+	// the cascade covering the frame's view depths [splitNear, splitFar]. previous (the cascade's last fit, or null)
+	// is kept where it is while its box still holds the range, so an unchanged matrix means the same shadow map
+	Cascade fit(const CameraFrame& frame, float splitNear, float splitFar, const glm::mat4& lightView, int resolution,
+		const Cascade* previous);
+
+	// world space corners of the frame's view depths [splitNear, splitFar]
+	void sliceCorners(const CameraFrame& frame, float splitNear, float splitFar, glm::vec3 corners[8]);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Packs small clamp-to-edge textures (sprites, decals, foliage) into shared RGBA8 atlas pages, so quads that used to
+// need their own texture can share one. Every image is surrounded by a gutter of replicated edge texels and placed on
+// a grid aligned to the coarsest mip level the atlas keeps, so neither bilinear filtering nor mipmapping bleeds
+// neighbouring images into each other.
+class TextureAtlas {
+public:
+	// where an image ended up: uv' = uvOffset + uv * uvScale, for uv in [0, 1]
+	struct Region {
+		glm::vec2 uvOffset;
+		glm::vec2 uvScale;
+		int page;
+	};
+
+	// pageSize: width and height of an atlas page. mipLevels: number of mip levels kept per page (at least 1)
+	// maxImageSize: images with a side larger than this are rejected by add() and should keep their own texture
+	TextureAtlas(int pageSize = 2048, int mipLevels = 4, int maxImageSize = 512);
+	~TextureAtlas();
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	// queues an image file under name, decoded with the current Utils flip setting. returns false if it can't be atlased
+	bool add(const std::string& name, const std::string& path);
+
+	// packs every queued image and uploads the pages. returns false if an image didn't fit on an empty page
+	bool build();
+
+	const Region* find(const std::string& name) const;
+	GLuint pageTexture(int page) const { return pages[page]; }
+	int pageCount() const { return (int)pages.size(); }
+
+private:
+	struct PendingImage {
+		std::string name;
+		int width, height;
+		std::vector<unsigned char> rgba;
+	};
+
+	int pageSize;
+	int mipLevels;
+	int maxImageSize;
+
+	std::vector<PendingImage> pending;
+	std::map<std::string, Region> regions;
+	std::vector<GLuint> pages;
+
+	int alignment() const { return 1 << (mipLevels - 1); }
+	int gutter() const { return alignment(); }
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Disk cache of decoded, GPU-ready pixel data. The first time an image is loaded it is decoded with stb_image and
+// the raw pixels are written to the cache directory; later runs memory-map the blob and upload it directly.
+namespace TextureCache {
+
+	// header written at the start of every cache blob, followed by width * height * channels tightly packed bytes
+	struct BlobHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceHash;  // hash of the source path (and flip state) the blob was decoded from
+		int64_t sourceMTime;  // last write time of the source file when it was decoded
+		uint64_t sourceSize;  // size in bytes of the source file when it was decoded
+		int32_t width;
+		int32_t height;
+		int32_t channels;
+		uint32_t flipped;
+	};
+
+	// decoded pixels, either memory-mapped from a cache blob or owned (freshly decoded by stb_image)
+	class Image {
+	public:
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+
+		Image() = default;
+		~Image();
+		Image(Image&& other) noexcept;
+		Image& operator=(Image&& other) noexcept;
+		Image(const Image&) = delete;
+		Image& operator=(const Image&) = delete;
+
+		const unsigned char* data() const { return pixels; }
+		bool fromCache() const { return mapping != nullptr; }
+
+	private:
+		friend Image loadImage(const std::string& path, bool flipVertically);
+
+		const unsigned char* pixels = nullptr;
+		unsigned char* decoded = nullptr;  // owned stb_image allocation (cache miss)
+		void* mapping = nullptr;           // platform specific mapping state (cache hit)
+
+		void release();
+	};
+
+	// directory the blobs are read from / written to, "./cache/textures" by default
+	void setCacheDirectory(const std::string& directory);
+	void setEnabled(bool enabled);
+
+	// returns the decoded image at path, from the cache if a valid blob exists, otherwise decodes it and writes a blob.
+	// on failure the returned image has no data
+	Image loadImage(const std::string& path, bool flipVertically);
+
+	// decodes every image under directory (recursively) into the cache. returns the number of blobs written
+	int warm(const std::string& directory, bool flipVertically);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Progressive texture loading. Textures get immutable storage for their full mip chain straight away, with a grey
+// placeholder in the coarsest level. A background thread decodes the image and builds the mip chain on the CPU; the
+// GL thread then uploads the small mips at once and the larger ones only once something on screen is big enough to
+// need them, within a per frame upload budget. GL_TEXTURE_BASE_LEVEL is clamped to the finest resident level.
+class TextureStreamer {
+public:
+	// mips with both sides at most this size are uploaded as soon as the image is decoded
+	static constexpr int IMMEDIATE_MIP_SIZE = 128;
+
+	TextureStreamer(size_t uploadBudgetBytes = 16 * 1024 * 1024);
+	~TextureStreamer();
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// creates the texture object and queues the file for decoding. returns 0 if the file isn't a readable image
+	GLuint createTexture(const std::string& path, bool flipVertically);
+
+	// something using texture covers about pixelSize pixels on screen this frame
+	void request(GLuint texture, float pixelSize);
+
+	// uploads decoded levels, finest wanted first within the budget. call once per frame on the GL thread
+	void update();
+
+	// finest mip level currently resident (0 once fully loaded, 0 for textures the streamer doesn't own)
+	int residentBaseLevel(GLuint texture) const;
+
+	// stops the streamer from touching the texture's parameters (needed once a bindless handle exists).
+	// sets GL_TEXTURE_BASE_LEVEL to 0, so the user has to clamp sampling to residentBaseLevel itself
+	void lockParameters(GLuint texture);
+
+	// bumped every time any texture's resident base level changes
+	uint64_t residencyVersion() const { return version; }
+
+	size_t pendingCount() const;
+	void setUploadBudget(size_t bytes) { uploadBudget = bytes; }
+
+private:
+	struct Level {
+		int width, height;
+		std::vector<unsigned char> pixels;
+	};
+
+	struct Entry {
+		std::string path;
+		bool flip;
+		int width, height, channels;
+		int levelCount;
+		int residentBase;               // finest uploaded level
+		int wantedLevel;                // finest level requested since the last update
+		bool placeholder = true;        // the coarsest level still holds the grey placeholder
+		bool locked = false;
+		std::atomic<bool> decoded{ false };
+		bool failed = false;
+		std::vector<Level> levels;      // filled by the worker, released once everything is resident
+	};
+
+	std::unordered_map<GLuint, std::unique_ptr<Entry>> entries;
+
+	// decode queue, consumed by the worker thread
+	mutable std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	std::deque<Entry*> decodeQueue;
+	bool stopping = false;
+	std::thread worker;
+
+	size_t uploadBudget;
+	uint64_t version = 0;
+
+	void workerLoop();
+	static void buildMipChain(Entry& entry, const unsigned char* pixels);
+	void setResidentBase(GLuint texture, Entry& entry, int level);
+};
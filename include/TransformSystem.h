@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Transforms of all scene objects, stored structure of arrays (translation, rotation quaternion, scale) with a dirty
+// flag each. update() recomposes only the dirty ones, four at a time with SSE, into world matrices and world space
+// normal matrices. The normal matrix of T * R * S is R * S^-1, so no matrix inverse is needed anywhere.
+// Matrices are valid after update(); objects are never removed, handles stay valid for the system's lifetime.
+class TransformSystem {
+public:
+	using Handle = uint32_t;
+
+	Handle create(const glm::vec3& position = glm::vec3(0.0f), const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+
+	void setPosition(Handle handle, const glm::vec3& position);
+	void setRotation(Handle handle, const glm::quat& rotation);
+	void setScale(Handle handle, const glm::vec3& scale);
+
+	glm::vec3 getPosition(Handle handle) const { return glm::vec3(posX[handle], posY[handle], posZ[handle]); }
+	glm::quat getRotation(Handle handle) const { return glm::quat(rotW[handle], rotX[handle], rotY[handle], rotZ[handle]); }
+	glm::vec3 getScale(Handle handle) const { return glm::vec3(scaleX[handle], scaleY[handle], scaleZ[handle]); }
+
+	const glm::mat4& getWorldMatrix(Handle handle) const { return world[handle]; }
+	const glm::mat3& getNormalMatrix(Handle handle) const { return normal[handle]; }
+
+	// recomposes the matrices of everything changed since the last call, returns how many were recomposed
+	size_t update();
+	// the same spread over the job system's workers in ranges of PARALLEL_GRAIN transforms
+	size_t update(JobSystem& jobs);
+
+	size_t size() const { return world.size(); }
+
+	// name of the code path update() takes ("SSE" or "scalar")
+	static const char* simdPath();
+
+private:
+	static constexpr size_t PARALLEL_GRAIN = 1024; // multiple of 4
+
+	std::vector<float> posX, posY, posZ;
+	std::vector<float> rotX, rotY, rotZ, rotW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<uint8_t> dirty;
+	size_t dirtyCount = 0;
+
+	std::vector<glm::mat4> world;
+	std::vector<glm::mat3> normal;
+
+	void markDirty(Handle handle);
+	size_t updateRange(size_t first, size_t last); // first has to be a multiple of 4
+	void composeScalar(size_t index);
+	void composeBlock(size_t first); // 4 transforms starting at first
+};
@@ -7,8 +7,15 @@
 #include <string>
 #include <vector>
 
+class TextureStreamer;
+
 namespace Utils {
 	GLuint textureFromFile(const char* path, const std::string& directory);
+	// stb_image style vertical flip applied to every texture loaded after this call (cached separately per orientation)
+	void setFlipVerticallyOnLoad(bool flip);
+	bool getFlipVerticallyOnLoad();
+	// when set, textureFromFile hands 2D textures to the streamer instead of uploading the whole image at once
+	void setTextureStreamer(TextureStreamer* streamer);
 	float randomFloat(float min, float max);
 	GLuint loadCubemap(std::vector<std::string> faces);
 	GLuint loadCubemap(std::string folder);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "Shader.h"
+
+// Weighted blended order independent transparency (McGuire and Bavoil 2013). Transparent surfaces are drawn in any
+// order into an RGBA16F accumulation target (premultiplied color * weight, alpha * weight, summed) and an R8 revealage
+// target (product of 1 - alpha), with the scene's depth buffer attached for testing only. composite() then blends the
+// weighted average color over the opaque image by 1 - revealage.
+// The targets are the render graph's transient textures, in these formats.
+class WeightedOIT {
+public:
+	static constexpr GLenum ACCUMULATION_FORMAT = GL_RGBA16F;
+	static constexpr GLenum REVEALAGE_FORMAT = GL_R8;
+
+	WeightedOIT();
+	~WeightedOIT();
+	WeightedOIT(const WeightedOIT&) = delete;
+	WeightedOIT& operator=(const WeightedOIT&) = delete;
+
+	// clears framebuffer's targets (accumulation on color attachment 0, revealage on 1, the opaque depth attached) and
+	// sets up blending, draw the transparent geometry with an oitAccumulateFS shader afterwards. end() restores the
+	// usual blend state and depth writes
+	void begin(GLuint framebuffer);
+	void end();
+
+	// blends the result over whatever framebuffer is bound, from a fullscreen triangle (fullscreenTriangleVS.glsl)
+	void composite(Shader& compositeShader, GLuint accumulation, GLuint revealage);
+
+private:
+	GLuint emptyVAO = 0;
+};
@@ -0,0 +1,88 @@
+#version 460 core
+layout (local_size_x = 128) in;
+
+// one invocation per cluster: tests every light's sphere against the cluster's view space box and lists the ones
+// touching it. the lights are brought into view space a batch at a time in shared memory, once per workgroup instead
+// of once per cluster. the lights are gone through twice, counted to take space for the list in the shared index
+// buffer and then listed into it. Clusters::assignLights is the CPU reference, see ClusteredLighting.h
+#include "clusters.glsl"
+
+uniform mat4 view;
+uniform mat4 inverseProjection;
+
+shared vec4 batch[128]; // view space position, radius
+
+vec3 rayThrough(vec2 ndc){
+    vec4 onNearPlane = inverseProjection * vec4(ndc, -1.0, 1.0);
+    return onNearPlane.xyz / onNearPlane.w;
+}
+
+// the batch of lights from first on into shared memory, synchronized by the caller
+void loadBatch(uint first){
+    uint light = first + gl_LocalInvocationIndex;
+    if (light < pointLightCount)
+        batch[gl_LocalInvocationIndex] = vec4(vec3(view * vec4(pointLights[light].position, 1.0)), pointLights[light].radius);
+}
+
+// sphere against box: distance from the center to the closest point of the box
+bool touches(vec4 light, vec3 boxMin, vec3 boxMax){
+    vec3 offset = clamp(light.xyz, boxMin, boxMax) - light.xyz;
+    return dot(offset, offset) <= light.w * light.w;
+}
+
+void main()
+{
+    uint cluster = gl_GlobalInvocationID.x;
+    bool active = cluster < CLUSTER_COUNT;
+    uvec3 coords = uvec3(cluster % CLUSTER_GRID_X, (cluster / CLUSTER_GRID_X) % CLUSTER_GRID_Y, cluster / (CLUSTER_GRID_X * CLUSTER_GRID_Y));
+
+    // the tile's corners on the near plane, pushed along their rays to the slice's depths
+    vec2 ndcMin = vec2(coords.xy) / vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y) * 2.0 - 1.0;
+    vec2 ndcMax = vec2(coords.xy + 1u) / vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y) * 2.0 - 1.0;
+    float sliceNear = clusterNear * pow(clusterFar / clusterNear, float(coords.z) / float(CLUSTER_GRID_Z));
+    float sliceFar = clusterNear * pow(clusterFar / clusterNear, float(coords.z + 1u) / float(CLUSTER_GRID_Z));
+    vec3 boxMin = vec3(1e30), boxMax = vec3(-1e30);
+    for (int corner = 0; corner < 4; corner++) {
+        vec3 ray = rayThrough(vec2((corner & 1) != 0 ? ndcMax.x : ndcMin.x, (corner & 2) != 0 ? ndcMax.y : ndcMin.y));
+        vec3 nearPoint = ray * (sliceNear / -ray.z);
+        vec3 farPoint = ray * (sliceFar / -ray.z);
+        boxMin = min(boxMin, min(nearPoint, farPoint));
+        boxMax = max(boxMax, max(nearPoint, farPoint));
+    }
+
+    uint count = 0u;
+    for (uint first = 0u; first < pointLightCount; first += 128u) {
+        loadBatch(first);
+        barrier();
+        uint batchSize = min(128u, pointLightCount - first);
+        for (uint i = 0u; active && i < batchSize; i++) {
+            if (touches(batch[i], boxMin, boxMax))
+                count++;
+        }
+        barrier();
+    }
+
+    // the list gets what's left of the space, the rest of its lights are dropped
+    uint firstIndex = 0u;
+    if (active) {
+        firstIndex = atomicAdd(listedLights, count);
+        uint room = firstIndex < MAX_CLUSTER_LIGHTS ? MAX_CLUSTER_LIGHTS - firstIndex : 0u;
+        if (count > room) {
+            count = room;
+            atomicAdd(overflowedClusters, 1u);
+        }
+        clusterRanges[cluster] = uvec2(firstIndex, count);
+    }
+
+    uint listed = 0u;
+    for (uint first = 0u; first < pointLightCount; first += 128u) {
+        loadBatch(first);
+        barrier();
+        uint batchSize = min(128u, pointLightCount - first);
+        for (uint i = 0u; active && i < batchSize && listed < count; i++) {
+            if (touches(batch[i], boxMin, boxMax))
+                clusterLights[firstIndex + listed++] = first + i;
+        }
+        barrier();
+    }
+}
@@ -0,0 +1,55 @@
+// clustered lighting, shared by the assignment pass and the shading. the grid is 16 x 9 screen tiles times 24 depth
+// slices growing exponentially from clusterNear to clusterFar, see Clusters.h (the constants have to match)
+const uint CLUSTER_GRID_X = 16u;
+const uint CLUSTER_GRID_Y = 9u;
+const uint CLUSTER_GRID_Z = 24u;
+const uint CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+const uint MAX_CLUSTER_LIGHTS = 1048576u;
+
+// position in world space, radius is where the light fades out. LightManager owns the buffer
+struct PointLight {
+    vec3 position;
+    float radius;
+    vec3 ambient;
+    float constant;
+    vec3 diffuse;
+    float linear;
+    vec3 specular;
+    float quadratic;
+};
+
+layout (std430, binding = 7) readonly buffer PointLights {
+    uint pointLightCount;
+    PointLight pointLights[];
+};
+
+// the lights of cluster c are clusterLights[clusterRanges[c].x] to [clusterRanges[c].x + clusterRanges[c].y)
+layout (std430, binding = 8) buffer ClusterRanges {
+    uvec2 clusterRanges[];
+};
+
+// the lists of all clusters one after the other, in the order the clusters took their space. listedLights is the
+// space handed out (past MAX_CLUSTER_LIGHTS once it ran out), overflowedClusters the clusters that were cut short
+layout (std430, binding = 9) buffer ClusterLights {
+    uint listedLights;
+    uint overflowedClusters;
+    uint clusterLights[];
+};
+
+uniform float clusterNear;
+uniform float clusterFar;
+
+uint clusterSlice(float viewDepth){
+    float z = log(max(viewDepth, clusterNear) / clusterNear) / log(clusterFar / clusterNear) * float(CLUSTER_GRID_Z);
+    return uint(clamp(int(z), 0, int(CLUSTER_GRID_Z) - 1));
+}
+
+uint clusterIndex(uvec3 cluster){
+    return cluster.x + CLUSTER_GRID_X * (cluster.y + CLUSTER_GRID_Y * cluster.z);
+}
+
+// cluster of a view space position, ndc is its projection
+uint clusterAt(vec3 viewPos, vec2 ndc){
+    uvec2 tile = uvec2(clamp(ivec2((ndc * 0.5 + 0.5) * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y)), ivec2(0), ivec2(CLUSTER_GRID_X - 1u, CLUSTER_GRID_Y - 1u)));
+    return clusterIndex(uvec3(tile, clusterSlice(-viewPos.z)));
+}
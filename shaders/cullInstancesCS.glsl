@@ -0,0 +1,115 @@
+#version 460 core
+layout (local_size_x = 64) in;
+
+// one draw command per visible instance, appended in whatever order the invocations finish.
+// phase 0 (main) tests every instance and queues the occluded ones, phase 1 (retest) tests the queue again against
+// the pyramid rebuilt from this frame's depth. see GPUCulling.h
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 2) readonly buffer Instances {
+    mat4 models[];
+};
+
+layout (std430, binding = 3) writeonly buffer Commands {
+    DrawCommand commands[]; // main phase: [0, instanceCount), retest phase: [instanceCount, 2 * instanceCount)
+};
+
+layout (std430, binding = 4) buffer Counts {
+    uint drawnMain;
+    uint drawnRetest;
+    uint occludedCount;
+};
+
+layout (std430, binding = 5) buffer Retest {
+    uint retestQueue[];
+};
+
+uniform uint phase;
+uniform vec4 frustumPlanes[6];
+uniform vec3 boundsCenter;   // local space box of the mesh
+uniform vec3 boundsExtent;
+uniform uint instanceCount;
+uniform uint indexCount;
+
+uniform bool occlusion;
+uniform mat4 viewProjection;
+uniform sampler2D hiZ;
+uniform int hiZLevels;
+uniform vec2 hiZUVScale; // the part of the pyramid that was rendered to (dynamic resolution)
+
+// true if the box lies behind the depth stored in the pyramid everywhere it covers on screen
+bool occluded(vec3 center, vec3 extent)
+{
+    vec2 minUV = vec2(1.0), maxUV = vec2(0.0);
+    float nearestDepth = 1.0;
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = center + extent * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = viewProjection * vec4(corner, 1.0);
+        // crosses the near plane, can't be projected reliably
+        if (clip.w <= 0.0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        minUV = min(minUV, ndc.xy * 0.5 + 0.5);
+        maxUV = max(maxUV, ndc.xy * 0.5 + 0.5);
+        nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+    }
+    minUV = clamp(minUV, 0.0, 1.0) * hiZUVScale;
+    maxUV = clamp(maxUV, 0.0, 1.0) * hiZUVScale;
+
+    // level where the box covers at most 2x2 texels
+    vec2 size = (maxUV - minUV) * vec2(textureSize(hiZ, 0));
+    int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0)))), 0, hiZLevels - 1);
+    ivec2 levelSize = textureSize(hiZ, level);
+    ivec2 minTexel = clamp(ivec2(minUV * vec2(levelSize)), ivec2(0), levelSize - 1);
+    ivec2 maxTexel = clamp(ivec2(maxUV * vec2(levelSize)), ivec2(0), levelSize - 1);
+
+    float farthest = max(max(texelFetch(hiZ, minTexel, level).r, texelFetch(hiZ, ivec2(maxTexel.x, minTexel.y), level).r),
+                         max(texelFetch(hiZ, ivec2(minTexel.x, maxTexel.y), level).r, texelFetch(hiZ, maxTexel, level).r));
+    return nearestDepth > farthest;
+}
+
+void main()
+{
+    uint instance;
+    if (phase == 0u) {
+        instance = gl_GlobalInvocationID.x;
+        if (instance >= instanceCount)
+            return;
+    }
+    else {
+        if (gl_GlobalInvocationID.x >= occludedCount)
+            return;
+        instance = retestQueue[gl_GlobalInvocationID.x];
+    }
+
+    // world space box enclosing the transformed local box
+    mat4 model = models[instance];
+    vec3 center = (model * vec4(boundsCenter, 1.0)).xyz;
+    vec3 extent = abs(model[0].xyz) * boundsExtent.x + abs(model[1].xyz) * boundsExtent.y + abs(model[2].xyz) * boundsExtent.z;
+
+    // the retest queue only holds instances that already passed the frustum test
+    if (phase == 0u) {
+        for (int i = 0; i < 6; i++) {
+            vec4 plane = frustumPlanes[i];
+            if (dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extent) < 0.0)
+                return;
+        }
+    }
+
+    if (occlusion && occluded(center, extent)) {
+        if (phase == 0u)
+            retestQueue[atomicAdd(occludedCount, 1u)] = instance;
+        return;
+    }
+
+    if (phase == 0u)
+        commands[atomicAdd(drawnMain, 1u)] = DrawCommand(indexCount, 1u, 0u, 0, instance);
+    else
+        commands[instanceCount + atomicAdd(drawnRetest, 1u)] = DrawCommand(indexCount, 1u, 0u, 0, instance);
+}
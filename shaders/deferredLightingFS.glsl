@@ -0,0 +1,37 @@
+#version 460 core
+out vec4 fragColor;
+
+// lights DeferredShading's G-buffer, one fullscreen pass. every pixel only loops over the point lights of its
+// cluster, like the forward path, and pixels nothing was drawn to are left alone
+#include "lighting.glsl"
+#include "octahedral.glsl"
+
+uniform sampler2D albedoSpecular;
+uniform sampler2D encodedNormals;
+uniform sampler2D depth;
+
+uniform mat4 inverseProjection;
+uniform vec2 renderSize; // the G-buffer's rendered region, in pixels
+uniform float shininess;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float pixelDepth = texelFetch(depth, texel, 0).r;
+    if (pixelDepth >= 1.0)
+        discard;
+
+    // view space position from the depth buffer
+    vec2 ndc = gl_FragCoord.xy / renderSize * 2.0 - 1.0;
+    vec4 position = inverseProjection * vec4(ndc, pixelDepth * 2.0 - 1.0, 1.0);
+
+    vec4 material = texelFetch(albedoSpecular, texel, 0);
+    Surface surface;
+    surface.position = position.xyz / position.w;
+    surface.normal = decodeOctahedral(texelFetch(encodedNormals, texel, 0).rg * 2.0 - 1.0);
+    surface.albedo = material.rgb;
+    surface.specular = vec3(material.a);
+    surface.shininess = shininess;
+
+    fragColor = vec4(shade(surface, ndc), 1.0);
+}
@@ -0,0 +1,7 @@
+#version 460 core
+
+// color writes are masked during the pre-pass, only depth is written. opaque geometry only, alpha tested surfaces
+// would have to sample their texture here
+void main()
+{
+}
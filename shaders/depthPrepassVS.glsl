@@ -0,0 +1,17 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+// depth only pass ahead of the opaque color pass. the color pass tests GL_LEQUAL against its depth with other
+// programs, and only invariant outputs are guaranteed to come out bit identical across programs: gl_Position is
+// invariant here and in every vertex shader the opaque pass draws with (objectVS, simpleVS, lightVS, depthTestVS),
+// all computing it from the same expression and inputs
+invariant gl_Position;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
@@ -3,8 +3,17 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
 
 out vec2 TexCoords;
+invariant gl_Position; // matches the depth pre-pass (depthPrepassVS.glsl)
 
+#ifdef GPU_CULLING
+// transforms of all instances, the culling pass puts the instance index into each command's baseInstance
+layout (std430, binding = 2) readonly buffer Instances {
+    mat4 models[];
+};
+#define model models[gl_BaseInstance]
+#else
 uniform mat4 model;
+#endif
 uniform mat4 view;
 uniform mat4 projection;
 
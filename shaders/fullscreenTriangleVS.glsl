@@ -0,0 +1,10 @@
+#version 460 core
+// one triangle covering the whole screen, no vertex buffer: draw 3 vertices with an empty vertex array bound
+out vec2 TexCoords;
+
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoords = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,45 @@
+#version 460 core
+#if defined(MATERIAL_TABLE) && defined(BINDLESS)
+#extension GL_ARB_bindless_texture : require
+#endif
+// the surface objectFS would light, written to DeferredShading's G-buffer instead: albedo and specular intensity,
+// and the view space normal octahedral encoded into two 16 bit channels. the position comes from the depth buffer
+layout (location = 0) out vec4 albedoSpecular;
+layout (location = 1) out vec2 encodedNormal;
+
+in vec3 normal;
+in vec3 fragPos;
+in vec2 texCoords;
+
+struct Material {
+#ifndef MATERIAL_TABLE
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+#endif
+
+    float shininess;
+};
+
+uniform Material material;
+
+#include "octahedral.glsl"
+
+// texture lookups
+#ifdef MATERIAL_TABLE
+#include "materialTable.glsl"
+#else
+vec4 sampleDiffuse(vec2 uv){
+    return texture(material.texture_diffuse1, uv);
+}
+
+vec4 sampleSpecular(vec2 uv){
+    return texture(material.texture_specular1, uv);
+}
+#endif
+
+void main()
+{
+    vec3 specular = vec3(sampleSpecular(texCoords));
+    albedoSpecular = vec4(vec3(sampleDiffuse(texCoords)), max(specular.r, max(specular.g, specular.b)));
+    encodedNormal = encodeOctahedral(normalize(normal)) * 0.5 + 0.5;
+}
@@ -0,0 +1,46 @@
+#version 460 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// level 0 copies the depth texture, every other level keeps the farthest depth of the texels it covers one level up
+uniform sampler2D depthTexture;
+layout (r32f, binding = 0) readonly uniform image2D sourceLevel;
+layout (r32f, binding = 1) writeonly uniform image2D destinationLevel;
+
+uniform int level;
+uniform int sourceWidth; // size of the level above
+uniform int sourceHeight;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(coord, imageSize(destinationLevel))))
+        return;
+
+    if (level == 0) {
+        imageStore(destinationLevel, coord, vec4(texelFetch(depthTexture, coord, 0).r));
+        return;
+    }
+
+    ivec2 size = ivec2(sourceWidth, sourceHeight);
+    ivec2 source = coord * 2;
+    float depth = imageLoad(sourceLevel, source).r;
+    depth = max(depth, imageLoad(sourceLevel, min(source + ivec2(1, 0), size - 1)).r);
+    depth = max(depth, imageLoad(sourceLevel, min(source + ivec2(0, 1), size - 1)).r);
+    depth = max(depth, imageLoad(sourceLevel, min(source + ivec2(1, 1), size - 1)).r);
+
+    // odd sized levels: the last row/column also covers the texels that don't have a pair
+    bool extraColumn = (size.x & 1) == 1 && source.x + 2 == size.x - 1;
+    bool extraRow = (size.y & 1) == 1 && source.y + 2 == size.y - 1;
+    if (extraColumn) {
+        depth = max(depth, imageLoad(sourceLevel, source + ivec2(2, 0)).r);
+        depth = max(depth, imageLoad(sourceLevel, min(source + ivec2(2, 1), size - 1)).r);
+    }
+    if (extraRow) {
+        depth = max(depth, imageLoad(sourceLevel, source + ivec2(0, 2)).r);
+        depth = max(depth, imageLoad(sourceLevel, min(source + ivec2(1, 2), size - 1)).r);
+    }
+    if (extraColumn && extraRow)
+        depth = max(depth, imageLoad(sourceLevel, source + ivec2(2, 2)).r);
+
+    imageStore(destinationLevel, coord, vec4(depth));
+}
@@ -1,6 +1,8 @@
 #version 460 core
 layout (location = 0) in vec3 aPos;
 
+invariant gl_Position; // matches the depth pre-pass (depthPrepassVS.glsl)
+
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
@@ -0,0 +1,150 @@
+// the scene's lights, shared by the forward (objectFS) and deferred (deferredLightingFS) paths.
+// everything is in VIEW SPACE, the lights are in world space and brought over with view.
+// the lights are LightManager's buffers: a count, then the lights (point lights in clusters.glsl)
+#include "clusters.glsl"
+#include "shadows.glsl"
+
+struct DirectionalLight{
+    vec3 direction;
+    float padding0;
+    vec3 ambient;
+    float padding1;
+    vec3 diffuse;
+    float padding2;
+    vec3 specular;
+    float padding3;
+};
+
+struct SpotLight{
+    vec3 position;
+    float innerCutOff;
+    vec3 direction;
+    float outerCutOff;
+    vec3 ambient;
+    float constant;
+    vec3 diffuse;
+    float linear;
+    vec3 specular;
+    float quadratic;
+};
+
+layout (std430, binding = 10) readonly buffer SpotLights {
+    uint spotLightCount;
+    SpotLight spotLights[];
+};
+
+layout (std430, binding = 11) readonly buffer DirectionalLights {
+    uint directionalLightCount;
+    DirectionalLight directionalLights[];
+};
+
+uniform mat4 view;
+
+// what the lights need to know about the point being shaded
+struct Surface {
+    vec3 position;
+    vec3 normal;
+    vec3 albedo;
+    vec3 specular;
+    float shininess;
+};
+
+// shadowed: the first directional light is the one CascadedShadows draws shadow maps for
+vec3 calcDirLight(DirectionalLight light, Surface surface, vec3 viewDir, bool shadowed)
+{
+    vec3 lightDir = -normalize(vec3(view * vec4(light.direction, 0.0)));
+    float shadow = shadowed ? directionalShadow(surface.position, surface.normal, lightDir) : 1.0;
+
+    // diffuse shading
+    float diff = max(dot(surface.normal, lightDir), 0.0);
+
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess);
+
+    // combine results
+    vec3 ambient  = light.ambient  * surface.albedo;
+    vec3 diffuse  = light.diffuse  * diff * surface.albedo;
+    vec3 specular = light.specular * spec * surface.specular;
+
+    return (ambient + shadow * (diffuse + specular));
+}  
+
+vec3 calcPointLight(PointLight light, Surface surface, vec3 viewDir)
+{
+    vec3 lightPos = vec3(view * vec4(light.position, 1.0));
+    vec3 lightDir = normalize(lightPos - surface.position);
+
+    // diffuse shading
+    float diff = max(dot(surface.normal, lightDir), 0.0);
+
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess);
+
+    // attenuation
+    float distance = length(lightPos - surface.position);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
+    // faded out towards the radius, so the light doesn't visibly end where the clusters stop listing it
+    float fade = clamp(1.0 - pow(distance / light.radius, 4.0), 0.0, 1.0);
+    attenuation *= fade * fade;
+    
+    // combine results
+    vec3 ambient  = light.ambient  * surface.albedo;
+    vec3 diffuse  = light.diffuse  * diff * surface.albedo;
+    vec3 specular = light.specular * spec * surface.specular;
+    
+    return attenuation * (ambient + diffuse + specular);
+} 
+
+vec3 calcSpotLight(SpotLight light, Surface surface, vec3 viewDir)
+{
+    vec3 spotLightDir = normalize(-vec3(view * vec4(light.direction, 0.0)));
+    vec3 lightPos = vec3(view * vec4(light.position, 1.0));
+    vec3 fragToLightDir = normalize(lightPos - surface.position);
+
+    // diffuse shading
+    float diff = max(dot(surface.normal, fragToLightDir), 0.0);
+
+    // specular shading
+    vec3 reflectDir = reflect(-fragToLightDir, surface.normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess);
+
+    //spotlight intensity calculation
+    float theta = dot(fragToLightDir, normalize(spotLightDir));
+    float epsilon = light.innerCutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);  
+    
+
+    // attenuation
+    float distance = length(lightPos - surface.position);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
+    
+    // combine results
+    vec3 ambient  = light.ambient  * surface.albedo;
+    vec3 diffuse  = light.diffuse  * diff * surface.albedo;
+    vec3 specular = light.specular * spec * surface.specular;
+    
+    return attenuation * intensity * (ambient + diffuse + specular);
+} 
+
+// every light reaching the surface: the directional lights, the point lights of its cluster and the spot lights.
+// ndc is the surface's projected position, which picks the cluster
+vec3 shade(Surface surface, vec2 ndc)
+{
+    vec3 viewDir = normalize(-surface.position);
+    vec3 result = vec3(0.0);
+    for(uint i = 0u; i < directionalLightCount; i++){
+        result += calcDirLight(directionalLights[i], surface, viewDir, i == 0u);
+    }
+
+    uvec2 range = clusterRanges[clusterAt(surface.position, ndc)];
+    for(uint i = 0u; i < range.y; i++){
+        result += calcPointLight(pointLights[clusterLights[range.x + i]], surface, viewDir);
+    }
+
+    for(uint i = 0u; i < spotLightCount; i++){
+        result += calcSpotLight(spotLights[i], surface, viewDir);
+    }
+    return result;
+}
@@ -0,0 +1,42 @@
+// material lookup for fragment shaders compiled with MATERIAL_TABLE, see MaterialTable.h
+// entries are (handle low, handle high) with BINDLESS, (array slot, layer) otherwise.
+// minLod holds the finest resident mip level of streamed maps, sampling never goes below it
+struct MaterialEntry {
+    uvec2 diffuse;
+    uvec2 specular;
+    vec2 minLod;
+};
+
+layout (std430, binding = 1) readonly buffer MaterialBuffer {
+    MaterialEntry materials[];
+};
+
+uniform int materialIndex;
+
+#ifdef BINDLESS
+vec4 sampleMaterial(uvec2 ref, float minLod, vec2 uv){
+    if (minLod <= 0.0)
+        return texture(sampler2D(ref), uv);
+
+    float lod = max(textureQueryLod(sampler2D(ref), uv).y, minLod);
+    return textureLod(sampler2D(ref), uv, lod);
+}
+#else
+uniform sampler2DArray materialArrays[MAX_MATERIAL_ARRAYS];
+
+vec4 sampleMaterial(uvec2 ref, float minLod, vec2 uv){
+    if (minLod <= 0.0)
+        return texture(materialArrays[ref.x], vec3(uv, float(ref.y)));
+
+    float lod = max(textureQueryLod(materialArrays[ref.x], uv).y, minLod);
+    return textureLod(materialArrays[ref.x], vec3(uv, float(ref.y)), lod);
+}
+#endif
+
+vec4 sampleDiffuse(vec2 uv){
+    return sampleMaterial(materials[materialIndex].diffuse, materials[materialIndex].minLod.x, uv);
+}
+
+vec4 sampleSpecular(vec2 uv){
+    return sampleMaterial(materials[materialIndex].specular, materials[materialIndex].minLod.y, uv);
+}
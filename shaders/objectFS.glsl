@@ -1,4 +1,7 @@
 #version 460 core
+#if defined(MATERIAL_TABLE) && defined(BINDLESS)
+#extension GL_ARB_bindless_texture : require
+#endif
 out vec4 fragColor;
 
 in vec3 normal;
@@ -7,161 +10,47 @@ in vec2 texCoords;
 
 // structs
 struct Material {
+#ifndef MATERIAL_TABLE
     sampler2D texture_diffuse1;
     sampler2D texture_specular1;
+#endif
 
     float shininess;
 }; 
-  
-struct DirLight{
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight {    
-    vec3 position;
-    
-    float constant;
-    float linear;
-    float quadratic;  
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};  
-
-struct SpotLight{
-    vec3 position;
-    vec3 direction;
-    float innerCutOff;
-    float outerCutOff;
-
-    float constant;
-    float linear;
-    float quadratic;  
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
 
 //uniforms
-#define NR_POINT_LIGHTS 2  
-
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform DirLight dirLight;
-uniform SpotLight spotLight;
+// the lights, the point lights through the lists of each cluster
+#include "lighting.glsl"
 
 uniform Material material;
-uniform bool enableFlashLight;
 
 uniform mat4 model;
-uniform mat4 view;
+uniform mat4 projection;
+
+// texture lookups
+#ifdef MATERIAL_TABLE
+#include "materialTable.glsl"
+#else
+vec4 sampleDiffuse(vec2 uv){
+    return texture(material.texture_diffuse1, uv);
+}
 
-// function prototypes
-vec3 calcDirLight(DirLight light, vec3 normal, vec3 viewDir);  
-vec3 calcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);  
-vec3 calcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);  
+vec4 sampleSpecular(vec2 uv){
+    return texture(material.texture_specular1, uv);
+}
+#endif
 
 
 void main()
 {
     //------------------------- doing all calculations in VIEW SPACE -----------------------
-    // properties
-    vec3 norm = normalize(normal);
-    vec3 viewDir = normalize(-fragPos);
-
-    vec3 result = vec3(0.0);
-    
-    // phase 1: Directional lighting
-    result += calcDirLight(dirLight, norm, viewDir);
-
-    // phase 2: Point lights
-    for(int i = 0; i < NR_POINT_LIGHTS; i++){
-        result += calcPointLight(pointLights[i], norm, fragPos, viewDir);  
-    }
-
-    // phase 3: Spot light
-    if (enableFlashLight)
-        result += calcSpotLight(spotLight, norm, fragPos, viewDir);    
-    
-    fragColor = vec4(result, 1.0);
+    Surface surface;
+    surface.position = fragPos;
+    surface.normal = normalize(normal);
+    surface.albedo = vec3(sampleDiffuse(texCoords));
+    surface.specular = vec3(sampleSpecular(texCoords));
+    surface.shininess = material.shininess;
+
+    vec4 clipPos = projection * vec4(fragPos, 1.0);
+    fragColor = vec4(shade(surface, clipPos.xy / clipPos.w), 1.0);
 }
-
-vec3 calcDirLight(DirLight light, vec3 normal, vec3 viewDir)
-{
-    vec3 lightDir = -normalize(vec3(view * vec4(light.direction, 0.0)));
-
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-
-    // combine results
-    vec3 ambient  = light.ambient  * vec3(texture(material.texture_diffuse1, texCoords));
-    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.texture_diffuse1, texCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, texCoords));
-
-    return (ambient + diffuse + specular);
-}  
-
-
-vec3 calcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-    vec3 lightPos = vec3(view * vec4(light.position, 1.0));
-    vec3 lightDir = normalize(lightPos - fragPos);
-
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-
-    // attenuation
-    float distance = length(lightPos - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
-    
-    // combine results
-    vec3 ambient  = light.ambient  * vec3(texture(material.texture_diffuse1, texCoords));
-    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.texture_diffuse1, texCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, texCoords));
-    
-    return attenuation * (ambient + diffuse + specular);
-} 
-
-vec3 calcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-    vec3 spotLightDir = normalize(-vec3(view * vec4(light.direction, 0.0)));
-    vec3 lightPos = vec3(view * vec4(light.position, 1.0));
-    vec3 fragToLightDir = normalize(lightPos - fragPos);
-
-    // diffuse shading
-    float diff = max(dot(normal, fragToLightDir), 0.0);
-
-    // specular shading
-    vec3 reflectDir = reflect(-fragToLightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-
-    //spotlight intensity calculation
-    float theta = dot(fragToLightDir, normalize(spotLightDir));
-    float epsilon = light.innerCutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);  
-    
-
-    // attenuation
-    float distance = length(lightPos - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
-    
-    // combine results
-    vec3 ambient  = light.ambient  * vec3(texture(material.texture_diffuse1, texCoords));
-    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.texture_diffuse1, texCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, texCoords));
-    
-    return attenuation * intensity * (ambient + diffuse + specular);
-} 
\ No newline at end of file
@@ -6,6 +6,7 @@ layout (location = 2) in vec2 aTexCoords;
 out vec3 normal;
 out vec3 fragPos;
 out vec2 texCoords;
+invariant gl_Position; // matches the depth pre-pass (depthPrepassVS.glsl)
 
 uniform mat4 model;
 uniform mat4 view;
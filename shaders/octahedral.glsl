@@ -0,0 +1,17 @@
+// unit vectors as two values in [-1, 1]: projected onto the octahedron |x| + |y| + |z| = 1, the lower half folded
+// over the upper one (Cigolle et al. 2014, "A Survey of Efficient Representations for Independent Unit Vectors")
+vec2 signNotZero(vec2 v){
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encodeOctahedral(vec3 n){
+    vec2 p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+    return n.z >= 0.0 ? p : (1.0 - abs(p.yx)) * signNotZero(p);
+}
+
+vec3 decodeOctahedral(vec2 e){
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return normalize(n);
+}
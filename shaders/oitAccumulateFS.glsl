@@ -0,0 +1,31 @@
+#version 460 core
+#if defined(MATERIAL_TABLE) && defined(BINDLESS)
+#extension GL_ARB_bindless_texture : require
+#endif
+// weighted blended OIT, drawn with simpleVS.glsl into the targets set up by WeightedOIT::begin
+layout (location = 0) out vec4 accumulation;
+layout (location = 1) out float revealage;
+
+in vec2 texCoord;
+
+#ifdef MATERIAL_TABLE
+#include "materialTable.glsl"
+#else
+uniform sampler2D texture_diffuse1;
+
+vec4 sampleDiffuse(vec2 uv){
+	return texture(texture_diffuse1, uv);
+}
+#endif
+
+void main(){
+	vec4 color = sampleDiffuse(texCoord);
+	if(color.a <= 0.1)
+		discard;
+
+	// nearer and more opaque surfaces weigh more (McGuire and Bavoil, the depth based weight)
+	float weight = clamp(pow(min(1.0, color.a * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+
+	accumulation = vec4(color.rgb * color.a, color.a) * weight;
+	revealage = color.a;
+}
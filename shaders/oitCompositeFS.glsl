@@ -0,0 +1,22 @@
+#version 460 core
+out vec4 FragColor;
+
+// resolves WeightedOIT's targets, blended over the opaque image with (src alpha, 1 - src alpha)
+uniform sampler2D accumulation;
+uniform sampler2D revealage;
+
+void main(){
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	float revealed = texelFetch(revealage, texel, 0).r;
+	// nothing transparent covers this pixel
+	if (revealed >= 1.0)
+		discard;
+
+	vec4 accumulated = texelFetch(accumulation, texel, 0);
+	// keep the sum finite when many bright layers overflow half floats
+	if (isinf(max(max(abs(accumulated.r), abs(accumulated.g)), abs(accumulated.b))))
+		accumulated.rgb = vec3(accumulated.a);
+
+	vec3 averageColor = accumulated.rgb / max(accumulated.a, 1e-5);
+	FragColor = vec4(averageColor, 1.0 - revealed);
+}
@@ -0,0 +1,98 @@
+#version 460 core
+#define TILE_SIZE 16
+#define MAX_TILE_HALO 8
+layout (local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+// one pass of PostProcessStack: a per pixel color operation or a kernel convolution, see PostProcessStack.h
+#define PASS_COLOR 0
+#define PASS_KERNEL 1
+
+#define COLOR_INVERSE 0
+#define COLOR_GREY 1
+#define COLOR_GREY_WEIGHTED 2
+
+layout (rgba8, binding = 0) writeonly uniform image2D destination;
+uniform sampler2D source;
+uniform int imageWidth;
+uniform int imageHeight;
+
+uniform int passType;
+uniform int colorOp;
+
+// kernel weights of every pass, row by row starting at the top row
+layout (std430, binding = 6) readonly buffer Weights {
+    float weights[];
+};
+uniform int kernelWidth;
+uniform int kernelHeight;
+uniform int spacingX;
+uniform int spacingY;
+uniform int weightOffset;
+uniform bool tiled;
+
+// the workgroup's texels plus the halo its kernel reaches, each fetched once
+const int TILE_EXTENT = TILE_SIZE + 2 * MAX_TILE_HALO;
+shared vec3 tile[TILE_EXTENT][TILE_EXTENT];
+
+vec3 fetch(ivec2 texel)
+{
+    return texelFetch(source, clamp(texel, ivec2(0), ivec2(imageWidth, imageHeight) - 1), 0).rgb;
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    bool inside = texel.x < imageWidth && texel.y < imageHeight;
+
+    if (passType == PASS_COLOR) {
+        if (!inside)
+            return;
+        vec3 color = fetch(texel);
+        if (colorOp == COLOR_INVERSE)
+            color = 1.0 - color;
+        else if (colorOp == COLOR_GREY)
+            color = vec3((color.r + color.g + color.b) / 3.0);
+        else if (colorOp == COLOR_GREY_WEIGHTED)
+            color = vec3(0.2126 * color.r + 0.7152 * color.g + 0.0722 * color.b);
+        imageStore(destination, texel, vec4(color, 1.0));
+        return;
+    }
+
+    ivec2 radius = ivec2(kernelWidth, kernelHeight) / 2;
+    ivec2 spacing = ivec2(spacingX, spacingY);
+    ivec2 halo = radius * spacing;
+
+    // tap (x, y) of the kernel, y = 0 being the top row, sits at texel + (x - radius.x, radius.y - y) * spacing
+    vec3 color = vec3(0.0);
+    if (tiled) {
+        // all invocations load the tile together, so nobody returns before the barrier
+        ivec2 origin = ivec2(gl_WorkGroupID.xy) * TILE_SIZE - halo;
+        ivec2 extent = ivec2(TILE_SIZE) + 2 * halo;
+        for (int i = int(gl_LocalInvocationIndex); i < extent.x * extent.y; i += TILE_SIZE * TILE_SIZE) {
+            ivec2 local = ivec2(i % extent.x, i / extent.x);
+            tile[local.y][local.x] = fetch(origin + local);
+        }
+        barrier();
+        if (!inside)
+            return;
+
+        ivec2 center = ivec2(gl_LocalInvocationID.xy) + halo;
+        for (int y = 0; y < kernelHeight; y++) {
+            for (int x = 0; x < kernelWidth; x++) {
+                ivec2 offset = ivec2(x - radius.x, radius.y - y) * spacing;
+                color += tile[center.y + offset.y][center.x + offset.x] * weights[weightOffset + y * kernelWidth + x];
+            }
+        }
+    }
+    else {
+        if (!inside)
+            return;
+        for (int y = 0; y < kernelHeight; y++) {
+            for (int x = 0; x < kernelWidth; x++) {
+                ivec2 offset = ivec2(x - radius.x, radius.y - y) * spacing;
+                color += fetch(texel + offset) * weights[weightOffset + y * kernelWidth + x];
+            }
+        }
+    }
+    imageStore(destination, texel, vec4(color, 1.0));
+}
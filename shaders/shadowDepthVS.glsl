@@ -0,0 +1,11 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+// shadow casters into a cascade of CascadedShadows, depth only (depthPrepassFS.glsl)
+uniform mat4 model;
+uniform mat4 lightViewProjection;
+
+void main()
+{
+    gl_Position = lightViewProjection * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,37 @@
+// cascaded shadow maps of the first directional light (CascadedShadows), looked up with view space positions like
+// the rest of lighting.glsl
+#define SHADOW_CASCADES 4 // must match ShadowCascades::COUNT
+
+uniform bool shadowsEnabled;
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 shadowMatrices[SHADOW_CASCADES]; // view space to the cascade's shadow map uvs and depth
+uniform float cascadeFar[SHADOW_CASCADES]; // view depth each cascade covers up to
+uniform float cascadeTexelSize[SHADOW_CASCADES]; // world units per texel
+
+// 1 where the light reaches the point, 0 in shadow. lightDir points towards the light, like the normal in view space
+float directionalShadow(vec3 position, vec3 normal, vec3 lightDir)
+{
+    if (!shadowsEnabled)
+        return 1.0;
+
+    int cascade = 0;
+    while (cascade < SHADOW_CASCADES && -position.z > cascadeFar[cascade])
+        cascade++;
+    if (cascade == SHADOW_CASCADES)
+        return 1.0;
+
+    // normal offset: looked up a texel or two off the surface, further the more it turns away from the light
+    float grazing = 1.0 - max(dot(normal, lightDir), 0.0);
+    vec3 offsetPosition = position + normal * cascadeTexelSize[cascade] * (1.0 + 2.0 * grazing);
+    vec3 coords = (shadowMatrices[cascade] * vec4(offsetPosition, 1.0)).xyz;
+
+    // 3x3 taps, each filtered 2x2 by the hardware compare
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            lit += texture(shadowMap, vec4(coords.xy + vec2(x, y) * texel, float(cascade), coords.z));
+        }
+    }
+    return lit / 9.0;
+}
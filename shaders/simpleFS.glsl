@@ -1,12 +1,23 @@
 #version 460 core
+#if defined(MATERIAL_TABLE) && defined(BINDLESS)
+#extension GL_ARB_bindless_texture : require
+#endif
 out vec4 FragColor;
 
 in vec2 texCoord;
 
+#ifdef MATERIAL_TABLE
+#include "materialTable.glsl"
+#else
 uniform sampler2D texture_diffuse1;
 
+vec4 sampleDiffuse(vec2 uv){
+	return texture(texture_diffuse1, uv);
+}
+#endif
+
 void main(){
-	vec4 texColor = texture(texture_diffuse1, texCoord);
+	vec4 texColor = sampleDiffuse(texCoord);
 	if(texColor.a <= 0.1)
 		discard;
 
@@ -4,6 +4,7 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
 
 out vec2 texCoord;
+invariant gl_Position; // matches the depth pre-pass (depthPrepassVS.glsl)
 
 uniform mat4 model;
 uniform mat4 view;
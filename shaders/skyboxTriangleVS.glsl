@@ -0,0 +1,17 @@
+#version 460 core
+// the skybox as one fullscreen triangle on the far plane, drawn after the opaque geometry with GL_LEQUAL so only
+// pixels nothing else covered get shaded. draw 3 vertices with no vertex attributes
+out vec3 TexCoords;
+
+uniform mat4 inverseProjection;
+uniform mat3 inverseViewRotation;
+
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+    gl_Position = vec4(position, 1.0, 1.0);
+
+    // view direction through this vertex, linear across the screen so it interpolates correctly without normalizing
+    vec4 viewDirection = inverseProjection * vec4(position, 1.0, 1.0);
+    TexCoords = inverseViewRotation * (viewDirection.xyz / viewDirection.w);
+}
@@ -0,0 +1,325 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <cmath>
+
+static float surfaceArea(const Culling::AABB& box) {
+	glm::vec3 size = glm::max(box.max - box.min, glm::vec3(0.0f));
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static Culling::AABB emptyBox() {
+	return Culling::AABB{ glm::vec3(1e30f), glm::vec3(-1e30f) };
+}
+
+static bool overlaps(const Culling::AABB& a, const Culling::AABB& b) {
+	return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max));
+}
+
+// slab test, returns the entry distance or a negative value on a miss
+static float intersectRay(const Culling::AABB& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+	glm::vec3 t0 = (box.min - origin) * inverseDirection;
+	glm::vec3 t1 = (box.max - origin) * inverseDirection;
+	glm::vec3 tNear = glm::min(t0, t1);
+	glm::vec3 tFar = glm::max(t0, t1);
+	float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+	float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+	return entry <= exit ? entry : -1.0f;
+}
+
+void BVH::build(const std::vector<Culling::AABB>& boxes) {
+	this->boxes = boxes;
+	nodes.clear();
+	indices.resize(boxes.size());
+	centroids.resize(boxes.size());
+	for (uint32_t i = 0; i < boxes.size(); i++) {
+		indices[i] = i;
+		centroids[i] = boxes[i].center();
+	}
+
+	if (boxes.empty())
+		return;
+
+	nodes.reserve(2 * boxes.size());
+	nodes.push_back(Node{ {}, 0, uint32_t(boxes.size()) });
+	updateBounds(0);
+
+	// depth first with an explicit stack, degenerate scenes could otherwise recurse very deep
+	std::vector<uint32_t> stack{ 0 };
+	while (!stack.empty()) {
+		uint32_t nodeIndex = stack.back();
+		stack.pop_back();
+		subdivide(nodeIndex);
+		if (nodes[nodeIndex].count == 0) {
+			stack.push_back(nodes[nodeIndex].first + 1);
+			stack.push_back(nodes[nodeIndex].first);
+		}
+	}
+}
+
+void BVH::updateBounds(uint32_t nodeIndex) {
+	Node& node = nodes[nodeIndex];
+	node.bounds = emptyBox();
+	for (uint32_t i = node.first; i < node.first + node.count; i++) {
+		node.bounds = Culling::merge(node.bounds, boxes[indices[i]]);
+	}
+}
+
+void BVH::subdivide(uint32_t nodeIndex) {
+	Node node = nodes[nodeIndex];
+	if (node.count <= 1)
+		return;
+
+	// bin the centroids along every axis and pick the split with the lowest surface area heuristic cost
+	Culling::AABB centroidBounds = emptyBox();
+	for (uint32_t i = node.first; i < node.first + node.count; i++) {
+		centroidBounds.min = glm::min(centroidBounds.min, centroids[indices[i]]);
+		centroidBounds.max = glm::max(centroidBounds.max, centroids[indices[i]]);
+	}
+
+	float bestCost = 1e30f;
+	int bestAxis = -1, bestSplit = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		if (extent <= 0.0f)
+			continue;
+
+		Culling::AABB binBounds[SAH_BINS];
+		uint32_t binCount[SAH_BINS] = {};
+		for (auto& bounds : binBounds) bounds = emptyBox();
+
+		float scale = SAH_BINS / extent;
+		for (uint32_t i = node.first; i < node.first + node.count; i++) {
+			uint32_t index = indices[i];
+			int bin = std::min(SAH_BINS - 1, int((centroids[index][axis] - centroidBounds.min[axis]) * scale));
+			binCount[bin]++;
+			binBounds[bin] = Culling::merge(binBounds[bin], boxes[index]);
+		}
+
+		// sweep from both sides, split s puts bins [0, s) on the left
+		float leftArea[SAH_BINS - 1], rightArea[SAH_BINS - 1];
+		uint32_t leftCount[SAH_BINS - 1], rightCount[SAH_BINS - 1];
+		Culling::AABB left = emptyBox(), right = emptyBox();
+		uint32_t leftSum = 0, rightSum = 0;
+		for (int i = 0; i < SAH_BINS - 1; i++) {
+			leftSum += binCount[i];
+			left = Culling::merge(left, binBounds[i]);
+			leftCount[i] = leftSum;
+			leftArea[i] = leftSum ? surfaceArea(left) : 0.0f;
+
+			rightSum += binCount[SAH_BINS - 1 - i];
+			right = Culling::merge(right, binBounds[SAH_BINS - 1 - i]);
+			rightCount[SAH_BINS - 2 - i] = rightSum;
+			rightArea[SAH_BINS - 2 - i] = rightSum ? surfaceArea(right) : 0.0f;
+		}
+
+		for (int i = 0; i < SAH_BINS - 1; i++) {
+			float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+			if (leftCount[i] && rightCount[i] && cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i + 1;
+			}
+		}
+	}
+
+	// all centroids in one spot, nothing to split
+	if (bestAxis < 0)
+		return;
+
+	float leafCost = node.count * surfaceArea(node.bounds);
+	if (bestCost >= leafCost && node.count <= MAX_LEAF_SIZE)
+		return;
+
+	// partition the node's range by the chosen bin
+	float scale = SAH_BINS / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+	auto middle = std::partition(indices.begin() + node.first, indices.begin() + node.first + node.count, [&](uint32_t index) {
+		int bin = std::min(SAH_BINS - 1, int((centroids[index][bestAxis] - centroidBounds.min[bestAxis]) * scale));
+		return bin < bestSplit;
+	});
+	uint32_t leftCount = uint32_t(middle - indices.begin()) - node.first;
+
+	uint32_t leftChild = uint32_t(nodes.size());
+	nodes.push_back(Node{ {}, node.first, leftCount });
+	nodes.push_back(Node{ {}, node.first + leftCount, node.count - leftCount });
+	updateBounds(leftChild);
+	updateBounds(leftChild + 1);
+
+	nodes[nodeIndex].first = leftChild;
+	nodes[nodeIndex].count = 0;
+}
+
+void BVH::refit(const std::vector<Culling::AABB>& boxes) {
+	this->boxes = boxes;
+
+	// children always come after their parent, so walking backwards visits them first
+	for (size_t i = nodes.size(); i-- > 0;) {
+		Node& node = nodes[i];
+		if (node.count > 0)
+			updateBounds(uint32_t(i));
+		else
+			node.bounds = Culling::merge(nodes[node.first].bounds, nodes[node.first + 1].bounds);
+	}
+}
+
+void BVH::appendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& result) const {
+	// leaves of a subtree cover one contiguous range of indices
+	uint32_t first = nodeIndex, last = nodeIndex;
+	while (nodes[first].count == 0) first = nodes[first].first;
+	while (nodes[last].count == 0) last = nodes[last].first + 1;
+	result.insert(result.end(), indices.begin() + nodes[first].first, indices.begin() + nodes[last].first + nodes[last].count);
+}
+
+void BVH::queryFrustum(const Culling::Frustum& frustum, std::vector<uint32_t>& result) const {
+	if (nodes.empty())
+		return;
+
+	// planes a node lies completely inside of don't need testing for its children.
+	// returns the planes left to test for the box, or -1 if it's outside
+	auto classify = [&](const Culling::AABB& box, uint32_t planeMask) -> int64_t {
+		glm::vec3 center = box.center(), extent = box.extent();
+		for (int p = 0; p < Culling::Frustum::NUM_PLANES; p++) {
+			if (!(planeMask & (1u << p)))
+				continue;
+			const glm::vec4& plane = frustum.planes[p];
+			float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+			float radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+			if (distance + radius < 0.0f)
+				return -1;
+			if (distance - radius >= 0.0f)
+				planeMask &= ~(1u << p);
+		}
+		return planeMask;
+	};
+
+	const uint32_t ALL_PLANES = (1u << Culling::Frustum::NUM_PLANES) - 1;
+	std::vector<std::pair<uint32_t, uint32_t>> stack{ { 0, ALL_PLANES } }; // (node, planes left to test)
+
+	while (!stack.empty()) {
+		auto [nodeIndex, parentMask] = stack.back();
+		stack.pop_back();
+		const Node& node = nodes[nodeIndex];
+
+		int64_t planeMask = classify(node.bounds, parentMask);
+		if (planeMask < 0)
+			continue;
+
+		if (planeMask == 0) {
+			appendSubtree(nodeIndex, result);
+		}
+		else if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				if (classify(boxes[indices[i]], uint32_t(planeMask)) >= 0)
+					result.push_back(indices[i]);
+			}
+		}
+		else {
+			stack.push_back({ node.first + 1, uint32_t(planeMask) });
+			stack.push_back({ node.first, uint32_t(planeMask) });
+		}
+	}
+}
+
+void BVH::queryRange(const Culling::AABB& range, std::vector<uint32_t>& result) const {
+	if (nodes.empty())
+		return;
+
+	std::vector<uint32_t> stack{ 0 };
+	while (!stack.empty()) {
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!overlaps(node.bounds, range))
+			continue;
+
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				if (overlaps(boxes[indices[i]], range))
+					result.push_back(indices[i]);
+			}
+		}
+		else {
+			stack.push_back(node.first + 1);
+			stack.push_back(node.first);
+		}
+	}
+}
+
+void BVH::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result) const {
+	if (nodes.empty())
+		return;
+
+	auto touches = [&](const Culling::AABB& box) {
+		glm::vec3 closest = glm::clamp(center, box.min, box.max);
+		glm::vec3 offset = closest - center;
+		return glm::dot(offset, offset) <= radius * radius;
+	};
+
+	std::vector<uint32_t> stack{ 0 };
+	while (!stack.empty()) {
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!touches(node.bounds))
+			continue;
+
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				if (touches(boxes[indices[i]]))
+					result.push_back(indices[i]);
+			}
+		}
+		else {
+			stack.push_back(node.first + 1);
+			stack.push_back(node.first);
+		}
+	}
+}
+
+int BVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance, float maxDistance) const {
+	if (nodes.empty())
+		return -1;
+
+	glm::vec3 inverseDirection = 1.0f / direction;
+	int hit = -1;
+	float best = maxDistance;
+
+	// nearer child is visited first so that best shrinks quickly and prunes the rest
+	std::vector<std::pair<uint32_t, float>> stack; // (node, entry distance)
+	float rootEntry = intersectRay(nodes[0].bounds, origin, inverseDirection, best);
+	if (rootEntry >= 0.0f)
+		stack.push_back({ 0, rootEntry });
+
+	while (!stack.empty()) {
+		auto [nodeIndex, entry] = stack.back();
+		stack.pop_back();
+		if (entry > best)
+			continue;
+
+		const Node& node = nodes[nodeIndex];
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				float t = intersectRay(boxes[indices[i]], origin, inverseDirection, best);
+				if (t >= 0.0f && t < best) {
+					best = t;
+					hit = int(indices[i]);
+				}
+			}
+			continue;
+		}
+
+		float leftEntry = intersectRay(nodes[node.first].bounds, origin, inverseDirection, best);
+		float rightEntry = intersectRay(nodes[node.first + 1].bounds, origin, inverseDirection, best);
+		bool leftFirst = leftEntry >= 0.0f && (rightEntry < 0.0f || leftEntry <= rightEntry);
+		if (leftFirst) {
+			if (rightEntry >= 0.0f) stack.push_back({ node.first + 1, rightEntry });
+			stack.push_back({ node.first, leftEntry });
+		}
+		else {
+			if (leftEntry >= 0.0f) stack.push_back({ node.first, leftEntry });
+			if (rightEntry >= 0.0f) stack.push_back({ node.first + 1, rightEntry });
+		}
+	}
+
+	if (hit >= 0)
+		distance = best;
+	return hit;
+}
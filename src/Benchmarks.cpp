@@ -0,0 +1,419 @@
+#include "Benchmarks.h"
+#include "BVH.h"
+#include "TransformSystem.h"
+#include "SceneObject.h"
+#include "DepthSort.h"
+#include "Clusters.h"
+#include "ShadowCascades.h"
+#include "Camera.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/norm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Benchmarks {
+
+	// milliseconds taken by f, best of a few runs
+	template <typename F>
+	static double timeMs(F&& f, int runs = 3) {
+		double best = 1e30;
+		for (int i = 0; i < runs; i++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			f();
+			auto end = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+
+	int bvh(int count) {
+		// boxes of 0.5 to 2 units spread at roughly the density of the demo scene's cubes
+		std::mt19937 rng(1234);
+		float worldSize = 100.0f * std::cbrt(count / 500.0f);
+		std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+		std::uniform_real_distribution<float> size(0.5f, 2.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		std::vector<Culling::AABB> boxes(count);
+		for (auto& box : boxes) {
+			glm::vec3 center(position(rng), position(rng), position(rng));
+			glm::vec3 extent = glm::vec3(size(rng)) * 0.5f;
+			box = Culling::AABB{ center - extent, center + extent };
+		}
+
+		std::cout << "BVH benchmark, " << count << " boxes in a " << worldSize << " unit cube" << std::endl;
+
+		BVH bvh;
+		double buildMs = timeMs([&] { bvh.build(boxes); });
+		std::cout << "  build:   " << buildMs << " ms (" << bvh.nodeCount() << " nodes)" << std::endl;
+
+		// every box moves a little, like objects animating between frames
+		std::vector<Culling::AABB> moved = boxes;
+		for (auto& box : moved) {
+			glm::vec3 offset(unit(rng), unit(rng), unit(rng));
+			box.min += offset;
+			box.max += offset;
+		}
+		double refitMs = timeMs([&] { bvh.refit(moved); });
+		std::cout << "  refit:   " << refitMs << " ms" << std::endl;
+
+		// frustum queries from random viewpoints, compared against testing every box
+		const int frustumQueries = 64;
+		std::vector<Culling::Frustum> frustums;
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+		for (int i = 0; i < frustumQueries; i++) {
+			glm::vec3 eye(position(rng), position(rng), position(rng));
+			glm::vec3 target = eye + glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+			frustums.push_back(Culling::extractFrustum(projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f))));
+		}
+
+		std::vector<uint32_t> result;
+		size_t bvhVisible = 0;
+		double frustumMs = timeMs([&] {
+			bvhVisible = 0;
+			for (auto& frustum : frustums) {
+				result.clear();
+				bvh.queryFrustum(frustum, result);
+				bvhVisible += result.size();
+			}
+		});
+
+		Culling::BoxList list;
+		for (auto& box : moved) list.add(box);
+		std::vector<uint8_t> visibility;
+		size_t flatVisible = 0;
+		double flatMs = timeMs([&] {
+			flatVisible = 0;
+			for (auto& frustum : frustums) {
+				flatVisible += Culling::cullBoxes(frustum, list, visibility);
+			}
+		});
+
+		std::cout << "  frustum: " << frustumMs / frustumQueries << " ms/query (flat " << Culling::simdPath() << " culling: "
+			<< flatMs / frustumQueries << " ms/query), " << bvhVisible / frustumQueries << " visible on average";
+		if (bvhVisible != flatVisible)
+			std::cout << " MISMATCH (flat: " << flatVisible / frustumQueries << ")";
+		std::cout << std::endl;
+
+		// nearest hit rays
+		const int rays = 100000;
+		std::vector<std::pair<glm::vec3, glm::vec3>> rayList(rays);
+		for (auto& ray : rayList) {
+			ray.first = glm::vec3(position(rng), position(rng), position(rng));
+			ray.second = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(1e-3f));
+		}
+		int hits = 0;
+		double rayMs = timeMs([&] {
+			hits = 0;
+			for (auto& ray : rayList) {
+				float distance;
+				hits += bvh.raycast(ray.first, ray.second, distance) >= 0;
+			}
+		});
+		std::cout << "  rays:    " << rays / rayMs / 1000.0 << " Mrays/s (" << hits << " hits)" << std::endl;
+
+		// sphere range queries
+		const int rangeQueries = 10000;
+		size_t found = 0;
+		double rangeMs = timeMs([&] {
+			found = 0;
+			std::mt19937 queryRng(42);
+			for (int i = 0; i < rangeQueries; i++) {
+				result.clear();
+				bvh.querySphere(glm::vec3(position(queryRng), position(queryRng), position(queryRng)), 5.0f, result);
+				found += result.size();
+			}
+		});
+		std::cout << "  range:   " << rangeMs * 1000.0 / rangeQueries << " us/query (radius 5, " << double(found) / rangeQueries
+			<< " results on average)" << std::endl;
+
+		return 0;
+	}
+
+	int transforms(int count) {
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+		std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+		std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+		std::vector<glm::vec3> positions(count), rotations(count), scales(count);
+		for (int i = 0; i < count; i++) {
+			positions[i] = glm::vec3(position(rng), position(rng), position(rng));
+			rotations[i] = glm::vec3(angle(rng), angle(rng), angle(rng));
+			scales[i] = glm::vec3(size(rng), size(rng), size(rng));
+		}
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		std::cout << "Transform benchmark, " << count << " objects (" << TransformSystem::simdPath() << ")" << std::endl;
+
+		// what SceneObject::draw used to do for every object every frame
+		std::vector<glm::mat4> legacyModels(count);
+		std::vector<glm::mat3> legacyNormals(count);
+		double legacyMs = timeMs([&] {
+			for (int i = 0; i < count; i++) {
+				glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+				model = glm::rotate(model, glm::radians(rotations[i].x), glm::vec3(1, 0, 0));
+				model = glm::rotate(model, glm::radians(rotations[i].y), glm::vec3(0, 1, 0));
+				model = glm::rotate(model, glm::radians(rotations[i].z), glm::vec3(0, 0, 1));
+				model = glm::scale(model, scales[i]);
+				legacyModels[i] = model;
+				legacyNormals[i] = glm::transpose(glm::inverse(view * model));
+			}
+		});
+		std::cout << "  euler compose + inverse:  " << legacyMs << " ms" << std::endl;
+
+		TransformSystem transforms;
+		for (int i = 0; i < count; i++) {
+			glm::quat rotation = glm::angleAxis(glm::radians(rotations[i].x), glm::vec3(1, 0, 0))
+				* glm::angleAxis(glm::radians(rotations[i].y), glm::vec3(0, 1, 0))
+				* glm::angleAxis(glm::radians(rotations[i].z), glm::vec3(0, 0, 1));
+			transforms.create(positions[i], rotation, scales[i]);
+		}
+
+		// everything dirty, then 1% dirty, then nothing changed
+		double fullMs = timeMs([&] {
+			for (int i = 0; i < count; i++) transforms.setPosition(i, positions[i]);
+			transforms.update();
+		});
+		std::uniform_int_distribution<int> pick(0, count - 1);
+		std::vector<int> moving(std::max(1, count / 100));
+		for (int& index : moving) index = pick(rng);
+		double partialMs = timeMs([&] {
+			for (int index : moving) transforms.setPosition(index, positions[index]);
+			transforms.update();
+		});
+		double cleanMs = timeMs([&] { transforms.update(); });
+
+		// what draw does now: the view space normal matrix from the cached world space one
+		std::vector<glm::mat3> viewNormals(count);
+		glm::mat3 viewRotation(view);
+		double normalMs = timeMs([&] {
+			for (int i = 0; i < count; i++) viewNormals[i] = viewRotation * transforms.getNormalMatrix(i);
+		});
+
+		std::cout << "  update, all dirty:        " << fullMs << " ms" << std::endl;
+		std::cout << "  update, 1% dirty:         " << partialMs << " ms" << std::endl;
+		std::cout << "  update, nothing dirty:    " << cleanMs << " ms" << std::endl;
+		std::cout << "  view space normals:       " << normalMs << " ms" << std::endl;
+
+		// both paths have to agree
+		float modelError = 0.0f, normalError = 0.0f;
+		for (int i = 0; i < count; i++) {
+			for (int c = 0; c < 4; c++) {
+				for (int r = 0; r < 4; r++) {
+					modelError = std::max(modelError, std::abs(legacyModels[i][c][r] - transforms.getWorldMatrix(i)[c][r]));
+				}
+			}
+			for (int c = 0; c < 3; c++) {
+				for (int r = 0; r < 3; r++) {
+					normalError = std::max(normalError, std::abs(legacyNormals[i][c][r] - viewNormals[i][c][r]));
+				}
+			}
+		}
+		std::cout << "  max difference to the old path: model " << modelError << ", normal " << normalError << std::endl;
+		return modelError < 1e-3f && normalError < 1e-3f ? 0 : 1;
+	}
+
+	int transparentSort(int count) {
+		// foliage quads and particles scattered around the camera path
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+		TransformSystem transforms;
+		std::vector<SceneObject> objects;
+		std::vector<glm::vec3> positions(count);
+		for (int i = 0; i < count; i++) {
+			positions[i] = glm::vec3(position(rng), position(rng) * 0.1f, position(rng));
+			objects.push_back(SceneObject((Mesh*)nullptr, transforms));
+			objects.back().setPosition(positions[i]);
+		}
+
+		const int frames = 120;
+		const float farDepth = 100.0f;
+		std::cout << "Transparent sort benchmark, " << count << " draws, " << frames << " frames at 60 fps" << std::endl;
+
+		// the camera circles at the given speed in units/s
+		auto cameraPath = [&](float speed) {
+			std::vector<glm::vec3> path(frames);
+			for (int frame = 0; frame < frames; frame++) {
+				float angle = speed * frame / 60.0f / 20.0f;
+				path[frame] = glm::vec3(std::sin(angle) * 20.0f, 1.5f, std::cos(angle) * 20.0f);
+			}
+			return path;
+		};
+
+		// what main used to do: swap whole SceneObjects, distances recomputed in the comparator
+		std::vector<glm::vec3> path = cameraPath(5.0f);
+		double objectMs = timeMs([&] {
+			for (auto& camera : path) {
+				std::sort(objects.begin(), objects.end(), [&](const SceneObject& a, const SceneObject& b) {
+					return glm::length2(camera - a.getPosition()) > glm::length2(camera - b.getPosition());
+				});
+			}
+		}, 1);
+		std::cout << "  std::sort over SceneObjects:  " << objectMs / frames << " ms/frame" << std::endl;
+
+		// pairs built in submission order and radix sorted every frame
+		std::vector<DepthSort::Entry> entries, scratch;
+		double radixMs = timeMs([&] {
+			for (auto& camera : path) {
+				entries.resize(count);
+				for (int i = 0; i < count; i++) {
+					entries[i] = { DepthSort::farToNearKey(glm::length(positions[i] - camera), farDepth), uint32_t(i) };
+				}
+				DepthSort::radixSort(entries, scratch);
+			}
+		}, 1);
+		std::cout << "  radix sort of pairs:          " << radixMs / frames << " ms/frame" << std::endl;
+
+		// pairs in last frame's order with new keys, insertion sorted when that's enough
+		bool sorted = true;
+		for (float speed : { 0.0f, 1.0f, 5.0f, 20.0f }) {
+			path = cameraPath(speed);
+			std::vector<uint32_t> order(count);
+			std::iota(order.begin(), order.end(), 0);
+			int coherentFrames = 0;
+			double coherentMs = timeMs([&] {
+				for (auto& camera : path) {
+					entries.resize(count);
+					for (int i = 0; i < count; i++) {
+						entries[i] = { DepthSort::farToNearKey(glm::length(positions[order[i]] - camera), farDepth), order[i] };
+					}
+					coherentFrames += DepthSort::sortCoherent(entries, scratch);
+					for (int i = 0; i < count; i++) {
+						order[i] = entries[i].index;
+					}
+				}
+			}, 1);
+			for (int i = 1; i < count; i++) {
+				sorted &= entries[i - 1].key <= entries[i].key;
+			}
+			std::cout << "  coherent sort, " << speed << " units/s:" << std::string(speed < 10.0f ? 6 : 5, ' ') << coherentMs / frames
+				<< " ms/frame (insertion sort was enough in " << coherentFrames << " of " << frames << " frames)" << std::endl;
+		}
+
+		if (!sorted)
+			std::cout << "  coherent sort left entries out of order" << std::endl;
+		return sorted ? 0 : 1;
+	}
+
+	int clusters(int count) {
+		// short ranged lights (radius about 6) spread over the view of a camera looking into the box
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> horizontal(-40.0f, 40.0f), vertical(0.0f, 20.0f), unit(0.0f, 1.0f);
+		std::vector<Clusters::PointLight> lights(count);
+		for (auto& light : lights) {
+			light.position = glm::vec3(horizontal(rng), vertical(rng), horizontal(rng));
+			light.linear = 0.7f;
+			light.quadratic = 1.8f;
+			light.diffuse = glm::vec3(unit(rng), unit(rng), unit(rng));
+			light.specular = light.diffuse;
+			light.radius = Clusters::lightRadius(light);
+		}
+
+		const float nearPlane = 0.1f, farPlane = 100.0f;
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, nearPlane, farPlane);
+		glm::mat4 inverseProjection = glm::inverse(projection);
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 10.0f, 45.0f), glm::vec3(0.0f, 8.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		std::cout << "Cluster benchmark, " << count << " lights in " << Clusters::GRID_X << " x " << Clusters::GRID_Y << " x "
+			<< Clusters::GRID_Z << " clusters" << std::endl;
+
+		std::vector<glm::uvec2> ranges;
+		std::vector<uint32_t> indices;
+		int overflowed = 0;
+		double assignMs = timeMs([&] { overflowed = Clusters::assignLights(lights, view, inverseProjection, nearPlane, farPlane, ranges, indices); });
+		int used = 0;
+		uint32_t most = 0;
+		for (const glm::uvec2& range : ranges) {
+			used += range.y > 0;
+			most = std::max(most, range.y);
+		}
+		std::cout << "  assign:  " << assignMs << " ms" << std::endl;
+		std::cout << "  " << used << " clusters with lights, " << (used ? float(indices.size()) / used : 0.0f) << " lights on average, "
+			<< most << " at most, " << indices.size() << " of " << Clusters::MAX_CLUSTER_LIGHTS << " indices used ("
+			<< overflowed << " clusters overflowing)" << std::endl;
+
+		// random points in the frustum: every light whose sphere holds the point has to be in the point's cluster,
+		// overflowing ones included. compared against every light, which is what shading without clusters loops over
+		const int points = 20000;
+		int missing = 0;
+		for (int i = 0; i < points; i++) {
+			glm::vec4 ndc(unit(rng) * 2.0f - 1.0f, unit(rng) * 2.0f - 1.0f, unit(rng) * 2.0f - 1.0f, 1.0f);
+			glm::vec4 point = inverseProjection * ndc;
+			glm::vec3 viewPosition = glm::vec3(point) / point.w;
+			int cluster = Clusters::at(viewPosition, projection, nearPlane, farPlane);
+			auto first = indices.begin() + ranges[cluster].x;
+			auto last = first + ranges[cluster].y;
+			for (int light = 0; light < count; light++) {
+				glm::vec3 center = glm::vec3(view * glm::vec4(lights[light].position, 1.0f));
+				if (glm::length(center - viewPosition) <= lights[light].radius && !std::binary_search(first, last, uint32_t(light)))
+					missing++;
+			}
+		}
+		std::cout << "  " << points << " points checked, " << missing << " lights missing from their cluster" << std::endl;
+		return missing == 0 && overflowed == 0 ? 0 : 1;
+	}
+
+	int shadows(int frames) {
+		const float nearPlane = 0.1f, shadowDistance = 60.0f;
+		const int resolution = 2048;
+		glm::mat4 lightView = ShadowCascades::lightView(glm::vec3(-0.2f, -1.0f, -0.3f));
+		std::vector<float> splits = ShadowCascades::splitDistances(nearPlane, shadowDistance);
+
+		std::cout << "Shadow cascade benchmark, " << frames << " frames at 60 fps, " << ShadowCascades::COUNT << " cascades of "
+			<< resolution << "^2, splits";
+		for (float split : splits) {
+			std::cout << " " << split;
+		}
+		std::cout << std::endl;
+
+		// walking at the camera's speed along a circle while looking around
+		Camera camera(glm::vec3(0.0f, 2.0f, 20.0f));
+		std::vector<ShadowCascades::Cascade> cascades(ShadowCascades::COUNT);
+		std::vector<int> moves(ShadowCascades::COUNT, 0);
+		int uncovered = 0;
+		double fitMs = 0.0;
+		for (int frame = 0; frame < frames; frame++) {
+			float t = frame / 60.0f;
+			camera.position = glm::vec3(20.0f * std::sin(t * 0.125f), 2.0f + std::sin(t * 0.5f), 20.0f * std::cos(t * 0.125f));
+			camera.yaw = -90.0f + 120.0f * std::sin(t * 0.3f);
+			camera.pitch = 20.0f * std::sin(t * 0.7f);
+			camera.processMouseMovement(0.0f, 0.0f);
+			CameraFrame cameraFrame = camera.getFrame(16.0f / 9.0f, nearPlane, 100.0f);
+
+			for (int i = 0; i < ShadowCascades::COUNT; i++) {
+				ShadowCascades::Cascade cascade;
+				fitMs += timeMs([&] { cascade = ShadowCascades::fit(cameraFrame, splits[i], splits[i + 1], lightView, resolution, frame ? &cascades[i] : nullptr); }, 1);
+				if (frame > 0 && !(cascade == cascades[i]))
+					moves[i]++;
+				cascades[i] = cascade;
+
+				glm::vec3 corners[8];
+				ShadowCascades::sliceCorners(cameraFrame, splits[i], splits[i + 1], corners);
+				for (const glm::vec3& corner : corners) {
+					glm::vec4 clip = cascade.viewProjection * glm::vec4(corner, 1.0f);
+					if (glm::any(glm::greaterThan(glm::abs(glm::vec3(clip)), glm::vec3(1.0001f))))
+						uncovered++;
+				}
+			}
+		}
+
+		std::cout << "  fit:  " << fitMs / frames << " ms per frame" << std::endl;
+		for (int i = 0; i < ShadowCascades::COUNT; i++) {
+			std::cout << "  cascade " << i << ": " << cascades[i].texelSize << " units per texel, moved in " << moves[i]
+				<< " of " << frames << " frames" << std::endl;
+		}
+		std::cout << "  " << uncovered << " frustum corners outside of their cascade" << std::endl;
+		return uncovered == 0 ? 0 : 1;
+	}
+}
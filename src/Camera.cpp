@@ -27,10 +27,29 @@ void Camera::updateCameraVectors() {
     right = glm::normalize(glm::cross(front, worldUp));  // normalize the vector, because its length gets closer to 0 the more you look up or down which results in slower movement.
 }
 
-glm::mat4 Camera::getViewMatrix() {
+glm::mat4 Camera::getViewMatrix() const {
     return glm::lookAt(position, position + front, worldUp);
 }
 
+CameraFrame Camera::getFrame(float aspectRatio, float nearPlane, float farPlane) const {
+    CameraFrame frame;
+    frame.position = position;
+    frame.front = front;
+
+    frame.view = getViewMatrix();
+    frame.projection = glm::perspective(glm::radians(zoom), aspectRatio, nearPlane, farPlane);
+    frame.viewProjection = frame.projection * frame.view;
+
+    // the view matrix is rigid, its inverse is cheap
+    frame.inverseView = glm::mat4(glm::transpose(glm::mat3(frame.view)));
+    frame.inverseView[3] = glm::vec4(position, 1.0f);
+    frame.inverseProjection = glm::inverse(frame.projection);
+    frame.inverseViewProjection = frame.inverseView * frame.inverseProjection;
+
+    frame.frustum = Culling::extractFrustum(frame.viewProjection);
+    return frame;
+}
+
 void Camera::processKeyboard(Camera_Movement direction, float deltaTime)
 {
     float velocity = movementSpeed * deltaTime;
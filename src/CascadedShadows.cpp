@@ -0,0 +1,187 @@
+#include "CascadedShadows.h"
+#include "GPUMemory.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <string>
+
+CascadedShadows::CascadedShadows(float nearPlane, float shadowDistance) : nearPlane(nearPlane), shadowDistance(shadowDistance) {
+	const size_t bytes = GPUMemory::textureBytes(FORMAT, SIZE, SIZE, ShadowCascades::COUNT);
+
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &shadowMap);
+	glTextureStorage3D(shadowMap, 1, FORMAT, SIZE, SIZE, ShadowCascades::COUNT);
+	// linear filtering of the compare results is a free 2x2 PCF, outside of the cascade counts as lit
+	glTextureParameteri(shadowMap, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(shadowMap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(shadowMap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTextureParameteri(shadowMap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	const float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glTextureParameterfv(shadowMap, GL_TEXTURE_BORDER_COLOR, border);
+	glTextureParameteri(shadowMap, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTextureParameteri(shadowMap, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	GPUMemory::track(GL_TEXTURE, shadowMap, GPUMemory::FRAMEBUFFER, bytes, "shadow cascades");
+
+	// only ever copied from
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &staticCache);
+	glTextureStorage3D(staticCache, 1, FORMAT, SIZE, SIZE, ShadowCascades::COUNT);
+	GPUMemory::track(GL_TEXTURE, staticCache, GPUMemory::FRAMEBUFFER, bytes, "static shadow cache");
+
+	// everything lit until the first render
+	const float farDepth = 1.0f;
+	glClearTexImage(shadowMap, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+
+	glCreateFramebuffers(1, &framebuffer);
+	glNamedFramebufferDrawBuffer(framebuffer, GL_NONE);
+	glNamedFramebufferReadBuffer(framebuffer, GL_NONE);
+}
+
+CascadedShadows::~CascadedShadows() {
+	GPUMemory::untrack(GL_TEXTURE, shadowMap);
+	GPUMemory::untrack(GL_TEXTURE, staticCache);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteTextures(1, &shadowMap);
+	glDeleteTextures(1, &staticCache);
+}
+
+void CascadedShadows::setStaticCasters(const std::vector<SceneObject*>& casters) {
+	staticCasters = casters;
+	staticBoxes.clear();
+	for (SceneObject* caster : staticCasters) {
+		staticBoxes.add(caster->getWorldBounds());
+	}
+	invalidate();
+}
+
+void CascadedShadows::setDynamicCasters(const std::vector<SceneObject*>& casters) {
+	dynamicCasters = casters;
+}
+
+void CascadedShadows::invalidate() {
+	for (bool& valid : cacheValid) {
+		valid = false;
+	}
+}
+
+void CascadedShadows::update(const CameraFrame& frame, const glm::vec3& direction) {
+	// the cascades are placed in light space, a turned light starts over
+	bool lightTurned = direction != lightDirection;
+	if (lightTurned) {
+		lightDirection = direction;
+		invalidate();
+	}
+
+	glm::mat4 lightView = ShadowCascades::lightView(lightDirection);
+	std::vector<float> splits = ShadowCascades::splitDistances(nearPlane, shadowDistance);
+	for (int i = 0; i < ShadowCascades::COUNT; i++) {
+		cascades[i] = ShadowCascades::fit(frame, splits[i], splits[i + 1], lightView, SIZE, lightTurned ? nullptr : &cascades[i]);
+	}
+}
+
+void CascadedShadows::render(Shader& depthShader) {
+	int totalStaticRenders = stats.totalStaticRenders;
+	stats = Stats();
+	stats.totalStaticRenders = totalStaticRenders;
+
+	dynamicBoxes.resize(dynamicCasters.size());
+	for (size_t i = 0; i < dynamicCasters.size(); i++) {
+		dynamicBoxes.set(i, dynamicCasters[i]->getWorldBounds());
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, SIZE, SIZE);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	// casters between the light and the cascade's box are flattened onto its near plane instead of clipped
+	glEnable(GL_DEPTH_CLAMP);
+	// slope scaled bias against acne, shadows.glsl adds a normal offset on top
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 1.0f);
+	depthShader.use();
+
+	const float farDepth = 1.0f;
+	for (int i = 0; i < ShadowCascades::COUNT; i++) {
+		const ShadowCascades::Cascade& cascade = cascades[i];
+		depthShader.setMat4("lightViewProjection", cascade.viewProjection);
+		if (!cacheValid[i] || !(cachedCascades[i] == cascade)) {
+			attach(staticCache, i);
+			glClearNamedFramebufferfv(framebuffer, GL_DEPTH, 0, &farDepth);
+			cull(cascade, staticBoxes);
+			stats.staticDraws += drawVisible(depthShader, staticCasters);
+			cachedCascades[i] = cascade;
+			cacheValid[i] = true;
+			staticOnly[i] = false;
+			stats.staticRenders++;
+			stats.totalStaticRenders++;
+		}
+
+		// no dynamic caster now and none drawn over the cache last time: the shadow map still is the cache
+		size_t dynamicCount = cull(cascade, dynamicBoxes);
+		if (dynamicCount == 0 && staticOnly[i])
+			continue;
+		glCopyImageSubData(staticCache, GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, shadowMap, GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, SIZE, SIZE, 1);
+		stats.copies++;
+		staticOnly[i] = dynamicCount == 0;
+		if (dynamicCount > 0) {
+			attach(shadowMap, i);
+			stats.dynamicDraws += drawVisible(depthShader, dynamicCasters);
+		}
+	}
+
+	glBindVertexArray(0);
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glDisable(GL_DEPTH_CLAMP);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void CascadedShadows::setUniforms(Shader& shader, const CameraFrame& frame, bool enabled) const {
+	shader.use();
+	shader.setBool("shadowsEnabled", enabled);
+	// bound even when disabled, the sampler's unit can't be left to another sampler type
+	shader.setInt("shadowMap", TEXTURE_UNIT);
+	glBindTextureUnit(TEXTURE_UNIT, shadowMap);
+	if (!enabled)
+		return;
+
+	// the lit shaders work in view space, the matrices take it to the shadow map's uvs and depth
+	const glm::mat4 toTexture = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)), glm::vec3(0.5f));
+	for (int i = 0; i < ShadowCascades::COUNT; i++) {
+		std::string index = "[" + std::to_string(i) + "]";
+		shader.setMat4("shadowMatrices" + index, toTexture * cascades[i].viewProjection * frame.inverseView);
+		shader.setFloat("cascadeFar" + index, cascades[i].splitFar);
+		shader.setFloat("cascadeTexelSize" + index, cascades[i].texelSize);
+	}
+}
+
+void CascadedShadows::attach(GLuint texture, int layer) {
+	glNamedFramebufferTextureLayer(framebuffer, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+}
+
+size_t CascadedShadows::cull(const ShadowCascades::Cascade& cascade, const Culling::BoxList& boxes) {
+	// no near plane, casters towards the light still cast into the box
+	Culling::Frustum frustum = Culling::extractFrustum(cascade.viewProjection);
+	frustum.planes[Culling::Frustum::NEAR_PLANE] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	return Culling::cullBoxes(frustum, boxes, visible);
+}
+
+int CascadedShadows::drawVisible(Shader& depthShader, const std::vector<SceneObject*>& casters) {
+	int draws = 0;
+	for (size_t i = 0; i < casters.size(); i++) {
+		if (!visible[i])
+			continue;
+		depthShader.setMat4("model", casters[i]->getModelmatrix());
+		auto draw = [&](const Mesh& mesh) {
+			glBindVertexArray(mesh.getVAO());
+			mesh.drawGeometry();
+			draws++;
+		};
+		if (casters[i]->model) {
+			for (const Mesh& mesh : casters[i]->model->getMeshes()) {
+				draw(mesh);
+			}
+		}
+		else {
+			draw(*casters[i]->mesh);
+		}
+	}
+	return draws;
+}
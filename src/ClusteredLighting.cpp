@@ -0,0 +1,88 @@
+#include "ClusteredLighting.h"
+#include "GPUMemory.h"
+
+#include <algorithm>
+
+ClusteredLighting::ClusteredLighting(float nearPlane, float farPlane) : nearPlane(nearPlane), farPlane(farPlane) {
+	const size_t rangeBytes = Clusters::COUNT * sizeof(glm::uvec2);
+	const size_t indexBytes = sizeof(Counts) + size_t(Clusters::MAX_CLUSTER_LIGHTS) * sizeof(GLuint);
+	glCreateBuffers(1, &rangeBuffer);
+	glNamedBufferStorage(rangeBuffer, rangeBytes, nullptr, 0);
+	// its counts are cleared before every assign()
+	glCreateBuffers(1, &indexBuffer);
+	glNamedBufferStorage(indexBuffer, indexBytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glCreateBuffers(1, &readbackBuffer);
+	glNamedBufferStorage(readbackBuffer, sizeof(Counts), nullptr, GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+	GPUMemory::track(GL_BUFFER, rangeBuffer, GPUMemory::BUFFER, rangeBytes, "cluster light ranges");
+	GPUMemory::track(GL_BUFFER, indexBuffer, GPUMemory::BUFFER, indexBytes, "cluster light indices");
+	GPUMemory::track(GL_BUFFER, readbackBuffer, GPUMemory::BUFFER, sizeof(Counts), "cluster light readback");
+}
+
+ClusteredLighting::~ClusteredLighting() {
+	GPUMemory::untrack(GL_BUFFER, rangeBuffer);
+	GPUMemory::untrack(GL_BUFFER, indexBuffer);
+	GPUMemory::untrack(GL_BUFFER, readbackBuffer);
+	glDeleteBuffers(1, &rangeBuffer);
+	glDeleteBuffers(1, &indexBuffer);
+	glDeleteBuffers(1, &readbackBuffer);
+	if (readbackFence)
+		glDeleteSync(readbackFence);
+}
+
+void ClusteredLighting::setUniforms(Shader& shader) const {
+	shader.use();
+	shader.setFloat("clusterNear", nearPlane);
+	shader.setFloat("clusterFar", farPlane);
+}
+
+void ClusteredLighting::assign(Shader& assignShader, const CameraFrame& frame) {
+	// the space is handed out again from the start
+	const Counts zero;
+	glNamedBufferSubData(indexBuffer, 0, sizeof(Counts), &zero);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RANGE_BINDING, rangeBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEX_BINDING, indexBuffer);
+
+	assignShader.use();
+	assignShader.setFloat("clusterNear", nearPlane);
+	assignShader.setFloat("clusterFar", farPlane);
+	assignShader.setMat4("view", frame.view);
+	assignShader.setMat4("inverseProjection", frame.inverseProjection);
+	glDispatchCompute((Clusters::COUNT + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	// the lists are read by fragment shaders through the same buffers, the counts are also copied for the readback
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	if (!readbackFence) {
+		glCopyNamedBufferSubData(indexBuffer, readbackBuffer, 0, 0, sizeof(Counts));
+		readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+ClusteredLighting::Counts ClusteredLighting::listCounts() {
+	if (readbackFence && glClientWaitSync(readbackFence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+		glDeleteSync(readbackFence);
+		readbackFence = nullptr;
+		glGetNamedBufferSubData(readbackBuffer, 0, sizeof(Counts), &lastCounts);
+	}
+	return lastCounts;
+}
+
+int ClusteredLighting::verify(const CameraFrame& frame, const std::vector<Clusters::PointLight>& lights) {
+	std::vector<glm::uvec2> gpuRanges(Clusters::COUNT);
+	std::vector<uint32_t> gpuIndices(Clusters::MAX_CLUSTER_LIGHTS);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glGetNamedBufferSubData(rangeBuffer, 0, gpuRanges.size() * sizeof(glm::uvec2), gpuRanges.data());
+	glGetNamedBufferSubData(indexBuffer, sizeof(Counts), gpuIndices.size() * sizeof(uint32_t), gpuIndices.data());
+
+	std::vector<glm::uvec2> ranges;
+	std::vector<uint32_t> indices;
+	Clusters::assignLights(lights, frame.view, frame.inverseProjection, nearPlane, farPlane, ranges, indices);
+
+	// the clusters took their space in a different order on the GPU, only the lists themselves have to match
+	int mismatched = 0;
+	for (int cluster = 0; cluster < Clusters::COUNT; cluster++) {
+		glm::uvec2 range = ranges[cluster], gpuRange = gpuRanges[cluster];
+		if (range.y != gpuRange.y || (range.y > 0 && !std::equal(indices.begin() + range.x, indices.begin() + range.x + range.y, gpuIndices.begin() + gpuRange.x)))
+			mismatched++;
+	}
+	return mismatched;
+}
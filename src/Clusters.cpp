@@ -0,0 +1,91 @@
+#include "Clusters.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace Clusters {
+
+	float lightRadius(const PointLight& light, float threshold) {
+		glm::vec3 color = glm::max(light.ambient, glm::max(light.diffuse, light.specular));
+		float brightest = std::max(color.r, std::max(color.g, color.b));
+		// solve constant + linear d + quadratic d^2 = brightest / threshold
+		float c = light.constant - brightest / threshold;
+		if (c >= 0.0f)
+			return 0.0f;
+		if (light.quadratic > 0.0f)
+			return (-light.linear + std::sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) / (2.0f * light.quadratic);
+		if (light.linear > 0.0f)
+			return -c / light.linear;
+		return FLT_MAX;
+	}
+
+	int slice(float viewDepth, float nearPlane, float farPlane) {
+		float z = std::log(std::max(viewDepth, nearPlane) / nearPlane) / std::log(farPlane / nearPlane) * float(GRID_Z);
+		return std::clamp(int(z), 0, GRID_Z - 1);
+	}
+
+	int at(const glm::vec3& viewPosition, const glm::mat4& projection, float nearPlane, float farPlane) {
+		glm::vec4 clip = projection * glm::vec4(viewPosition, 1.0f);
+		glm::vec2 ndc = glm::vec2(clip) / clip.w;
+		int x = std::clamp(int((ndc.x * 0.5f + 0.5f) * GRID_X), 0, GRID_X - 1);
+		int y = std::clamp(int((ndc.y * 0.5f + 0.5f) * GRID_Y), 0, GRID_Y - 1);
+		return index(x, y, slice(-viewPosition.z, nearPlane, farPlane));
+	}
+
+	Culling::AABB bounds(int x, int y, int z, const glm::mat4& inverseProjection, float nearPlane, float farPlane) {
+		glm::vec2 ndcMin = glm::vec2(float(x) / GRID_X, float(y) / GRID_Y) * 2.0f - 1.0f;
+		glm::vec2 ndcMax = glm::vec2(float(x + 1) / GRID_X, float(y + 1) / GRID_Y) * 2.0f - 1.0f;
+		float sliceNear = nearPlane * std::pow(farPlane / nearPlane, float(z) / GRID_Z);
+		float sliceFar = nearPlane * std::pow(farPlane / nearPlane, float(z + 1) / GRID_Z);
+
+		// the tile's corners on the near plane, pushed along their rays to the slice's depths
+		Culling::AABB box{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+		for (int corner = 0; corner < 4; corner++) {
+			glm::vec2 ndc((corner & 1) ? ndcMax.x : ndcMin.x, (corner & 2) ? ndcMax.y : ndcMin.y);
+			glm::vec4 onNearPlane = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+			glm::vec3 ray = glm::vec3(onNearPlane) / onNearPlane.w;
+			for (float depth : { sliceNear, sliceFar }) {
+				glm::vec3 point = ray * (depth / -ray.z);
+				box.min = glm::min(box.min, point);
+				box.max = glm::max(box.max, point);
+			}
+		}
+		return box;
+	}
+
+	int assignLights(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& inverseProjection,
+		float nearPlane, float farPlane, std::vector<glm::uvec2>& ranges, std::vector<uint32_t>& indices) {
+		ranges.assign(COUNT, glm::uvec2(0));
+		indices.clear();
+		int overflowed = 0;
+
+		std::vector<glm::vec3> centers(lights.size());
+		for (size_t i = 0; i < lights.size(); i++) {
+			centers[i] = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+		}
+
+		for (int z = 0; z < GRID_Z; z++) {
+			for (int y = 0; y < GRID_Y; y++) {
+				for (int x = 0; x < GRID_X; x++) {
+					int cluster = index(x, y, z);
+					Culling::AABB box = bounds(x, y, z, inverseProjection, nearPlane, farPlane);
+					size_t first = indices.size();
+					for (size_t i = 0; i < lights.size(); i++) {
+						// sphere against box: distance from the center to the closest point of the box
+						glm::vec3 offset = glm::clamp(centers[i], box.min, box.max) - centers[i];
+						if (glm::dot(offset, offset) <= lights[i].radius * lights[i].radius)
+							indices.push_back(uint32_t(i));
+					}
+					// like the GPU: the list gets what's left of the space, the rest of its lights are dropped
+					if (indices.size() > size_t(MAX_CLUSTER_LIGHTS)) {
+						indices.resize(std::max(first, size_t(MAX_CLUSTER_LIGHTS)));
+						overflowed++;
+					}
+					ranges[cluster] = glm::uvec2(uint32_t(first), uint32_t(indices.size() - first));
+				}
+			}
+		}
+		return overflowed;
+	}
+}
@@ -0,0 +1,94 @@
+#include "CommandList.h"
+
+#include <algorithm>
+
+void CommandList::clear() {
+	packets.clear();
+	programs.clear();
+	meshes.clear();
+	uniforms.clear();
+	key = 0;
+	counts = Counts();
+}
+
+void CommandList::bindProgram(Shader& shader) {
+	packets.push_back({ BIND_PROGRAM, uint32_t(programs.size()) });
+	programs.push_back(&shader);
+	counts.programs++;
+}
+
+void CommandList::bindMaterial(const Mesh& mesh) {
+	packets.push_back({ BIND_MATERIAL, uint32_t(meshes.size()) });
+	meshes.push_back(&mesh);
+	counts.materials++;
+}
+
+void CommandList::bindVertexArray(GLuint vao) {
+	packets.push_back({ BIND_VERTEX_ARRAY, vao });
+	counts.vertexArrays++;
+}
+
+void CommandList::setObjectUniforms(const SceneObject::Uniforms& objectUniforms) {
+	packets.push_back({ OBJECT_UNIFORMS, uint32_t(uniforms.size()) });
+	uniforms.push_back(objectUniforms);
+	counts.uniforms++;
+}
+
+void CommandList::draw(uint64_t drawKey, const Mesh& mesh) {
+	if (counts.draws == 0)
+		key = drawKey;
+	packets.push_back({ DRAW, uint32_t(meshes.size()) });
+	meshes.push_back(&mesh);
+	counts.draws++;
+}
+
+void CommandList::Replayer::replay(std::vector<const CommandList*> lists) {
+	// slices recorded in parallel finish in any order, their keys say where they go
+	std::stable_sort(lists.begin(), lists.end(), [](const CommandList* a, const CommandList* b) { return a->key < b->key; });
+
+	program = nullptr;
+	programLocations = nullptr;
+	for (const CommandList* list : lists) {
+		if (list->counts.draws > 0)
+			replay(*list);
+	}
+	glBindVertexArray(0);
+}
+
+void CommandList::Replayer::replay(const CommandList& list) {
+	for (const Packet& packet : list.packets) {
+		switch (packet.type) {
+		case BIND_PROGRAM: {
+			program = list.programs[packet.index];
+			program->use();
+			auto it = locations.find(program->ID);
+			if (it == locations.end()) {
+				Locations found;
+				found.model = glGetUniformLocation(program->ID, "model");
+				found.normalMat = glGetUniformLocation(program->ID, "normalMat");
+				found.lightColor = glGetUniformLocation(program->ID, "lightColor");
+				it = locations.emplace(program->ID, found).first;
+			}
+			programLocations = &it->second;
+			break;
+		}
+		case BIND_MATERIAL:
+			list.meshes[packet.index]->bindTextures(*program);
+			break;
+		case BIND_VERTEX_ARRAY:
+			glBindVertexArray(packet.index);
+			break;
+		case OBJECT_UNIFORMS: {
+			const SceneObject::Uniforms& objectUniforms = list.uniforms[packet.index];
+			glUniformMatrix4fv(programLocations->model, 1, GL_FALSE, glm::value_ptr(objectUniforms.model));
+			glUniformMatrix3fv(programLocations->normalMat, 1, GL_FALSE, glm::value_ptr(objectUniforms.normalMat));
+			if (objectUniforms.emissive)
+				glUniform3fv(programLocations->lightColor, 1, glm::value_ptr(objectUniforms.lightColor));
+			break;
+		}
+		case DRAW:
+			list.meshes[packet.index]->drawGeometry();
+			break;
+		}
+	}
+}
@@ -1,4 +1,5 @@
 #include "Cubemap.h"
+#include "GPUMemory.h"
 
 Cubemap::Cubemap(std::vector<float> vertices, GLuint texture) : texture(texture){
 	glGenVertexArrays(1, &VAO);
@@ -8,6 +9,7 @@ Cubemap::Cubemap(std::vector<float> vertices, GLuint texture) : texture(texture)
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+	GPUMemory::track(GL_BUFFER, VBO, GPUMemory::MESH, vertices.size() * sizeof(float), "skybox cube");
 
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(0));
 	glEnableVertexAttribArray(0);
@@ -15,10 +17,10 @@ Cubemap::Cubemap(std::vector<float> vertices, GLuint texture) : texture(texture)
 	glBindVertexArray(0);
 }
 
-void Cubemap::draw(Shader& shader, Camera& camera) {
+void Cubemap::draw(Shader& shader, const CameraFrame& frame) {
 	shader.use();
 
-	glm::mat4 view = glm::mat4(glm::mat3(camera.getViewMatrix()));
+	glm::mat4 view = glm::mat4(glm::mat3(frame.view));
 	shader.setMat4("view", view);
 
 	shader.setInt("skybox", 0);
@@ -33,6 +35,24 @@ void Cubemap::draw(Shader& shader, Camera& camera) {
 
 }
 
+void Cubemap::drawBehindScene(Shader& shader, const CameraFrame& frame) {
+	shader.use();
+	shader.setMat4("inverseProjection", frame.inverseProjection);
+	shader.setMat3("inverseViewRotation", glm::mat3(frame.inverseView));
+	shader.setInt("skybox", 0);
+
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_FALSE);
+	// the vertex shader reads no attributes, any vertex array will do
+	glBindVertexArray(VAO);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+
+	glBindVertexArray(0);
+}
+
 void Cubemap::setTexture(GLuint texture) {
 	this->texture = texture;
 }
@@ -0,0 +1,172 @@
+#include "Culling.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULLING_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULLING_SSE
+#endif
+
+namespace Culling {
+
+	Frustum extractFrustum(const glm::mat4& m) {
+		// glm is column major, m[column][row]
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		Frustum frustum;
+		frustum.planes[Frustum::LEFT] = row3 + row0;
+		frustum.planes[Frustum::RIGHT] = row3 - row0;
+		frustum.planes[Frustum::BOTTOM] = row3 + row1;
+		frustum.planes[Frustum::TOP] = row3 - row1;
+		frustum.planes[Frustum::NEAR_PLANE] = row3 + row2;
+		frustum.planes[Frustum::FAR_PLANE] = row3 - row2;
+
+		for (glm::vec4& plane : frustum.planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+
+	AABB transformAABB(const AABB& box, const glm::mat4& transform) {
+		glm::vec3 center = glm::vec3(transform * glm::vec4(box.center(), 1.0f));
+		glm::vec3 extent = box.extent();
+
+		glm::vec3 newExtent(0.0f);
+		for (int column = 0; column < 3; column++) {
+			newExtent += glm::abs(glm::vec3(transform[column])) * extent[column];
+		}
+		return AABB{ center - newExtent, center + newExtent };
+	}
+
+	AABB merge(const AABB& a, const AABB& b) {
+		return AABB{ glm::min(a.min, b.min), glm::max(a.max, b.max) };
+	}
+
+	void BoxList::clear() {
+		centerX.clear(); centerY.clear(); centerZ.clear();
+		extentX.clear(); extentY.clear(); extentZ.clear();
+	}
+
+	void BoxList::add(const AABB& box) {
+		glm::vec3 center = box.center();
+		glm::vec3 extent = box.extent();
+		centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+		extentX.push_back(extent.x); extentY.push_back(extent.y); extentZ.push_back(extent.z);
+	}
+
+	void BoxList::resize(size_t count) {
+		centerX.resize(count); centerY.resize(count); centerZ.resize(count);
+		extentX.resize(count); extentY.resize(count); extentZ.resize(count);
+	}
+
+	void BoxList::set(size_t index, const AABB& box) {
+		glm::vec3 center = box.center();
+		glm::vec3 extent = box.extent();
+		centerX[index] = center.x; centerY[index] = center.y; centerZ[index] = center.z;
+		extentX[index] = extent.x; extentY[index] = extent.y; extentZ[index] = extent.z;
+	}
+
+	// a box is outside a plane when even its corner furthest along the plane normal is behind it:
+	// dot(n, c) + dot(|n|, e) + w < 0
+	size_t cullBoxes(const Frustum& frustum, const BoxList& boxes, std::vector<uint8_t>& visible) {
+		visible.resize(boxes.size());
+		return cullBoxRange(frustum, boxes, visible, 0, boxes.size());
+	}
+
+	size_t cullBoxes(const Frustum& frustum, const BoxList& boxes, std::vector<uint8_t>& visible, JobSystem& jobs) {
+		// multiple of 8, the AVX path's width
+		const size_t GRAIN = 4096;
+		visible.resize(boxes.size());
+		std::atomic<size_t> visibleCount = 0;
+		jobs.parallelFor(boxes.size(), GRAIN, [&](size_t first, size_t last) {
+			visibleCount += cullBoxRange(frustum, boxes, visible, first, last);
+		});
+		return visibleCount;
+	}
+
+	size_t cullBoxRange(const Frustum& frustum, const BoxList& boxes, std::vector<uint8_t>& visible, size_t first, size_t last) {
+		size_t visibleCount = 0;
+		size_t i = first;
+
+#if defined(CULLING_AVX)
+		for (; i + 8 <= last; i += 8) {
+			__m256 cx = _mm256_loadu_ps(&boxes.centerX[i]), cy = _mm256_loadu_ps(&boxes.centerY[i]), cz = _mm256_loadu_ps(&boxes.centerZ[i]);
+			__m256 ex = _mm256_loadu_ps(&boxes.extentX[i]), ey = _mm256_loadu_ps(&boxes.extentY[i]), ez = _mm256_loadu_ps(&boxes.extentZ[i]);
+
+			__m256 outside = _mm256_setzero_ps();
+			for (const glm::vec4& plane : frustum.planes) {
+				__m256 distance = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)), _mm256_mul_ps(cy, _mm256_set1_ps(plane.y))),
+					_mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+				__m256 radius = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(std::abs(plane.x))), _mm256_mul_ps(ey, _mm256_set1_ps(std::abs(plane.y)))),
+					_mm256_mul_ps(ez, _mm256_set1_ps(std::abs(plane.z))));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+			}
+
+			int mask = _mm256_movemask_ps(outside);
+			for (int lane = 0; lane < 8; lane++) {
+				visible[i + lane] = (mask >> lane) & 1 ? 0 : 1;
+				visibleCount += visible[i + lane];
+			}
+		}
+#elif defined(CULLING_SSE)
+		for (; i + 4 <= last; i += 4) {
+			__m128 cx = _mm_loadu_ps(&boxes.centerX[i]), cy = _mm_loadu_ps(&boxes.centerY[i]), cz = _mm_loadu_ps(&boxes.centerZ[i]);
+			__m128 ex = _mm_loadu_ps(&boxes.extentX[i]), ey = _mm_loadu_ps(&boxes.extentY[i]), ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+			__m128 outside = _mm_setzero_ps();
+			for (const glm::vec4& plane : frustum.planes) {
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+					_mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+				__m128 radius = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::abs(plane.x))), _mm_mul_ps(ey, _mm_set1_ps(std::abs(plane.y)))),
+					_mm_mul_ps(ez, _mm_set1_ps(std::abs(plane.z))));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+			}
+
+			int mask = _mm_movemask_ps(outside);
+			for (int lane = 0; lane < 4; lane++) {
+				visible[i + lane] = (mask >> lane) & 1 ? 0 : 1;
+				visibleCount += visible[i + lane];
+			}
+		}
+#endif
+
+		// remaining boxes (or all of them without SIMD)
+		for (; i < last; i++) {
+			bool inside = true;
+			for (const glm::vec4& plane : frustum.planes) {
+				float distance = plane.x * boxes.centerX[i] + plane.y * boxes.centerY[i] + plane.z * boxes.centerZ[i] + plane.w;
+				float radius = std::abs(plane.x) * boxes.extentX[i] + std::abs(plane.y) * boxes.extentY[i] + std::abs(plane.z) * boxes.extentZ[i];
+				if (distance + radius < 0.0f) {
+					inside = false;
+					break;
+				}
+			}
+			visible[i] = inside ? 1 : 0;
+			visibleCount += visible[i];
+		}
+
+		return visibleCount;
+	}
+
+	const char* simdPath() {
+#if defined(CULLING_AVX)
+		return "AVX";
+#elif defined(CULLING_SSE)
+		return "SSE";
+#else
+		return "scalar";
+#endif
+	}
+}
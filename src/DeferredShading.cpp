@@ -0,0 +1,40 @@
+#include "DeferredShading.h"
+
+DeferredShading::DeferredShading() {
+	// the lighting triangle is generated from gl_VertexID, core profile still wants a vertex array bound
+	glCreateVertexArrays(1, &emptyVAO);
+}
+
+DeferredShading::~DeferredShading() {
+	glDeleteVertexArrays(1, &emptyVAO);
+}
+
+void DeferredShading::begin(GLuint framebuffer) {
+	const float empty[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glClearNamedFramebufferfv(framebuffer, GL_COLOR, 0, empty);
+	glClearNamedFramebufferfv(framebuffer, GL_COLOR, 1, empty);
+	// all of it, the Hi-Z pyramid relies on the unrendered part holding the far plane
+	glClearNamedFramebufferfi(framebuffer, GL_DEPTH_STENCIL, 0, 1.0f, 0);
+}
+
+void DeferredShading::light(Shader& lightingShader, GLuint albedoSpecular, GLuint normals, GLuint depth, const CameraFrame& frame, glm::ivec2 region) {
+	lightingShader.use();
+	lightingShader.setInt("albedoSpecular", 0);
+	lightingShader.setInt("encodedNormals", 1);
+	lightingShader.setInt("depth", 2);
+	lightingShader.setMat4("inverseProjection", frame.inverseProjection);
+	lightingShader.setVec2("renderSize", glm::vec2(region));
+	glBindTextureUnit(0, albedoSpecular);
+	glBindTextureUnit(1, normals);
+	glBindTextureUnit(2, depth);
+
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+
+	glBindTextureUnit(0, 0);
+	glBindTextureUnit(1, 0);
+	glBindTextureUnit(2, 0);
+}
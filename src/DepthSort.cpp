@@ -0,0 +1,77 @@
+#include "DepthSort.h"
+
+#include <algorithm>
+
+namespace DepthSort {
+
+	uint32_t farToNearKey(float distance, float farDepth) {
+		float depth = std::clamp(distance / farDepth, 0.0f, 1.0f);
+		return uint32_t((1.0f - depth) * 4294967040.0f); // largest float below 2^32
+	}
+
+	void radixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch) {
+		size_t count = entries.size();
+		if (count < 2)
+			return;
+		scratch.resize(count);
+
+		// histograms of all 4 bytes in one read
+		size_t histograms[4][256] = {};
+		for (auto& entry : entries) {
+			for (int byte = 0; byte < 4; byte++) {
+				histograms[byte][(entry.key >> (byte * 8)) & 0xFF]++;
+			}
+		}
+
+		for (int byte = 0; byte < 4; byte++) {
+			size_t* histogram = histograms[byte];
+			if (histogram[(entries[0].key >> (byte * 8)) & 0xFF] == count)
+				continue;
+
+			size_t offset = 0;
+			for (int digit = 0; digit < 256; digit++) {
+				size_t bucket = histogram[digit];
+				histogram[digit] = offset;
+				offset += bucket;
+			}
+			for (auto& entry : entries) {
+				scratch[histogram[(entry.key >> (byte * 8)) & 0xFF]++] = entry;
+			}
+			entries.swap(scratch);
+		}
+	}
+
+	bool insertionSort(std::vector<Entry>& entries, size_t maxMoves) {
+		size_t moves = 0;
+		for (size_t i = 1; i < entries.size(); i++) {
+			Entry entry = entries[i];
+			size_t j = i;
+			while (j > 0 && entries[j - 1].key > entry.key) {
+				entries[j] = entries[j - 1];
+				j--;
+			}
+			entries[j] = entry;
+
+			moves += i - j;
+			if (moves > maxMoves)
+				return false;
+		}
+		return true;
+	}
+
+	bool sortCoherent(std::vector<Entry>& entries, std::vector<Entry>& scratch) {
+		// entries out of place against their neighbour, cheap to count and a fair guess of how far from sorted they are
+		size_t descents = 0;
+		for (size_t i = 1; i < entries.size(); i++) {
+			descents += entries[i - 1].key > entries[i].key;
+		}
+		if (descents == 0)
+			return true;
+
+		// measured against radixSort (Benchmarks::transparentSort), insertion sort stops paying off around there
+		if (descents <= entries.size() / 4 && insertionSort(entries, entries.size() * 2))
+			return true;
+		radixSort(entries, scratch);
+		return false;
+	}
+}
@@ -0,0 +1,95 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	const float SMOOTHING = 0.1f; // weight of the newest frame in the moving average
+	const float DEAD_BAND = 0.05f; // within 5% of the budget the scale is left alone
+	const float MAX_STEP = 0.05f; // largest scale change per frame, the readback lags so overshooting is easy
+}
+
+DynamicResolution::DynamicResolution(int width, int height) : width(width), height(height), renderSize(width, height) {
+	glCreateQueries(GL_TIMESTAMP, RING_SIZE, startQueries);
+	glCreateQueries(GL_TIMESTAMP, RING_SIZE, endQueries);
+}
+
+DynamicResolution::~DynamicResolution() {
+	glDeleteQueries(RING_SIZE, startQueries);
+	glDeleteQueries(RING_SIZE, endQueries);
+}
+
+void DynamicResolution::collect(int index, bool wait) {
+	if (!pending[index])
+		return;
+
+	// end is issued after start, once it's available both are
+	GLint available = GL_TRUE;
+	if (!wait)
+		glGetQueryObjectiv(endQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+
+	GLuint64 start = 0, finish = 0;
+	glGetQueryObjectui64v(startQueries[index], GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(endQueries[index], GL_QUERY_RESULT, &finish);
+	pending[index] = false;
+	adjust(float(double(finish - start) / 1e6));
+}
+
+void DynamicResolution::adjust(float milliseconds) {
+	smoothedMilliseconds = smoothedMilliseconds == 0.0f ? milliseconds : glm::mix(smoothedMilliseconds, milliseconds, SMOOTHING);
+	if (!enabled || smoothedMilliseconds <= 0.0f)
+		return;
+
+	float ratio = budgetMilliseconds / smoothedMilliseconds;
+	if (std::abs(ratio - 1.0f) < DEAD_BAND)
+		return;
+
+	// area follows the cost, the scale is per axis
+	float target = scale * std::sqrt(ratio);
+	scale = std::clamp(std::clamp(target, scale - MAX_STEP, scale + MAX_STEP), minScale, maxScale);
+	updateRenderSize();
+}
+
+void DynamicResolution::updateRenderSize() {
+	renderSize.x = std::clamp(int(std::round(width * scale)), 1, width);
+	renderSize.y = std::clamp(int(std::round(height * scale)), 1, height);
+}
+
+void DynamicResolution::resize(int width, int height) {
+	this->width = width;
+	this->height = height;
+	updateRenderSize();
+}
+
+void DynamicResolution::setScaleRange(float minScale, float maxScale) {
+	this->minScale = std::clamp(minScale, 0.1f, 1.0f);
+	this->maxScale = std::clamp(maxScale, this->minScale, 1.0f);
+	setScale(scale);
+}
+
+void DynamicResolution::setScale(float scale) {
+	this->scale = std::clamp(scale, minScale, maxScale);
+	updateRenderSize();
+}
+
+void DynamicResolution::update() {
+	// oldest first: the slot about to be reused was issued RING_SIZE frames ago and is almost certainly done, the
+	// newer ones are only taken if they already finished
+	collect(next, true);
+	for (int i = 1; i < RING_SIZE; i++) {
+		collect((next + i) % RING_SIZE, false);
+	}
+}
+
+void DynamicResolution::begin() {
+	collect(next, true);
+	glQueryCounter(startQueries[next], GL_TIMESTAMP);
+}
+
+void DynamicResolution::end() {
+	glQueryCounter(endQueries[next], GL_TIMESTAMP);
+	pending[next] = true;
+	next = (next + 1) % RING_SIZE;
+}
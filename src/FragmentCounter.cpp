@@ -0,0 +1,46 @@
+#include "FragmentCounter.h"
+
+FragmentCounter::FragmentCounter() {
+	glCreateQueries(GL_SAMPLES_PASSED, RING_SIZE, queries);
+}
+
+FragmentCounter::~FragmentCounter() {
+	glDeleteQueries(RING_SIZE, queries);
+}
+
+void FragmentCounter::collect(int index) {
+	if (!pending[index])
+		return;
+
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available) {
+		glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &result);
+		pending[index] = false;
+	}
+}
+
+void FragmentCounter::begin() {
+	// the slot was issued RING_SIZE frames ago and is almost certainly done. if not, waiting would stall: it's reused
+	// and its count lost
+	collect(next);
+	if (pending[next]) {
+		pending[next] = false;
+		droppedSamples++;
+	}
+	glBeginQuery(GL_SAMPLES_PASSED, queries[next]);
+}
+
+void FragmentCounter::end() {
+	glEndQuery(GL_SAMPLES_PASSED);
+	pending[next] = true;
+	next = (next + 1) % RING_SIZE;
+}
+
+GLuint64 FragmentCounter::latest() {
+	// oldest first, so result ends up as the newest finished one
+	for (int i = 0; i < RING_SIZE; i++) {
+		collect((next + i) % RING_SIZE);
+	}
+	return result;
+}
@@ -0,0 +1,135 @@
+#include "GPUCulling.h"
+#include "GPUMemory.h"
+
+#include <cstddef>
+#include <iostream>
+
+// std430 layout of DrawElementsIndirectCommand, written by the compute shader
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+GPUCulling::GPUCulling(Mesh& mesh) : mesh(mesh) {
+	if (!mesh.isIndexed())
+		std::cout << "ERROR::GPU_CULLING:: mesh has no index buffer, nothing will be drawn" << std::endl;
+
+	glCreateBuffers(1, &countBuffer);
+	glNamedBufferStorage(countBuffer, sizeof(Counts), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glCreateBuffers(1, &readbackBuffer);
+	glNamedBufferStorage(readbackBuffer, sizeof(Counts), nullptr, GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+	GPUMemory::track(GL_BUFFER, countBuffer, GPUMemory::BUFFER, sizeof(Counts), "gpu culling counts");
+	GPUMemory::track(GL_BUFFER, readbackBuffer, GPUMemory::BUFFER, sizeof(Counts), "gpu culling readback");
+}
+
+GPUCulling::~GPUCulling() {
+	releaseBuffers();
+	GPUMemory::untrack(GL_BUFFER, countBuffer);
+	GPUMemory::untrack(GL_BUFFER, readbackBuffer);
+	glDeleteBuffers(1, &countBuffer);
+	glDeleteBuffers(1, &readbackBuffer);
+	if (readbackFence)
+		glDeleteSync(readbackFence);
+}
+
+void GPUCulling::releaseBuffers() {
+	for (GLuint* buffer : { &instanceBuffer, &commandBuffer, &retestBuffer }) {
+		if (*buffer) {
+			GPUMemory::untrack(GL_BUFFER, *buffer);
+			glDeleteBuffers(1, buffer);
+		}
+		*buffer = 0;
+	}
+}
+
+void GPUCulling::setInstances(const std::vector<glm::mat4>& transforms) {
+	releaseBuffers();
+	instances = (GLsizei)transforms.size();
+	if (instances == 0)
+		return;
+
+	// commands of the MAIN phase go in the first half of the command buffer, RETEST ones in the second
+	glCreateBuffers(1, &instanceBuffer);
+	glNamedBufferStorage(instanceBuffer, transforms.size() * sizeof(glm::mat4), transforms.data(), GL_DYNAMIC_STORAGE_BIT);
+	glCreateBuffers(1, &commandBuffer);
+	glNamedBufferStorage(commandBuffer, 2 * transforms.size() * sizeof(DrawElementsIndirectCommand), nullptr, 0);
+	glCreateBuffers(1, &retestBuffer);
+	glNamedBufferStorage(retestBuffer, transforms.size() * sizeof(GLuint), nullptr, 0);
+
+	GPUMemory::track(GL_BUFFER, instanceBuffer, GPUMemory::BUFFER, transforms.size() * sizeof(glm::mat4), "gpu culling instances");
+	GPUMemory::track(GL_BUFFER, commandBuffer, GPUMemory::BUFFER, 2 * transforms.size() * sizeof(DrawElementsIndirectCommand), "gpu culling commands");
+	GPUMemory::track(GL_BUFFER, retestBuffer, GPUMemory::BUFFER, transforms.size() * sizeof(GLuint), "gpu culling retest queue");
+}
+
+void GPUCulling::cull(Shader& cullShader, Phase phase, const Culling::Frustum& frustum, const glm::mat4& viewProjection, const HiZ* hiZ) {
+	if (instances == 0 || (phase == RETEST && !occlusionThisFrame))
+		return;
+
+	if (phase == MAIN) {
+		GLuint zero = 0;
+		glClearNamedBufferData(countBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		occlusionThisFrame = hiZ != nullptr;
+	}
+
+	cullShader.use();
+	cullShader.setUint("phase", GLuint(phase));
+	for (int i = 0; i < Culling::Frustum::NUM_PLANES; i++) {
+		cullShader.setVec4("frustumPlanes[" + std::to_string(i) + "]", frustum.planes[i]);
+	}
+	const Culling::AABB& bounds = mesh.getLocalBounds();
+	cullShader.setVec3("boundsCenter", bounds.center());
+	cullShader.setVec3("boundsExtent", bounds.extent());
+	cullShader.setUint("instanceCount", GLuint(instances));
+	cullShader.setUint("indexCount", GLuint(mesh.getIndexCount()));
+
+	cullShader.setBool("occlusion", hiZ != nullptr);
+	if (hiZ) {
+		cullShader.setMat4("viewProjection", viewProjection);
+		cullShader.setInt("hiZ", 0);
+		cullShader.setInt("hiZLevels", hiZ->getLevels());
+		cullShader.setVec2("hiZUVScale", hiZ->getUVScale());
+		glBindTextureUnit(0, hiZ->getTexture());
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNT_BINDING, countBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RETEST_BINDING, retestBuffer);
+	glDispatchCompute((instances + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	// commands and counts are read as indirect draw arguments, the counts are also copied for the readback.
+	// the retest queue is read by the RETEST dispatch
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	if (hiZ)
+		glBindTextureUnit(0, 0);
+
+	// read back once the last phase of the frame ran, and only once the previous readback arrived
+	bool lastPhase = phase == RETEST || !occlusionThisFrame;
+	if (lastPhase && !readbackFence) {
+		glCopyNamedBufferSubData(countBuffer, readbackBuffer, 0, 0, sizeof(Counts));
+		readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+void GPUCulling::draw(Shader& shader, Phase phase) {
+	if (instances == 0 || (phase == RETEST && !occlusionThisFrame))
+		return;
+
+	GLintptr commandOffset = phase == MAIN ? 0 : GLintptr(instances) * sizeof(DrawElementsIndirectCommand);
+	GLintptr countOffset = phase == MAIN ? offsetof(Counts, drawnMain) : offsetof(Counts, drawnRetest);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, instanceBuffer);
+	mesh.drawIndirectCount(shader, commandBuffer, countBuffer, instances, commandOffset, countOffset);
+}
+
+GPUCulling::Counts GPUCulling::visibleCounts() {
+	if (readbackFence && glClientWaitSync(readbackFence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+		glDeleteSync(readbackFence);
+		readbackFence = nullptr;
+		glGetNamedBufferSubData(readbackBuffer, 0, sizeof(Counts), &lastCounts);
+	}
+	return lastCounts;
+}
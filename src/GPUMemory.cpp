@@ -0,0 +1,156 @@
+#include "GPUMemory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+namespace GPUMemory {
+
+	const char* categoryNames[NUM_CATEGORIES] = { "Textures", "Cubemaps", "Meshes", "Framebuffers", "Buffers" };
+
+	struct Record {
+		Category category;
+		size_t bytes;
+		uint64_t lastUsedFrame;
+		std::function<void()> evict;
+	};
+
+	static std::unordered_map<uint64_t, Record> records;
+	static size_t categoryBytes[NUM_CATEGORIES] = {};
+	static size_t categoryCount[NUM_CATEGORIES] = {};
+	static size_t budget = size_t(2048) * 1024 * 1024;
+	static uint64_t frame = 0;
+	static size_t evictions = 0;
+	static size_t evictedBytes = 0;
+
+	static uint64_t key(GLenum identifier, GLuint name) {
+		return (uint64_t(identifier) << 32) | name;
+	}
+
+	static size_t bytesPerPixel(GLenum internalFormat) {
+		switch (internalFormat) {
+		case GL_RED: case GL_R8: case GL_STENCIL_INDEX8:
+			return 1;
+		case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16:
+			return 2;
+		case GL_RGB16F: case GL_RGBA16F: case GL_RG32F:
+			return 8;
+		case GL_RGB32F: case GL_RGBA32F:
+			return 16;
+		default: // RGB8 / RGBA8 / R32F / DEPTH24_STENCIL8 / DEPTH_COMPONENT32F / R11F_G11F_B10F ...
+			return 4;
+		}
+	}
+
+	size_t textureBytes(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers, GLsizei levels) {
+		size_t bytes = 0;
+		for (GLsizei level = 0; level < levels; level++) {
+			bytes += size_t(std::max(1, width >> level)) * std::max(1, height >> level);
+		}
+		return bytes * layers * bytesPerPixel(internalFormat);
+	}
+
+	GLsizei fullMipCount(GLsizei width, GLsizei height) {
+		return 1 + (GLsizei)std::floor(std::log2(std::max(width, height)));
+	}
+
+	void track(GLenum identifier, GLuint name, Category category, size_t bytes, const std::string& label) {
+		untrack(identifier, name);
+
+		records[key(identifier, name)] = Record{ category, bytes, frame, nullptr };
+		categoryBytes[category] += bytes;
+		categoryCount[category]++;
+
+		if (!label.empty())
+			glObjectLabel(identifier, name, (GLsizei)label.size(), label.c_str());
+	}
+
+	void untrack(GLenum identifier, GLuint name) {
+		auto it = records.find(key(identifier, name));
+		if (it == records.end())
+			return;
+
+		categoryBytes[it->second.category] -= it->second.bytes;
+		categoryCount[it->second.category]--;
+		records.erase(it);
+	}
+
+	void setEvictable(GLenum identifier, GLuint name, std::function<void()> evict) {
+		auto it = records.find(key(identifier, name));
+		if (it != records.end())
+			it->second.evict = std::move(evict);
+	}
+
+	void markUsed(GLenum identifier, GLuint name) {
+		auto it = records.find(key(identifier, name));
+		if (it != records.end())
+			it->second.lastUsedFrame = frame;
+	}
+
+	void setBudget(size_t bytes) {
+		budget = bytes;
+	}
+
+	size_t getBudget() {
+		return budget;
+	}
+
+	static size_t totalBytes() {
+		size_t total = 0;
+		for (size_t bytes : categoryBytes)
+			total += bytes;
+		return total;
+	}
+
+	void endFrame() {
+		size_t total = totalBytes();
+		if (total > budget) {
+			// least recently used first, skipping anything touched this frame
+			std::vector<std::pair<uint64_t, uint64_t>> candidates; // (last used frame, key)
+			for (auto& [objectKey, record] : records) {
+				if (record.evict && record.lastUsedFrame < frame)
+					candidates.push_back({ record.lastUsedFrame, objectKey });
+			}
+			std::sort(candidates.begin(), candidates.end());
+
+			for (auto& [lastUsed, objectKey] : candidates) {
+				if (total <= budget)
+					break;
+
+				auto it = records.find(objectKey);
+				if (it == records.end())
+					continue;
+
+				// the callback may track new objects, so take what's needed out of the record before calling it
+				std::function<void()> evict = std::move(it->second.evict);
+				size_t bytes = it->second.bytes;
+				untrack(GLenum(objectKey >> 32), GLuint(objectKey & 0xFFFFFFFFu));
+				evict();
+
+				total -= std::min(total, bytes);
+				evictions++;
+				evictedBytes += bytes;
+			}
+		}
+
+		frame++;
+	}
+
+	Stats getStats() {
+		Stats stats;
+		for (int i = 0; i < NUM_CATEGORIES; i++) {
+			stats.categoryBytes[i] = categoryBytes[i];
+			stats.categoryCount[i] = categoryCount[i];
+		}
+		for (auto& [objectKey, record] : records) {
+			if (record.evict)
+				stats.evictableBytes += record.bytes;
+		}
+		stats.totalBytes = totalBytes();
+		stats.budget = budget;
+		stats.evictions = evictions;
+		stats.evictedBytes = evictedBytes;
+		return stats;
+	}
+}
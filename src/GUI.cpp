@@ -1,7 +1,80 @@
 #include "GUI.h"
+#include "GPUMemory.h"
+#include "Culling.h"
+#include "Clusters.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
 
 namespace GUI {
 
+	// the last frame's scopes as bars, a row per nesting depth, on a CPU and a GPU track sharing one time axis
+	static void drawTimeline(const std::vector<Profiler::Scope>& scopes) {
+		float span = 0.0f;
+		int depths = 0;
+		for (auto& scope : scopes) {
+			span = std::max(span, std::max(scope.cpuEnd, scope.gpuEnd));
+			depths = std::max(depths, scope.depth + 1);
+		}
+		if (span <= 0.0f)
+			return;
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		const ImVec2 origin = ImGui::GetCursorScreenPos();
+		const float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+		const float rowHeight = ImGui::GetTextLineHeight() + 2.0f;
+		const float labelWidth = ImGui::CalcTextSize("GPU ").x;
+		const float trackHeight = depths * rowHeight + 4.0f;
+		const float scale = (width - labelWidth) / span;
+
+		for (int track = 0; track < 2; track++) {
+			bool gpu = track == 1;
+			float top = origin.y + track * trackHeight;
+			drawList->AddText(ImVec2(origin.x, top), ImGui::GetColorU32(ImGuiCol_Text), gpu ? "GPU" : "CPU");
+			for (auto& scope : scopes) {
+				float begin = gpu ? scope.gpuBegin : scope.cpuBegin;
+				float end = gpu ? scope.gpuEnd : scope.cpuEnd;
+				ImVec2 min(origin.x + labelWidth + begin * scale, top + scope.depth * rowHeight);
+				ImVec2 max(std::max(origin.x + labelWidth + end * scale, min.x + 1.0f), min.y + rowHeight - 1.0f);
+				// the same color for a scope every frame
+				float hue = float(std::hash<std::string>()(scope.name) % 360) / 360.0f;
+				drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.75f));
+				drawList->PushClipRect(min, max, true);
+				drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32(0, 0, 0, 255), scope.name.c_str());
+				drawList->PopClipRect();
+				if (ImGui::IsMouseHoveringRect(min, max))
+					ImGui::SetTooltip("%s\nCPU %.3f ms\nGPU %.3f ms", scope.name.c_str(), scope.cpuEnd - scope.cpuBegin, scope.gpuEnd - scope.gpuBegin);
+			}
+		}
+		ImGui::Dummy(ImVec2(width, 2.0f * trackHeight));
+	}
+
+	static void drawProfiler(GUISettings& settings) {
+		const Profiler& profiler = *settings.profiler;
+		const std::vector<Profiler::Scope>& scopes = profiler.getLatest();
+		if (scopes.empty()) {
+			ImGui::Text("Waiting for the first frame's timings");
+			return;
+		}
+		const Profiler::Scope& frame = scopes[0];
+		ImGui::Text("CPU %.2f ms, GPU %.2f ms, %d frames late (%d dropped)", frame.cpuEnd - frame.cpuBegin, frame.gpuEnd - frame.gpuBegin,
+			Profiler::FRAME_LATENCY, profiler.getDroppedFrames());
+		drawTimeline(scopes);
+
+		ImGui::Checkbox("GPU times in graphs", &settings.profilerGraphsGPU);
+		int newest = (profiler.getHistoryNext() + Profiler::HISTORY - 1) % Profiler::HISTORY;
+		for (auto& history : profiler.getHistories()) {
+			const float* values = settings.profilerGraphsGPU ? history.gpu : history.cpu;
+			char overlay[128];
+			snprintf(overlay, sizeof(overlay), "%s: %.3f ms", history.name.c_str(), values[newest]);
+			ImGui::PushID(history.name.c_str());
+			ImGui::PlotLines("##graph", values, Profiler::HISTORY, profiler.getHistoryNext(), overlay, 0.0f, FLT_MAX, ImVec2(-1, 40));
+			ImGui::PopID();
+		}
+	}
+
 	void initGUI(GLFWwindow* window){
 		// Setup Dear ImGui context
 		IMGUI_CHECKVERSION();
@@ -26,14 +99,110 @@ namespace GUI {
 
 		// specify UI elements
 		ImGui::Text("Frame time: %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+		if (settings.profiler && ImGui::CollapsingHeader("Profiler"))
+			drawProfiler(settings);
 		
 		if (settings.postProcessingModes)
 			ImGui::Combo("Post-Processing Mode", &settings.postProcessingMode, settings.postProcessingModes, settings.numPostProcessingModes);
 		ImGui::SliderFloat("1 / offset", &settings.convMatrixOffset, 1.0f, 5000.0f);
+		for (auto& timing : settings.postProcessTimings) {
+			ImGui::Text("  %s: %.3f ms", timing.name.c_str(), timing.milliseconds);
+		}
 		
 		if (settings.skyboxOptions)
 			ImGui::Combo("SkyBox Texture", &settings.skyboxTextureIndex, settings.skyboxOptions, settings.numSkyBoxOptions);
 
+		ImGui::Combo("Frustum Culling", &settings.cullingMode, settings.cullingModes, 4);
+		ImGui::Text("Objects: %d visible, %d culled (%s)", settings.visibleObjects, settings.culledObjects, Culling::simdPath());
+		if (settings.cullingMode == GUISettings::CULLING_GPU) {
+			ImGui::Checkbox("Hi-Z Occlusion Culling", &settings.occlusionCulling);
+			ImGui::Text("GPU culled cubes: %d visible, %d occluded", settings.gpuVisibleInstances, settings.gpuOccludedInstances);
+			if (settings.occlusionCulling)
+				ImGui::Text("Recovered by the retest: %d", settings.gpuRetestedInstances);
+		}
+		if (settings.pickedObject >= 0)
+			ImGui::Text("Picked object %d at %.2f units", settings.pickedObject, settings.pickedDistance);
+		else
+			ImGui::Text("Picked object: none");
+
+		ImGui::Combo("Transparency", &settings.transparencyMode, settings.transparencyModes, 2);
+
+		if (ImGui::CollapsingHeader("Lighting")) {
+			ImGui::Checkbox("Deferred shading", &settings.deferredShading);
+			ImGui::SliderInt("Extra point lights", &settings.extraPointLights, 0, 4096);
+			ImGui::Text("Point lights: %d in %d x %d x %d clusters", settings.pointLights, Clusters::GRID_X, Clusters::GRID_Y, Clusters::GRID_Z);
+			ImGui::Text("Light buffer: %d uploads, %.2f KB last frame", settings.lightUploads, settings.lightUploadKB);
+			ImGui::Text("Cluster lists: %d of %d indices, %d clusters overflowing", settings.clusterListedLights, Clusters::MAX_CLUSTER_LIGHTS, settings.clusterOverflows);
+			if (ImGui::Button("Check clusters against CPU"))
+				settings.checkClusters = true;
+			if (settings.clusterMismatches >= 0)
+				ImGui::Text("Last check: %d clusters differ", settings.clusterMismatches);
+			ImGui::Checkbox("Cascaded shadows", &settings.shadows);
+			ImGui::Text("Shadow caches redrawn: %d (%d in total)", settings.shadowCacheRenders, settings.shadowCacheRendersTotal);
+			ImGui::Text("Shadow draws: %d static, %d dynamic, %d cache copies", settings.shadowStaticDraws, settings.shadowDynamicDraws, settings.shadowCopies);
+		}
+
+		if (ImGui::CollapsingHeader("Dynamic Resolution")) {
+			ImGui::Checkbox("Adapt to GPU time", &settings.dynamicResolution);
+			ImGui::SliderFloat("Frame budget (ms)", &settings.frameBudgetMS, 2.0f, 33.3f);
+			ImGui::SliderFloat("Min scale", &settings.minRenderScale, 0.25f, 1.0f);
+			if (settings.dynamicResolution)
+				ImGui::Text("Scale: %.2f", settings.renderScale);
+			else
+				ImGui::SliderFloat("Scale", &settings.renderScale, settings.minRenderScale, 1.0f);
+			ImGui::SliderFloat("Upscale sharpness", &settings.upscaleSharpness, 0.0f, 1.0f);
+			ImGui::Text("Rendering %d x %d, GPU %.2f ms", settings.renderWidth, settings.renderHeight, settings.gpuFrameMS);
+		}
+
+		if (ImGui::CollapsingHeader("Overdraw")) {
+			ImGui::Checkbox("Depth pre-pass", &settings.depthPrepass);
+			ImGui::Checkbox("Skybox last", &settings.skyboxLast);
+			ImGui::Text("Opaque pass: %.2f shaded fragments per pixel", settings.opaqueFragmentsPerPixel);
+			ImGui::Text("Skybox: %.2f shaded fragments per pixel", settings.skyboxFragmentsPerPixel);
+		}
+
+		if (ImGui::CollapsingHeader("Render Queue")) {
+			ImGui::Checkbox("Sort draws", &settings.sortDraws);
+			ImGui::Text("Draws: %d, state changes: %d (submission order: %d)", settings.queueDraws, settings.queueStateChanges, settings.queueUnsortedChanges);
+			ImGui::Text("Programs %d, materials %d, vertex arrays %d", settings.queueProgramChanges, settings.queueMaterialChanges, settings.queueVAOChanges);
+			ImGui::Text("Recorded: %d command lists, %d packets", settings.queueCommandLists, settings.queuePackets);
+			if (settings.transparencyMode == GUISettings::TRANSPARENCY_SORTED)
+				ImGui::Text("Transparent sort: %s", settings.queueTransparentCoherent ? "insertion (last frame's order)" : "radix");
+			else
+				ImGui::Text("Transparent sort: none (OIT)");
+		}
+
+		if (ImGui::CollapsingHeader("Render Graph")) {
+			ImGui::Text("Passes: %d (%d culled), barriers: %d", int(settings.graphPasses.size()), settings.graphCulledPasses, settings.graphBarriers);
+			for (auto& pass : settings.graphPasses)
+				ImGui::BulletText("%s", pass.c_str());
+			ImGui::Text("Transient textures: %d on %d GL textures", settings.graphResources, settings.graphTextures);
+			ImGui::Text("Pool: %d textures, %.1f MB", settings.graphPooledTextures, settings.graphPooledMB);
+		}
+
+		if (ImGui::CollapsingHeader("Jobs")) {
+			for (size_t i = 0; i < settings.workerUtilization.size(); i++) {
+				const auto& worker = settings.workerUtilization[i];
+				char label[64];
+				if (i == 0)
+					snprintf(label, sizeof(label), "Main thread: %d jobs, %d stolen", worker.jobs, worker.steals);
+				else
+					snprintf(label, sizeof(label), "Worker %zu: %d jobs, %d stolen", i, worker.jobs, worker.steals);
+				ImGui::ProgressBar(worker.busy, ImVec2(-1, 0), label);
+			}
+		}
+
+		if (ImGui::CollapsingHeader("GPU Memory")) {
+			const float MB = 1024.0f * 1024.0f;
+			GPUMemory::Stats stats = GPUMemory::getStats();
+			for (int i = 0; i < GPUMemory::NUM_CATEGORIES; i++)
+				ImGui::Text("%-12s %8.1f MB (%zu)", GPUMemory::categoryNames[i], stats.categoryBytes[i] / MB, stats.categoryCount[i]);
+			ImGui::ProgressBar(stats.budget ? float(stats.totalBytes) / stats.budget : 0.0f, ImVec2(-1, 0));
+			ImGui::Text("Total %.1f / %.1f MB, evictable %.1f MB", stats.totalBytes / MB, stats.budget / MB, stats.evictableBytes / MB);
+			ImGui::Text("Evictions: %zu (%.1f MB)", stats.evictions, stats.evictedBytes / MB);
+			ImGui::SliderFloat("Budget (MB)", &settings.memoryBudgetMB, 64.0f, 8192.0f);
+		}
+
 		ImGui::End();
 	}
 
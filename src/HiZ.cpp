@@ -0,0 +1,74 @@
+#include "HiZ.h"
+#include "GPUMemory.h"
+
+#include <algorithm>
+
+HiZ::HiZ(int width, int height) : width(width), height(height) {
+	allocate();
+}
+
+HiZ::~HiZ() {
+	release();
+}
+
+void HiZ::resize(int width, int height) {
+	if (width == this->width && height == this->height)
+		return;
+	release();
+	this->width = width;
+	this->height = height;
+	uvScale = glm::vec2(1.0f);
+	allocate();
+}
+
+void HiZ::allocate() {
+	levels = GPUMemory::fullMipCount(width, height);
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, levels, GL_R32F, width, height);
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GPUMemory::track(GL_TEXTURE, texture, GPUMemory::FRAMEBUFFER, GPUMemory::textureBytes(GL_R32F, width, height, 1, levels), "hi-z pyramid");
+
+	// far plane everywhere until the first build, so nothing counts as occluded
+	const float farDepth = 1.0f;
+	for (int level = 0; level < levels; level++) {
+		glClearTexImage(texture, level, GL_RED, GL_FLOAT, &farDepth);
+	}
+}
+
+void HiZ::release() {
+	GPUMemory::untrack(GL_TEXTURE, texture);
+	glDeleteTextures(1, &texture);
+	texture = 0;
+}
+
+void HiZ::build(Shader& downsampleShader, GLuint depthTexture, glm::ivec2 region) {
+	uvScale = glm::vec2(region) / glm::vec2(width, height);
+
+	downsampleShader.use();
+	downsampleShader.setInt("depthTexture", 0);
+	glBindTextureUnit(0, depthTexture);
+
+	for (int level = 0; level < levels; level++) {
+		int levelWidth = std::max(1, width >> level);
+		int levelHeight = std::max(1, height >> level);
+
+		downsampleShader.setInt("level", level);
+		if (level > 0) {
+			glBindImageTexture(0, texture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+			downsampleShader.setInt("sourceWidth", std::max(1, width >> (level - 1)));
+			downsampleShader.setInt("sourceHeight", std::max(1, height >> (level - 1)));
+		}
+		glBindImageTexture(1, texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		glDispatchCompute((levelWidth + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (levelHeight + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+
+	// the pyramid is sampled by the culling shader next
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	glBindTextureUnit(0, 0);
+}
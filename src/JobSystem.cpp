@@ -0,0 +1,176 @@
+#include "JobSystem.h"
+
+namespace {
+	// index of the worker the calling thread is, the main thread (and anything that isn't a worker) is 0
+	thread_local int threadWorker = 0;
+
+	int64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+JobSystem::JobSystem(unsigned workerThreads) {
+	workers.push_back(std::make_unique<Worker>());
+	for (unsigned i = 0; i < workerThreads; i++) {
+		workers.push_back(std::make_unique<Worker>());
+	}
+	// only start them once the vector doesn't change anymore
+	for (size_t i = 1; i < workers.size(); i++) {
+		workers[i]->thread = std::thread(&JobSystem::workerLoop, this, int(i));
+	}
+	stats.resize(workers.size());
+	frameStart = std::chrono::steady_clock::now();
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+	for (auto& worker : workers) {
+		if (worker->thread.joinable())
+			worker->thread.join();
+	}
+}
+
+int JobSystem::currentWorker() const {
+	return threadWorker;
+}
+
+JobSystem::Job* JobSystem::create(std::function<void()> work, Job* parent) {
+	Worker& worker = *workers[currentWorker()];
+	Job& job = worker.storage.emplace_back();
+	job.work = std::move(work);
+	job.parent = parent;
+	if (parent)
+		parent->unfinished++;
+	unfinishedJobs++;
+	return &job;
+}
+
+void JobSystem::run(Job* job) {
+	Worker& worker = *workers[currentWorker()];
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.queue.push_back(job);
+	}
+	// under the sleep mutex, so a worker can't miss it between checking for work and going to sleep
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		queuedJobs++;
+	}
+	wakeUp.notify_one();
+}
+
+void JobSystem::wait(Job* job) {
+	int index = currentWorker();
+	while (job->unfinished > 0) {
+		if (Job* next = findJob(index))
+			execute(next, index);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const std::function<void(size_t first, size_t last)>& work) {
+	grain = std::max<size_t>(grain, 1);
+	if (count <= grain) {
+		if (count > 0)
+			work(0, count);
+		return;
+	}
+
+	Job* parent = create([] {});
+	for (size_t first = 0; first < count; first += grain) {
+		size_t last = std::min(first + grain, count);
+		run(create([&work, first, last] { work(first, last); }, parent));
+	}
+	run(parent);
+	wait(parent);
+}
+
+JobSystem::Job* JobSystem::findJob(int index) {
+	Worker& own = *workers[index];
+	{
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.queue.empty()) {
+			Job* job = own.queue.back();
+			own.queue.pop_back();
+			queuedJobs--;
+			return job;
+		}
+	}
+
+	// steal, starting after ourselves so the workers don't all go for the same victim
+	for (size_t i = 1; i < workers.size(); i++) {
+		Worker& victim = *workers[(index + i) % workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.queue.empty()) {
+			Job* job = victim.queue.front();
+			victim.queue.pop_front();
+			queuedJobs--;
+			own.steals++;
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::execute(Job* job, int index) {
+	Worker& worker = *workers[index];
+	auto start = std::chrono::steady_clock::now();
+	job->work();
+	// counted before finishing: once the frame's last job finishes endFrame reads the numbers
+	worker.busyNanoseconds += nanosecondsSince(start);
+	worker.jobs++;
+	finish(job);
+}
+
+void JobSystem::finish(Job* job) {
+	if (--job->unfinished > 0)
+		return;
+	Job* parent = job->parent;
+	unfinishedJobs--;
+	if (parent)
+		finish(parent);
+}
+
+void JobSystem::workerLoop(int index) {
+	threadWorker = index;
+	while (!stopping) {
+		if (Job* job = findJob(index)) {
+			execute(job, index);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeUp.wait(lock, [this] { return queuedJobs > 0 || stopping; });
+	}
+}
+
+void JobSystem::beginFrame() {
+	// endFrame waited for everything, nobody holds on to last frame's jobs anymore
+	for (auto& worker : workers) {
+		worker->storage.clear();
+		worker->busyNanoseconds = 0;
+		worker->jobs = 0;
+		worker->steals = 0;
+	}
+	frameStart = std::chrono::steady_clock::now();
+}
+
+void JobSystem::endFrame() {
+	while (unfinishedJobs > 0) {
+		if (Job* job = findJob(0))
+			execute(job, 0);
+		else
+			std::this_thread::yield();
+	}
+
+	double frameNanoseconds = double(std::max<int64_t>(nanosecondsSince(frameStart), 1));
+	for (size_t i = 0; i < workers.size(); i++) {
+		stats[i].utilization = float(double(workers[i]->busyNanoseconds) / frameNanoseconds);
+		stats[i].jobs = workers[i]->jobs;
+		stats[i].steals = workers[i]->steals;
+	}
+}
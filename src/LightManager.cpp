@@ -0,0 +1,164 @@
+#include "LightManager.h"
+#include "GPUMemory.h"
+
+#include <algorithm>
+#include <iostream>
+
+LightManager::LightManager() {}
+
+LightManager::~LightManager() {
+	points.release();
+	spots.release();
+	directionals.release();
+}
+
+LightManager::Handle LightManager::add(const PointLight& light) { return makeHandle(KIND_POINT, points.add(light)); }
+LightManager::Handle LightManager::add(const SpotLight& light) { return makeHandle(KIND_SPOT, spots.add(light)); }
+LightManager::Handle LightManager::add(const DirectionalLight& light) { return makeHandle(KIND_DIRECTIONAL, directionals.add(light)); }
+
+void LightManager::remove(Handle handle) {
+	switch (kindOf(handle)) {
+	case KIND_POINT: points.remove(idOf(handle)); break;
+	case KIND_SPOT: spots.remove(idOf(handle)); break;
+	case KIND_DIRECTIONAL: directionals.remove(idOf(handle)); break;
+	default: std::cout << "ERROR::LIGHT_MANAGER:: invalid handle " << handle << std::endl; break;
+	}
+}
+
+void LightManager::set(Handle handle, const PointLight& light) { points.set(idOf(handle), light); }
+void LightManager::set(Handle handle, const SpotLight& light) { spots.set(idOf(handle), light); }
+void LightManager::set(Handle handle, const DirectionalLight& light) { directionals.set(idOf(handle), light); }
+
+const LightManager::PointLight& LightManager::getPointLight(Handle handle) const { return points.lights[points.slots[idOf(handle)]]; }
+const LightManager::SpotLight& LightManager::getSpotLight(Handle handle) const { return spots.lights[spots.slots[idOf(handle)]]; }
+const LightManager::DirectionalLight& LightManager::getDirectionalLight(Handle handle) const { return directionals.lights[directionals.slots[idOf(handle)]]; }
+
+void LightManager::upload() {
+	stats = Stats();
+	points.upload(stats);
+	spots.upload(stats);
+	directionals.upload(stats);
+}
+
+template <typename T>
+uint32_t LightManager::LightArray<T>::add(const T& light) {
+	uint32_t id;
+	if (!freeIds.empty()) {
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else {
+		id = uint32_t(slots.size());
+		slots.push_back(NONE);
+	}
+	slots[id] = uint32_t(lights.size());
+	lights.push_back(light);
+	ids.push_back(id);
+	dirty.push_back(0);
+	markDirty(lights.size() - 1);
+	countDirty = true;
+	return id;
+}
+
+template <typename T>
+void LightManager::LightArray<T>::remove(uint32_t id) {
+	if (id >= slots.size() || slots[id] == NONE) {
+		std::cout << "ERROR::LIGHT_MANAGER:: " << name << ": removing a light that doesn't exist" << std::endl;
+		return;
+	}
+
+	// the last light fills the gap, only that one slot changes on the GPU
+	size_t slot = slots[id], last = lights.size() - 1;
+	if (slot != last) {
+		lights[slot] = lights[last];
+		ids[slot] = ids[last];
+		slots[ids[slot]] = uint32_t(slot);
+		markDirty(slot);
+	}
+	if (dirty[last])
+		dirtyCount--;
+	lights.pop_back();
+	ids.pop_back();
+	dirty.pop_back();
+
+	slots[id] = NONE;
+	freeIds.push_back(id);
+	countDirty = true;
+}
+
+template <typename T>
+void LightManager::LightArray<T>::set(uint32_t id, const T& light) {
+	lights[slots[id]] = light;
+	markDirty(slots[id]);
+}
+
+template <typename T>
+void LightManager::LightArray<T>::markDirty(size_t index) {
+	if (!dirty[index]) {
+		dirty[index] = 1;
+		dirtyCount++;
+	}
+}
+
+template <typename T>
+void LightManager::LightArray<T>::upload(Stats& stats) {
+	size_t count = lights.size();
+
+	// grown by doubling into a new buffer, which gets everything
+	if (!buffer || count > capacity) {
+		size_t newCapacity = std::max<size_t>(std::max(count, capacity * 2), 16);
+		release();
+		glCreateBuffers(1, &buffer);
+		glNamedBufferStorage(buffer, HEADER_BYTES + newCapacity * sizeof(T), nullptr, GL_DYNAMIC_STORAGE_BIT);
+		GPUMemory::track(GL_BUFFER, buffer, GPUMemory::BUFFER, HEADER_BYTES + newCapacity * sizeof(T), name);
+		capacity = newCapacity;
+		stats.reallocations++;
+
+		std::fill(dirty.begin(), dirty.end(), uint8_t(1));
+		dirtyCount = count;
+		countDirty = true;
+	}
+
+	if (countDirty) {
+		const GLuint header[4] = { GLuint(count), 0, 0, 0 };
+		glNamedBufferSubData(buffer, 0, HEADER_BYTES, header);
+		stats.uploads++;
+		stats.bytes += HEADER_BYTES;
+		countDirty = false;
+	}
+
+	for (size_t first = 0; dirtyCount > 0 && first < count; ) {
+		if (!dirty[first]) {
+			first++;
+			continue;
+		}
+		// the run continues over gaps of up to MERGE_GAP unchanged lights, resending them is cheaper than another call
+		size_t last = first + 1;
+		for (size_t i = last; i < count && i <= last + MERGE_GAP; i++) {
+			if (dirty[i])
+				last = i + 1;
+		}
+
+		size_t bytes = (last - first) * sizeof(T);
+		glNamedBufferSubData(buffer, GLintptr(HEADER_BYTES + first * sizeof(T)), GLsizeiptr(bytes), &lights[first]);
+		stats.uploads++;
+		stats.bytes += bytes;
+		for (size_t i = first; i < last; i++) {
+			dirtyCount -= dirty[i];
+			dirty[i] = 0;
+		}
+		first = last;
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+}
+
+template <typename T>
+void LightManager::LightArray<T>::release() {
+	if (buffer) {
+		GPUMemory::untrack(GL_BUFFER, buffer);
+		glDeleteBuffers(1, &buffer);
+	}
+	buffer = 0;
+	capacity = 0;
+}
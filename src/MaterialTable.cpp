@@ -0,0 +1,298 @@
+#include "MaterialTable.h"
+#include "TextureStreamer.h"
+#include "GPUMemory.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// ARB_bindless_texture entry points (the bundled glad loader is generated without extensions)
+typedef GLuint64(APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+static PFNGLGETTEXTUREHANDLEARBPROC getTextureHandleARB = nullptr;
+static PFNGLMAKETEXTUREHANDLERESIDENTARBPROC makeTextureHandleResidentARB = nullptr;
+static PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC makeTextureHandleNonResidentARB = nullptr;
+static bool bindlessSupported = false;
+
+
+bool MaterialTable::loadBindlessExtension(GLADloadproc load) {
+	bindlessSupported = false;
+
+	GLint numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+
+	bool found = false;
+	for (GLint i = 0; i < numExtensions && !found; i++) {
+		const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+		found = name && std::strcmp(name, "GL_ARB_bindless_texture") == 0;
+	}
+	if (!found)
+		return false;
+
+	getTextureHandleARB = (PFNGLGETTEXTUREHANDLEARBPROC)load("glGetTextureHandleARB");
+	makeTextureHandleResidentARB = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)load("glMakeTextureHandleResidentARB");
+	makeTextureHandleNonResidentARB = (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)load("glMakeTextureHandleNonResidentARB");
+
+	bindlessSupported = getTextureHandleARB && makeTextureHandleResidentARB && makeTextureHandleNonResidentARB;
+	return bindlessSupported;
+}
+
+bool MaterialTable::bindlessAvailable() {
+	return bindlessSupported;
+}
+
+std::vector<std::string> MaterialTable::shaderDefines() {
+	if (bindlessSupported)
+		return { "MATERIAL_TABLE", "BINDLESS" };
+	return { "MATERIAL_TABLE", "MAX_MATERIAL_ARRAYS " + std::to_string(MAX_TEXTURE_ARRAYS) };
+}
+
+
+MaterialTable::MaterialTable() : bindless(bindlessSupported) {
+	// stand-in for materials without a diffuse or specular map
+	const unsigned char black[4] = { 0, 0, 0, 255 };
+	glCreateTextures(GL_TEXTURE_2D, 1, &defaultTexture);
+	glTextureStorage2D(defaultTexture, 1, GL_RGBA8, 1, 1);
+	glTextureSubImage2D(defaultTexture, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, black);
+	glTextureParameteri(defaultTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(defaultTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	GPUMemory::track(GL_TEXTURE, defaultTexture, GPUMemory::TEXTURE, GPUMemory::textureBytes(GL_RGBA8, 1, 1), "material default");
+}
+
+MaterialTable::~MaterialTable() {
+	releaseGPUResources();
+	GPUMemory::untrack(GL_TEXTURE, defaultTexture);
+	glDeleteTextures(1, &defaultTexture);
+}
+
+int MaterialTable::addMaterial(const std::vector<Texture>& textures) {
+	MaterialDesc desc{ defaultTexture, defaultTexture };
+	bool hasDiffuse = false, hasSpecular = false;
+
+	for (auto& texture : textures) {
+		if (texture.type == "texture_diffuse" && !hasDiffuse) {
+			desc.diffuse = texture.id;
+			hasDiffuse = true;
+		}
+		else if (texture.type == "texture_specular" && !hasSpecular) {
+			desc.specular = texture.id;
+			hasSpecular = true;
+		}
+	}
+
+	if (!hasDiffuse && !hasSpecular)
+		return -1;
+
+	auto key = std::make_pair(desc.diffuse, desc.specular);
+	auto it = materialLookup.find(key);
+	if (it != materialLookup.end())
+		return it->second;
+
+	int index = (int)materials.size();
+	materials.push_back(desc);
+	materialLookup[key] = index;
+	return index;
+}
+
+void MaterialTable::upload() {
+	releaseGPUResources();
+
+	if (!bindless)
+		packTextureArrays();
+
+	entries.assign(materials.size(), GPUMaterial{});
+	for (size_t i = 0; i < materials.size(); i++) {
+		reference(materials[i].diffuse, entries[i].diffuse);
+		reference(materials[i].specular, entries[i].specular);
+		entries[i].minLod[0] = minLod(materials[i].diffuse);
+		entries[i].minLod[1] = minLod(materials[i].specular);
+	}
+	residencyVersion = streamer ? streamer->residencyVersion() : 0;
+
+	glCreateBuffers(1, &ssbo);
+	glNamedBufferStorage(ssbo, std::max<size_t>(entries.size(), 1) * sizeof(GPUMaterial), entries.empty() ? nullptr : entries.data(), GL_DYNAMIC_STORAGE_BIT);
+	GPUMemory::track(GL_BUFFER, ssbo, GPUMemory::BUFFER, std::max<size_t>(entries.size(), 1) * sizeof(GPUMaterial), "material table");
+}
+
+void MaterialTable::refresh() {
+	if (!streamer || streamer->residencyVersion() == residencyVersion)
+		return;
+	residencyVersion = streamer->residencyVersion();
+
+	// fallback arrays hold copies, bring over only the levels that became resident since the last copy
+	if (!bindless) {
+		for (auto& [texture, copiedBase] : copiedBaseLevel) {
+			int base = streamer->residentBaseLevel(texture);
+			if (base < copiedBase) {
+				copyLevels(texture, base, copiedBase);
+				copiedBase = base;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < materials.size(); i++) {
+		entries[i].minLod[0] = minLod(materials[i].diffuse);
+		entries[i].minLod[1] = minLod(materials[i].specular);
+	}
+	if (!entries.empty())
+		glNamedBufferSubData(ssbo, 0, entries.size() * sizeof(GPUMaterial), entries.data());
+}
+
+float MaterialTable::minLod(GLuint texture) const {
+	return streamer ? (float)streamer->residentBaseLevel(texture) : 0.0f;
+}
+
+void MaterialTable::bind(const std::vector<Shader*>& shaders) const {
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_BINDING, ssbo);
+
+	if (bindless)
+		return;
+
+	for (size_t i = 0; i < textureArrays.size(); i++)
+		glBindTextureUnit(FIRST_ARRAY_UNIT + (GLuint)i, textureArrays[i]);
+
+	// every element gets its own unit, even unused ones, so no two sampler types ever share a unit
+	for (auto shader : shaders) {
+		if (!shader->hasDefine("MATERIAL_TABLE"))
+			continue;
+
+		shader->use();
+		for (int i = 0; i < MAX_TEXTURE_ARRAYS; i++)
+			shader->setInt("materialArrays[" + std::to_string(i) + "]", FIRST_ARRAY_UNIT + i);
+	}
+}
+
+void MaterialTable::reference(GLuint texture, GLuint out[2]) {
+	if (bindless) {
+		// the handle freezes the texture's parameters, from here on the shader clamps to the resident levels
+		if (streamer)
+			streamer->lockParameters(texture);
+
+		GLuint64 handle = getTextureHandleARB(texture);
+		if (std::find(residentTextures.begin(), residentTextures.end(), texture) == residentTextures.end()) {
+			makeTextureHandleResidentARB(handle);
+			residentTextures.push_back(texture);
+		}
+		out[0] = (GLuint)(handle & 0xFFFFFFFFu);
+		out[1] = (GLuint)(handle >> 32);
+		return;
+	}
+
+	auto it = arrayLocations.find(texture);
+	if (it == arrayLocations.end())
+		it = arrayLocations.find(defaultTexture);
+	out[0] = it->second.first;
+	out[1] = it->second.second;
+}
+
+void MaterialTable::packTextureArrays() {
+	// group the referenced textures by everything a texture array has to share
+	std::map<ArrayKey, std::vector<GLuint>> groups;
+	std::vector<GLuint> seen{ defaultTexture };
+	groups[ArrayKey(1, 1, GL_RGBA8, GL_REPEAT)].push_back(defaultTexture);
+
+	for (auto& material : materials) {
+		for (GLuint texture : { material.diffuse, material.specular }) {
+			if (std::find(seen.begin(), seen.end(), texture) != seen.end())
+				continue;
+			seen.push_back(texture);
+
+			GLint width, height, format, wrap;
+			glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+			glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+			glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+			glGetTextureParameteriv(texture, GL_TEXTURE_WRAP_S, &wrap);
+
+			// textures uploaded with an unsized format may report it back unsized
+			if (format == GL_RED) format = GL_R8;
+			else if (format == GL_RGB) format = GL_RGB8;
+			else if (format == GL_RGBA) format = GL_RGBA8;
+
+			groups[ArrayKey(width, height, format, wrap)].push_back(texture);
+		}
+	}
+
+	for (auto& [key, textures] : groups) {
+		auto [width, height, format, wrap] = key;
+
+		if (textureArrays.size() == MAX_TEXTURE_ARRAYS) {
+			std::cout << "WARNING::MATERIAL_TABLE:: Out of texture arrays, " << textures.size() << " texture(s) of size "
+				<< width << "x" << height << " fall back to the default texture" << std::endl;
+			continue;
+		}
+
+		// only copy the levels every texture in the group actually has
+		GLint levels = 1;
+		while (levels < 16) {
+			bool allHaveLevel = true;
+			for (GLuint texture : textures) {
+				GLint levelWidth = 0;
+				glGetTextureLevelParameteriv(texture, levels, GL_TEXTURE_WIDTH, &levelWidth);
+				allHaveLevel &= levelWidth > 0;
+			}
+			if (!allHaveLevel)
+				break;
+			levels++;
+		}
+
+		GLuint array;
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &array);
+		glTextureStorage3D(array, levels, format, width, height, (GLsizei)textures.size());
+		GPUMemory::track(GL_TEXTURE, array, GPUMemory::TEXTURE, GPUMemory::textureBytes(format, width, height, (GLsizei)textures.size(), levels), "material array");
+		glTextureParameteri(array, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTextureParameteri(array, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(array, GL_TEXTURE_WRAP_S, wrap);
+		glTextureParameteri(array, GL_TEXTURE_WRAP_T, wrap);
+
+		GLuint slot = (GLuint)textureArrays.size();
+		textureArrays.push_back(array);
+		for (GLuint layer = 0; layer < textures.size(); layer++) {
+			arrayLocations[textures[layer]] = { slot, layer };
+
+			// streamed textures only have their resident levels copied, refresh() brings over the rest
+			int base = std::min((int)minLod(textures[layer]), levels - 1);
+			copyLevels(textures[layer], base, levels);
+			copiedBaseLevel[textures[layer]] = base;
+		}
+	}
+}
+
+void MaterialTable::copyLevels(GLuint texture, int firstLevel, int endLevel) {
+	auto location = arrayLocations.find(texture);
+	if (location == arrayLocations.end())
+		return;
+
+	GLuint array = textureArrays[location->second.first];
+	GLint levels, width, height;
+	glGetTextureParameteriv(array, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+	glGetTextureLevelParameteriv(array, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTextureLevelParameteriv(array, 0, GL_TEXTURE_HEIGHT, &height);
+
+	for (GLint level = firstLevel; level < std::min(endLevel, levels); level++) {
+		glCopyImageSubData(texture, GL_TEXTURE_2D, level, 0, 0, 0,
+			array, GL_TEXTURE_2D_ARRAY, level, 0, 0, location->second.second,
+			std::max(1, width >> level), std::max(1, height >> level), 1);
+	}
+}
+
+void MaterialTable::releaseGPUResources() {
+	for (GLuint texture : residentTextures)
+		makeTextureHandleNonResidentARB(getTextureHandleARB(texture));
+	residentTextures.clear();
+
+	for (GLuint array : textureArrays)
+		GPUMemory::untrack(GL_TEXTURE, array);
+	if (!textureArrays.empty())
+		glDeleteTextures((GLsizei)textureArrays.size(), textureArrays.data());
+	textureArrays.clear();
+	arrayLocations.clear();
+	copiedBaseLevel.clear();
+
+	if (ssbo) {
+		GPUMemory::untrack(GL_BUFFER, ssbo);
+		glDeleteBuffers(1, &ssbo);
+	}
+	ssbo = 0;
+}
@@ -1,12 +1,29 @@
 #include "Mesh.h"
+#include "MaterialTable.h"
+#include "TextureAtlas.h"
+#include "GPUMemory.h"
+#include <algorithm>
+#include <cmath>
 #include <numeric>
 
 Mesh::Mesh(const std::vector<float>& vertices, const std::vector<unsigned int>& attribSizes, const std::vector<Texture>& textures, const std::vector<unsigned int>& indices) :
-	textures (textures){
+	textures (textures), attribSizes(attribSizes) {
 	
 	indicesSize = indices.size();
 	GLsizei vertexSize = std::accumulate(attribSizes.begin(), attribSizes.end(), 0);
 	vertexCount = vertices.size() / vertexSize;
+
+	// bounding sphere around the local origin and bounding box
+	unsigned int positionSize = attribSizes.empty() ? 0 : std::min(attribSizes[0], 3u);
+	for (GLsizei i = 0; i < vertexCount; i++) {
+		glm::vec3 position(0.0f);
+		for (unsigned int j = 0; j < positionSize; j++) {
+			position[j] = vertices[size_t(i) * vertexSize + j];
+		}
+		boundingRadius = std::max(boundingRadius, glm::length(position));
+		localBounds.min = i == 0 ? position : glm::min(localBounds.min, position);
+		localBounds.max = i == 0 ? position : glm::max(localBounds.max, position);
+	}
 	
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
@@ -15,12 +32,14 @@ Mesh::Mesh(const std::vector<float>& vertices, const std::vector<unsigned int>&
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+	GPUMemory::track(GL_BUFFER, VBO, GPUMemory::MESH, vertices.size() * sizeof(float));
 
 	// set up EBO if indeces provided
 	if (indicesSize != 0) {
 		glGenBuffers(1, &EBO);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		GPUMemory::track(GL_BUFFER, EBO, GPUMemory::MESH, indices.size() * sizeof(unsigned int));
 	}
 
 	setUpAttributes(attribSizes);
@@ -53,32 +72,77 @@ void Mesh::setUpAttributes(const std::vector<unsigned int>& attribSizes) {
 }
 
 
-void Mesh::draw(Shader& shader) {
-	shader.use();
-
-	unsigned int diffuseNr = 1;
-	unsigned int specularNr = 1;
+void Mesh::registerMaterial(MaterialTable& table) {
+	materialIndex = table.addMaterial(textures);
+}
 
-	for (unsigned int i = 0; i < textures.size(); i++)
-	{
-		glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
+bool Mesh::useAtlasRegion(const TextureAtlas& atlas, const std::string& name, unsigned int texCoordAttrib) {
+	const TextureAtlas::Region* region = atlas.find(name);
+	if (!region || texCoordAttrib >= attribSizes.size() || attribSizes[texCoordAttrib] < 2)
+		return false;
 
-		// retrieve texture number (the N in diffuse_textureN)
-		std::string number;
-		std::string name = textures[i].type;
-		if (name == "texture_diffuse")
-			number = std::to_string(diffuseNr++);
-		else if (name == "texture_specular")
-			number = std::to_string(specularNr++);
+	GLsizei vertexSize = std::accumulate(attribSizes.begin(), attribSizes.end(), 0);
+	GLsizei offset = std::accumulate(attribSizes.begin(), attribSizes.begin() + texCoordAttrib, 0);
+
+	// read the vertices back once, remap and re-upload
+	std::vector<float> vertices(size_t(vertexCount) * vertexSize);
+	glGetNamedBufferSubData(VBO, 0, vertices.size() * sizeof(float), vertices.data());
+	for (GLsizei i = 0; i < vertexCount; i++) {
+		float* uv = &vertices[size_t(i) * vertexSize + offset];
+		uv[0] = region->uvOffset.x + uv[0] * region->uvScale.x;
+		uv[1] = region->uvOffset.y + uv[1] * region->uvScale.y;
+	}
+	glNamedBufferSubData(VBO, 0, vertices.size() * sizeof(float), vertices.data());
+
+	for (auto& texture : textures) {
+		if (texture.type == "texture_diffuse") {
+			texture.id = atlas.pageTexture(region->page);
+			texture.path = name;
+			break;
+		}
+	}
+	return true;
+}
 
-		shader.setInt(("material." + name + number).c_str(), i);
-		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+void Mesh::bindTextures(Shader& shader) const {
+	// material table shaders look the textures up themselves, only the index changes per draw
+	if (materialIndex >= 0 && shader.hasDefine("MATERIAL_TABLE")) {
+		shader.setInt("materialIndex", materialIndex);
+	}
+	else {
+		unsigned int diffuseNr = 1;
+		unsigned int specularNr = 1;
+
+		for (unsigned int i = 0; i < textures.size(); i++)
+		{
+			glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
+
+			// retrieve texture number (the N in diffuse_textureN)
+			std::string number;
+			std::string name = textures[i].type;
+			if (name == "texture_diffuse")
+				number = std::to_string(diffuseNr++);
+			else if (name == "texture_specular")
+				number = std::to_string(specularNr++);
+
+			shader.setInt(("material." + name + number).c_str(), i);
+			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+		}
+		glActiveTexture(GL_TEXTURE0);
 	}
-	glActiveTexture(GL_TEXTURE0);
+}
+
+void Mesh::draw(Shader& shader) {
+	shader.use();
+	bindTextures(shader);
 
 	// draw mesh
 	glBindVertexArray(VAO);
+	drawGeometry();
+	glBindVertexArray(0);
+}
 
+void Mesh::drawGeometry() const {
 	// Use EBO if indices provided
 	if (indicesSize != 0) {
 		glDrawElements(GL_TRIANGLES, indicesSize, GL_UNSIGNED_INT, 0);
@@ -86,5 +150,20 @@ void Mesh::draw(Shader& shader) {
 	else {
 		glDrawArrays(GL_TRIANGLES, 0, vertexCount);
 	}
+}
+
+void Mesh::drawIndirectCount(Shader& shader, GLuint commandBuffer, GLuint countBuffer, GLsizei maxDrawCount, GLintptr commandOffset, GLintptr countOffset) {
+	if (indicesSize == 0)
+		return;
+
+	shader.use();
+	bindTextures(shader);
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBindBuffer(GL_PARAMETER_BUFFER, countBuffer);
+	glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)commandOffset, countOffset, maxDrawCount, 0);
+	glBindBuffer(GL_PARAMETER_BUFFER, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 	glBindVertexArray(0);
 }
\ No newline at end of file
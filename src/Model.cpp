@@ -116,6 +116,12 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType
     return textures;
 }
 
+void Model::registerMaterials(MaterialTable& table) {
+    for (auto& mesh : meshes) {
+        mesh.registerMaterial(table);
+    }
+}
+
 void Model::draw(Shader& shader) {
     for (unsigned int i = 0; i < meshes.size(); i++) {
         meshes[i].draw(shader);
@@ -0,0 +1,144 @@
+#include "PostProcessStack.h"
+#include "GPUMemory.h"
+
+#include <iostream>
+
+namespace {
+	const GLuint WEIGHT_BINDING = 6; // must match postProcessCS.glsl
+}
+
+PostProcessStack::PostProcessStack() {
+	glCreateBuffers(1, &weightBuffer);
+	glCreateVertexArrays(1, &emptyVAO);
+}
+
+PostProcessStack::~PostProcessStack() {
+	clear();
+	if (weightBufferSize)
+		GPUMemory::untrack(GL_BUFFER, weightBuffer);
+	glDeleteBuffers(1, &weightBuffer);
+	glDeleteVertexArrays(1, &emptyVAO);
+}
+
+void PostProcessStack::clear() {
+	for (auto& pass : passes) {
+		glDeleteQueries(QUERY_RING, pass.queries);
+	}
+	passes.clear();
+	weights.clear();
+	weightsDirty = true;
+}
+
+PostProcessStack::Pass& PostProcessStack::addPass(const std::string& name, PassType type) {
+	Pass pass;
+	pass.name = name;
+	pass.type = type;
+	glCreateQueries(GL_TIME_ELAPSED, QUERY_RING, pass.queries);
+	passes.push_back(pass);
+	return passes.back();
+}
+
+void PostProcessStack::addColor(const std::string& name, ColorOp op) {
+	addPass(name, PASS_COLOR).colorOp = op;
+}
+
+void PostProcessStack::addKernel(const std::string& name, int width, int height, const std::vector<float>& kernel) {
+	if (width % 2 == 0 || height % 2 == 0 || kernel.size() != size_t(width) * size_t(height)) {
+		std::cout << "ERROR::POST_PROCESS:: kernel " << name << " must be odd sized with width * height weights" << std::endl;
+		return;
+	}
+	Pass& pass = addPass(name, PASS_KERNEL);
+	pass.size = glm::ivec2(width, height);
+	pass.weightOffset = int(weights.size());
+	weights.insert(weights.end(), kernel.begin(), kernel.end());
+	weightsDirty = true;
+}
+
+void PostProcessStack::addSeparable(const std::string& name, const std::vector<float>& horizontal, const std::vector<float>& vertical) {
+	addKernel(name + " (horizontal)", int(horizontal.size()), 1, horizontal);
+	addKernel(name + " (vertical)", 1, int(vertical.size()), vertical);
+}
+
+void PostProcessStack::uploadWeights() {
+	weightsDirty = false;
+	if (weights.empty())
+		return;
+
+	GLsizeiptr size = GLsizeiptr(weights.size() * sizeof(float));
+	if (size > weightBufferSize) {
+		if (weightBufferSize)
+			GPUMemory::untrack(GL_BUFFER, weightBuffer);
+		glDeleteBuffers(1, &weightBuffer);
+		glCreateBuffers(1, &weightBuffer);
+		glNamedBufferStorage(weightBuffer, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+		weightBufferSize = size;
+		GPUMemory::track(GL_BUFFER, weightBuffer, GPUMemory::BUFFER, size_t(size), "post-process weights");
+	}
+	glNamedBufferSubData(weightBuffer, 0, size, weights.data());
+}
+
+void PostProcessStack::execute(size_t index, Shader& computeShader, GLuint source, GLuint destination, glm::ivec2 region) {
+	if (weightsDirty)
+		uploadWeights();
+	Pass& pass = passes[index];
+	int slot = pass.nextQuery;
+	pass.nextQuery = (pass.nextQuery + 1) % QUERY_RING;
+
+	// finished long ago unless the GPU is a whole ring of frames behind
+	if (pass.pending[slot]) {
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(pass.queries[slot], GL_QUERY_RESULT, &elapsed);
+		pass.milliseconds = float(double(elapsed) / 1e6);
+	}
+	glBeginQuery(GL_TIME_ELAPSED, pass.queries[slot]);
+
+	computeShader.use();
+	computeShader.setInt("source", 0);
+	// texels outside the region are stale, the shader clamps to its edge
+	computeShader.setInt("imageWidth", region.x);
+	computeShader.setInt("imageHeight", region.y);
+	if (weightBufferSize)
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, WEIGHT_BINDING, weightBuffer);
+
+	computeShader.setInt("passType", pass.type);
+	if (pass.type == PASS_COLOR) {
+		computeShader.setInt("colorOp", pass.colorOp);
+	}
+	else {
+		glm::ivec2 halo = (pass.size / 2) * spacing;
+		computeShader.setInt("kernelWidth", pass.size.x);
+		computeShader.setInt("kernelHeight", pass.size.y);
+		computeShader.setInt("spacingX", spacing.x);
+		computeShader.setInt("spacingY", spacing.y);
+		computeShader.setInt("weightOffset", pass.weightOffset);
+		computeShader.setBool("tiled", halo.x <= MAX_TILE_HALO && halo.y <= MAX_TILE_HALO);
+	}
+
+	glBindTextureUnit(0, source);
+	glBindImageTexture(0, destination, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	glDispatchCompute((region.x + TILE_SIZE - 1) / TILE_SIZE, (region.y + TILE_SIZE - 1) / TILE_SIZE, 1);
+	glBindTextureUnit(0, 0);
+
+	glEndQuery(GL_TIME_ELAPSED);
+	pass.pending[slot] = true;
+}
+
+void PostProcessStack::present(Shader& displayShader, GLuint image, glm::vec2 uvScale, float sharpness) {
+	displayShader.use();
+	displayShader.setInt("screenTexture", 0);
+	displayShader.setVec2("uvScale", uvScale);
+	displayShader.setFloat("sharpness", sharpness);
+	glBindTextureUnit(0, image);
+	glBindVertexArray(emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glBindTextureUnit(0, 0);
+}
+
+std::vector<PostProcessStack::Timing> PostProcessStack::getTimings() const {
+	std::vector<Timing> timings;
+	for (auto& pass : passes) {
+		timings.push_back({ pass.name, pass.milliseconds });
+	}
+	return timings;
+}
@@ -0,0 +1,125 @@
+#include "Profiler.h"
+
+#include <algorithm>
+
+Profiler::Profiler() {
+	for (Frame& frame : frames) {
+		glCreateQueries(GL_TIMESTAMP, 2 * MAX_SCOPES, frame.queries);
+		frame.scopes.reserve(MAX_SCOPES);
+	}
+	frameStart = std::chrono::steady_clock::now();
+}
+
+Profiler::~Profiler() {
+	for (Frame& frame : frames) {
+		glDeleteQueries(2 * MAX_SCOPES, frame.queries);
+	}
+}
+
+float Profiler::cpuMilliseconds() const {
+	return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+}
+
+void Profiler::beginFrame() {
+	// oldest first, so the history stays in order: the slot about to be reused, then the newer ones. a frame that
+	// isn't done means the ones after it aren't either
+	for (int i = 0; i < FRAME_LATENCY; i++) {
+		Frame& frame = frames[(current + i) % FRAME_LATENCY];
+		if (frame.pending && !collect(frame))
+			break;
+	}
+	// still not done after FRAME_LATENCY frames, waiting would stall: its queries are reused and its results lost
+	Frame& frame = frames[current];
+	if (frame.pending) {
+		frame.pending = false;
+		droppedFrames++;
+	}
+
+	frame.scopes.clear();
+	open.clear();
+	frameStart = std::chrono::steady_clock::now();
+	begin("Frame");
+}
+
+void Profiler::endFrame() {
+	// scopes left open end with the frame, the frame's own end is the last query issued
+	while (!open.empty()) {
+		end();
+	}
+	frames[current].pending = true;
+	current = (current + 1) % FRAME_LATENCY;
+}
+
+void Profiler::begin(const std::string& name) {
+	Frame& frame = frames[current];
+	if (frame.scopes.size() >= MAX_SCOPES) {
+		open.push_back(-1);
+		return;
+	}
+	int index = int(frame.scopes.size());
+	float now = cpuMilliseconds();
+	frame.scopes.push_back({ name, int(open.size()), now, now, 0.0f, 0.0f });
+	glQueryCounter(frame.queries[2 * index], GL_TIMESTAMP);
+	open.push_back(index);
+}
+
+void Profiler::end() {
+	if (open.empty())
+		return;
+	int index = open.back();
+	open.pop_back();
+	if (index < 0)
+		return;
+	Frame& frame = frames[current];
+	frame.scopes[index].cpuEnd = cpuMilliseconds();
+	glQueryCounter(frame.queries[2 * index + 1], GL_TIMESTAMP);
+}
+
+bool Profiler::collect(Frame& frame) {
+	// the frame's end was issued last, once it's available all of them are
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return false;
+
+	GLuint64 frameBegin = 0;
+	glGetQueryObjectui64v(frame.queries[0], GL_QUERY_RESULT, &frameBegin);
+	for (size_t i = 0; i < frame.scopes.size(); i++) {
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(frame.queries[2 * i], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.queries[2 * i + 1], GL_QUERY_RESULT, &end);
+		frame.scopes[i].gpuBegin = float(double(begin - frameBegin) / 1e6);
+		frame.scopes[i].gpuEnd = float(double(end - frameBegin) / 1e6);
+	}
+	frame.pending = false;
+
+	latest = frame.scopes;
+	record(latest);
+	return true;
+}
+
+void Profiler::record(const std::vector<Scope>& scopes) {
+	for (History& history : histories) {
+		history.cpu[historyNext] = 0.0f;
+		history.gpu[historyNext] = 0.0f;
+	}
+	// scopes of the same name add up
+	for (const Scope& scope : scopes) {
+		if (scope.depth != 1)
+			continue;
+		auto it = std::find_if(histories.begin(), histories.end(), [&](const History& history) { return history.name == scope.name; });
+		if (it == histories.end()) {
+			histories.emplace_back();
+			histories.back().name = scope.name;
+			it = histories.end() - 1;
+		}
+		it->cpu[historyNext] += scope.cpuEnd - scope.cpuBegin;
+		it->gpu[historyNext] += scope.gpuEnd - scope.gpuBegin;
+	}
+	historyNext = (historyNext + 1) % HISTORY;
+
+	// scopes that haven't run for the whole history are gone
+	histories.erase(std::remove_if(histories.begin(), histories.end(), [](const History& history) {
+		return std::all_of(std::begin(history.cpu), std::end(history.cpu), [](float ms) { return ms == 0.0f; });
+	}), histories.end());
+}
@@ -0,0 +1,347 @@
+#include "RenderGraph.h"
+#include "GPUMemory.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+	// where a texture of this format goes on a framebuffer, GL_COLOR_ATTACHMENT0 standing for any color attachment
+	GLenum attachmentPoint(GLenum format) {
+		switch (format) {
+		case GL_DEPTH24_STENCIL8:
+		case GL_DEPTH32F_STENCIL8:
+			return GL_DEPTH_STENCIL_ATTACHMENT;
+		case GL_DEPTH_COMPONENT16:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32:
+		case GL_DEPTH_COMPONENT32F:
+			return GL_DEPTH_ATTACHMENT;
+		default:
+			return GL_COLOR_ATTACHMENT0;
+		}
+	}
+
+	GLbitfield barrierFor(RenderGraph::Access access) {
+		switch (access) {
+		case RenderGraph::SAMPLED: return GL_TEXTURE_FETCH_BARRIER_BIT;
+		case RenderGraph::IMAGE: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+		default: return GL_FRAMEBUFFER_BARRIER_BIT;
+		}
+	}
+
+	const GLbitfield ALL_TEXTURE_BARRIERS = GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Resource RenderGraph::PassBuilder::create(const std::string& name, const TextureDesc& desc, Access access) {
+	VirtualTexture texture;
+	texture.name = name;
+	texture.desc = desc;
+	if (desc.width > 0 && desc.height > 0)
+		texture.size = glm::ivec2(desc.width, desc.height);
+	else
+		texture.size = glm::max(glm::ivec2(glm::round(glm::vec2(graph.screenSize) * desc.scale)), glm::ivec2(1));
+	graph.resources.push_back(texture);
+	return write(Resource(graph.resources.size() - 1), access);
+}
+
+RenderGraph::Resource RenderGraph::PassBuilder::read(Resource resource, Access access) {
+	if (resource >= 0)
+		graph.passes[pass].uses.push_back({ resource, access, false });
+	return resource;
+}
+
+RenderGraph::Resource RenderGraph::PassBuilder::write(Resource resource, Access access) {
+	if (resource >= 0)
+		graph.passes[pass].uses.push_back({ resource, access, true });
+	return resource;
+}
+
+void RenderGraph::PassBuilder::sideEffect() {
+	graph.passes[pass].sideEffect = true;
+}
+
+GLuint RenderGraph::PassContext::texture(Resource resource) const {
+	int physical = graph.resources[resource].physical;
+	return physical >= 0 ? graph.pool[physical].texture : 0;
+}
+
+glm::ivec2 RenderGraph::PassContext::size(Resource resource) const {
+	return graph.resources[resource].size;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+RenderGraph::RenderGraph(int screenWidth, int screenHeight) : screenSize(screenWidth, screenHeight) {
+}
+
+RenderGraph::~RenderGraph() {
+	while (!pool.empty()) {
+		release(pool.size() - 1);
+	}
+}
+
+void RenderGraph::setScreenSize(int width, int height) {
+	glm::ivec2 size(width, height);
+	if (size == screenSize)
+		return;
+	screenSize = size;
+
+	// fixed size textures (and the framebuffers made only of them) survive a resize
+	for (size_t i = pool.size(); i-- > 0;) {
+		if (pool[i].screenRelative)
+			release(i);
+	}
+}
+
+void RenderGraph::reset() {
+	passes.clear();
+	resources.clear();
+}
+
+void RenderGraph::addPass(const std::string& name, std::function<void(PassBuilder&)> setup, std::function<void(const PassContext&)> execute) {
+	Pass pass;
+	pass.name = name;
+	pass.execute = std::move(execute);
+	passes.push_back(std::move(pass));
+
+	PassBuilder builder(*this, int(passes.size() - 1));
+	setup(builder);
+}
+
+void RenderGraph::compile() {
+	stats = Stats();
+	cull();
+	allocate();
+	placeBarriers();
+
+	passNames.clear();
+	for (auto& pass : passes) {
+		if (!pass.live)
+			continue;
+		pass.framebuffer = framebufferFor(pass);
+		passNames.push_back(pass.name);
+	}
+
+	for (auto& physical : pool) {
+		stats.pooledBytes += GPUMemory::textureBytes(physical.format, physical.size.x, physical.size.y);
+	}
+	stats.pooledTextures = int(pool.size());
+}
+
+void RenderGraph::execute(Profiler* profiler) {
+	PassContext context(*this);
+	for (auto& pass : passes) {
+		if (!pass.live)
+			continue;
+		Profiler::ScopedTimer timer(profiler, pass.name);
+		if (pass.barriers)
+			glMemoryBarrier(pass.barriers);
+		glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+		context.framebuffer = pass.framebuffer;
+		pass.execute(context);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderGraph::cull() {
+	// backwards: a pass is needed if it has a side effect or writes something a later needed pass reads. what it
+	// reads is needed from then on, what it only writes (without reading) is produced here and no longer needed earlier
+	std::vector<bool> needed(resources.size(), false);
+	for (size_t i = passes.size(); i-- > 0;) {
+		Pass& pass = passes[i];
+		pass.live = pass.sideEffect;
+		for (auto& use : pass.uses) {
+			pass.live = pass.live || (use.write && needed[use.resource]);
+		}
+		if (!pass.live) {
+			stats.culledPasses++;
+			continue;
+		}
+		stats.passes++;
+
+		for (auto& use : pass.uses) {
+			if (use.write)
+				needed[use.resource] = false;
+		}
+		for (auto& use : pass.uses) {
+			if (!use.write)
+				needed[use.resource] = true;
+		}
+	}
+}
+
+void RenderGraph::allocate() {
+	for (int i = 0; i < int(passes.size()); i++) {
+		if (!passes[i].live)
+			continue;
+		for (auto& use : passes[i].uses) {
+			VirtualTexture& texture = resources[use.resource];
+			if (texture.firstPass < 0)
+				texture.firstPass = i;
+			texture.lastPass = i;
+		}
+	}
+
+	// in pass order, a pooled texture is free for a new resource once its holder's last pass has run
+	for (auto& physical : pool) {
+		physical.busyUntil = -1;
+		physical.unusedFrames++;
+	}
+	for (int i = 0; i < int(passes.size()); i++) {
+		if (!passes[i].live)
+			continue;
+		for (auto& use : passes[i].uses) {
+			VirtualTexture& texture = resources[use.resource];
+			if (texture.firstPass == i && texture.physical < 0)
+				texture.physical = acquire(texture, i);
+		}
+	}
+	releaseUnused();
+
+	std::vector<bool> usedPhysical(pool.size(), false);
+	for (auto& texture : resources) {
+		if (texture.physical < 0)
+			continue;
+		stats.resources++;
+		usedPhysical[texture.physical] = true;
+	}
+	stats.textures = int(std::count(usedPhysical.begin(), usedPhysical.end(), true));
+}
+
+int RenderGraph::acquire(const VirtualTexture& texture, int pass) {
+	for (size_t i = 0; i < pool.size(); i++) {
+		PhysicalTexture& physical = pool[i];
+		if (physical.format == texture.desc.format && physical.size == texture.size && physical.busyUntil < pass) {
+			physical.busyUntil = texture.lastPass;
+			physical.unusedFrames = 0;
+			return int(i);
+		}
+	}
+
+	PhysicalTexture physical;
+	physical.format = texture.desc.format;
+	physical.size = texture.size;
+	physical.screenRelative = !(texture.desc.width > 0 && texture.desc.height > 0);
+	physical.busyUntil = texture.lastPass;
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &physical.texture);
+	glTextureStorage2D(physical.texture, 1, physical.format, physical.size.x, physical.size.y);
+	GLint filter = attachmentPoint(physical.format) == GL_COLOR_ATTACHMENT0 ? GL_LINEAR : GL_NEAREST;
+	glTextureParameteri(physical.texture, GL_TEXTURE_MIN_FILTER, filter);
+	glTextureParameteri(physical.texture, GL_TEXTURE_MAG_FILTER, filter);
+	glTextureParameteri(physical.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(physical.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GPUMemory::track(GL_TEXTURE, physical.texture, GPUMemory::FRAMEBUFFER, GPUMemory::textureBytes(physical.format, physical.size.x, physical.size.y), "render graph " + texture.name);
+
+	pool.push_back(physical);
+	return int(pool.size() - 1);
+}
+
+void RenderGraph::release(size_t index) {
+	GLuint texture = pool[index].texture;
+	for (size_t i = framebuffers.size(); i-- > 0;) {
+		CachedFramebuffer& cached = framebuffers[i];
+		if (cached.depth == texture || std::find(cached.colors.begin(), cached.colors.end(), texture) != cached.colors.end()) {
+			glDeleteFramebuffers(1, &cached.framebuffer);
+			framebuffers.erase(framebuffers.begin() + i);
+		}
+	}
+
+	GPUMemory::untrack(GL_TEXTURE, texture);
+	glDeleteTextures(1, &texture);
+	pool.erase(pool.begin() + index);
+
+	// this frame's resources point into the pool by index
+	for (auto& resource : resources) {
+		if (resource.physical == int(index))
+			resource.physical = -1;
+		else if (resource.physical > int(index))
+			resource.physical--;
+	}
+}
+
+void RenderGraph::releaseUnused() {
+	// kept around for a while, so toggling a pass on and off doesn't reallocate every time
+	for (size_t i = pool.size(); i-- > 0;) {
+		if (pool[i].unusedFrames > UNUSED_FRAMES_BEFORE_RELEASE)
+			release(i);
+	}
+}
+
+void RenderGraph::placeBarriers() {
+	// owed per GL texture, not per resource: resources sharing a pooled texture (this frame or across frames) inherit
+	// what its earlier holders left unsettled. glMemoryBarrier is global, so issuing a bit settles it for every texture
+	for (auto& pass : passes) {
+		pass.barriers = 0;
+		if (!pass.live)
+			continue;
+
+		for (auto& use : pass.uses) {
+			pass.barriers |= pool[resources[use.resource].physical].owedBarriers & barrierFor(use.access);
+		}
+		if (pass.barriers) {
+			stats.barriers++;
+			for (auto& physical : pool) {
+				physical.owedBarriers &= ~pass.barriers;
+			}
+		}
+		for (auto& use : pass.uses) {
+			if (use.write && use.access == IMAGE)
+				pool[resources[use.resource].physical].owedBarriers = ALL_TEXTURE_BARRIERS;
+		}
+	}
+}
+
+GLuint RenderGraph::framebufferFor(const Pass& pass) {
+	std::vector<GLuint> colors;
+	GLuint depth = 0;
+	GLenum depthPoint = GL_DEPTH_ATTACHMENT;
+	for (auto& use : pass.uses) {
+		if (use.access != ATTACHMENT)
+			continue;
+		const VirtualTexture& texture = resources[use.resource];
+		GLuint name = pool[texture.physical].texture;
+		GLenum point = attachmentPoint(texture.desc.format);
+		if (point == GL_COLOR_ATTACHMENT0) {
+			if (std::find(colors.begin(), colors.end(), name) == colors.end())
+				colors.push_back(name);
+		}
+		else {
+			depth = name;
+			depthPoint = point;
+		}
+	}
+	if (colors.empty() && depth == 0)
+		return 0;
+
+	for (auto& cached : framebuffers) {
+		if (cached.colors == colors && cached.depth == depth)
+			return cached.framebuffer;
+	}
+
+	CachedFramebuffer cached;
+	cached.colors = colors;
+	cached.depth = depth;
+	glCreateFramebuffers(1, &cached.framebuffer);
+	std::vector<GLenum> drawBuffers;
+	for (size_t i = 0; i < colors.size(); i++) {
+		glNamedFramebufferTexture(cached.framebuffer, GLenum(GL_COLOR_ATTACHMENT0 + i), colors[i], 0);
+		drawBuffers.push_back(GLenum(GL_COLOR_ATTACHMENT0 + i));
+	}
+	if (depth)
+		glNamedFramebufferTexture(cached.framebuffer, depthPoint, depth, 0);
+	if (drawBuffers.empty())
+		glNamedFramebufferDrawBuffer(cached.framebuffer, GL_NONE);
+	else
+		glNamedFramebufferDrawBuffers(cached.framebuffer, GLsizei(drawBuffers.size()), drawBuffers.data());
+
+	if (glCheckNamedFramebufferStatus(cached.framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::RENDER_GRAPH:: Framebuffer of pass " << pass.name << " is not complete!" << std::endl;
+
+	framebuffers.push_back(cached);
+	return cached.framebuffer;
+}
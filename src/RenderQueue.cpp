@@ -0,0 +1,365 @@
+#include "RenderQueue.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace {
+	const int PROGRAM_BITS = 8, MATERIAL_BITS = 16, VAO_BITS = 12, DEPTH_BITS = 24;
+	const uint32_t DEPTH_MAX = (1u << DEPTH_BITS) - 1;
+
+	// ids are handed out densely, anything past the field's range shares the last value. they only order the sort
+	// key: once a field saturates an id stands for several resources, so what to bind is decided on the resources
+	template <typename K>
+	uint32_t denseId(std::unordered_map<K, uint32_t>& ids, K key, int bits) {
+		auto it = ids.find(key);
+		if (it != ids.end())
+			return it->second;
+		uint32_t id = std::min(uint32_t(ids.size()), (1u << bits) - 1);
+		ids.emplace(key, id);
+		return id;
+	}
+
+	// whether drawing the mesh binds material state (material table index or its own textures)
+	bool hasMaterial(const Mesh& mesh) {
+		return mesh.getMaterialIndex() >= 0 || !mesh.getTextures().empty();
+	}
+
+	// the same material state: the same table entry, or for meshes outside the table the same mesh's textures
+	bool sameMaterial(const Mesh& a, const Mesh& b) {
+		if (a.getMaterialIndex() >= 0 || b.getMaterialIndex() >= 0)
+			return a.getMaterialIndex() == b.getMaterialIndex();
+		return &a == &b || (a.getTextures().empty() && b.getTextures().empty());
+	}
+}
+
+void RenderQueue::begin(const CameraFrame& frame, float farDepth) {
+	items.clear();
+	entries.clear();
+	transparent.clear();
+	transparentItems.clear();
+	transparentSubmitted.clear();
+	cameraPosition = frame.position;
+	this->farDepth = farDepth;
+}
+
+uint32_t RenderQueue::materialId(const Mesh& mesh) {
+	// material table entries are unique per texture set, the upper half of the range is for everything else
+	const uint32_t half = 1u << (MATERIAL_BITS - 1);
+	if (mesh.getMaterialIndex() >= 0)
+		return std::min(uint32_t(mesh.getMaterialIndex()) + 1, half - 1);
+	if (mesh.getTextures().empty())
+		return 0;
+	return half | denseId(materialIds, &mesh, MATERIAL_BITS - 1);
+}
+
+uint64_t RenderQueue::stateKey(Pass pass, const Item& item, float distance) const {
+	uint64_t depth = uint64_t(std::clamp(distance / farDepth, 0.0f, 1.0f) * DEPTH_MAX);
+	uint64_t state = (uint64_t(item.program) << (MATERIAL_BITS + VAO_BITS)) | (uint64_t(item.material) << VAO_BITS) | item.vao;
+	return (uint64_t(pass) << 60) | (state << DEPTH_BITS) | depth;
+}
+
+void RenderQueue::submit(Pass pass, Shader& shader, const SceneObject& object) {
+	float distance = glm::length(object.getPosition() - cameraPosition);
+
+	auto add = [&](const Mesh& mesh) {
+		uint32_t program = denseId(programIds, (const Shader*)&shader, PROGRAM_BITS);
+		uint32_t material = materialId(mesh);
+		uint32_t vao = denseId(vaoIds, mesh.getVAO(), VAO_BITS);
+		Item item{ &shader, &mesh, &object, program, material, vao };
+
+		if (pass == PASS_TRANSPARENT) {
+			transparent.push_back({ DepthSort::farToNearKey(distance, farDepth), uint32_t(transparentItems.size()) });
+			transparentItems.push_back(uint32_t(items.size()));
+			transparentSubmitted.push_back({ &object, &mesh });
+		}
+		else {
+			entries.push_back({ stateKey(pass, item, distance), uint32_t(items.size()) });
+		}
+		items.push_back(item);
+	};
+
+	if (object.model) {
+		for (auto& mesh : object.model->getMeshes()) {
+			add(mesh);
+		}
+	}
+	else {
+		add(*object.mesh);
+	}
+}
+
+void RenderQueue::submitAll(Pass pass, Shader& shader, const std::vector<SceneObject>& objects, JobSystem& jobs) {
+	const size_t GRAIN = 256;
+
+	// the id maps can't be written from several threads: the ids of every mesh the objects use are looked up first.
+	// instances share their meshes, so this is a pointer compare per object and a lookup per distinct mesh
+	std::unordered_map<const Mesh*, Item> meshItems;
+	uint32_t program = denseId(programIds, (const Shader*)&shader, PROGRAM_BITS);
+	const void* previousSource = nullptr;
+	auto addMesh = [&](const Mesh& mesh) {
+		if (meshItems.count(&mesh))
+			return;
+		Item item{ &shader, &mesh, nullptr, program, materialId(mesh), denseId(vaoIds, mesh.getVAO(), VAO_BITS) };
+		meshItems.emplace(&mesh, item);
+	};
+	for (auto& object : objects) {
+		const void* source = object.model ? (const void*)object.model : (const void*)object.mesh;
+		if (source == previousSource)
+			continue;
+		previousSource = source;
+		if (object.model) {
+			for (auto& mesh : object.model->getMeshes()) {
+				addMesh(mesh);
+			}
+		}
+		else {
+			addMesh(*object.mesh);
+		}
+	}
+
+	// items per range of objects, then every range writes its items and keys from where the ones before it end
+	size_t ranges = (objects.size() + GRAIN - 1) / GRAIN;
+	std::vector<size_t> offsets(ranges + 1, 0);
+	jobs.parallelFor(objects.size(), GRAIN, [&](size_t first, size_t last) {
+		size_t count = 0;
+		for (size_t i = first; i < last; i++) {
+			if (!objects[i].culled)
+				count += objects[i].model ? objects[i].model->getMeshes().size() : 1;
+		}
+		offsets[first / GRAIN + 1] = count;
+	});
+	for (size_t i = 0; i < ranges; i++) {
+		offsets[i + 1] += offsets[i];
+	}
+
+	size_t firstItem = items.size(), firstEntry = entries.size();
+	items.resize(firstItem + offsets[ranges]);
+	entries.resize(firstEntry + offsets[ranges]);
+	jobs.parallelFor(objects.size(), GRAIN, [&](size_t first, size_t last) {
+		size_t next = offsets[first / GRAIN];
+		for (size_t i = first; i < last; i++) {
+			const SceneObject& object = objects[i];
+			if (object.culled)
+				continue;
+			float distance = glm::length(object.getPosition() - cameraPosition);
+			auto add = [&](const Mesh& mesh) {
+				Item item = meshItems.find(&mesh)->second;
+				item.object = &object;
+				items[firstItem + next] = item;
+				entries[firstEntry + next] = { stateKey(pass, item, distance), uint32_t(firstItem + next) };
+				next++;
+			};
+			if (object.model) {
+				for (auto& mesh : object.model->getMeshes()) {
+					add(mesh);
+				}
+			}
+			else {
+				add(*object.mesh);
+			}
+		}
+	});
+}
+
+int RenderQueue::countChanges() const {
+	int changes = 0;
+	const Item* previous = nullptr;
+	for (const Item& item : items) {
+		bool programChanged = !previous || item.shader != previous->shader;
+		if (programChanged)
+			changes++;
+		if (hasMaterial(*item.mesh) && (programChanged || !sameMaterial(*item.mesh, *previous->mesh)))
+			changes++;
+		if (!previous || item.mesh->getVAO() != previous->mesh->getVAO())
+			changes++;
+		previous = &item;
+	}
+	return changes;
+}
+
+void RenderQueue::sort(bool sorted, JobSystem* jobs) {
+	stats = Stats();
+	this->sorted = sorted;
+	if (sorted && jobs) {
+		// independent of each other, each writes its own stats field
+		JobSystem::Job* parent = jobs->create([] {});
+		jobs->run(jobs->create([this] { stats.unsortedChanges = countChanges(); }, parent));
+		jobs->run(jobs->create([this] { radixSort(entries, scratch); }, parent));
+		jobs->run(jobs->create([this] { sortTransparent(); }, parent));
+		jobs->run(parent);
+		jobs->wait(parent);
+		return;
+	}
+
+	stats.unsortedChanges = countChanges();
+	if (sorted) {
+		radixSort(entries, scratch);
+		sortTransparent();
+	}
+	else {
+		// still grouped by pass so execute finds each pass in one range
+		std::stable_sort(entries.begin(), entries.end(), [](const SortEntry& a, const SortEntry& b) { return (a.key >> 60) < (b.key >> 60); });
+		previousSubmitted.clear();
+	}
+}
+
+void RenderQueue::sortTransparent() {
+	// the same draws as last frame: start from last frame's order, which the camera moving a little barely changes
+	if (!transparent.empty() && transparentSubmitted == previousSubmitted) {
+		// last frame's order with this frame's keys
+		std::vector<DepthSort::Entry>& ordered = transparentScratch;
+		ordered.resize(transparent.size());
+		for (size_t i = 0; i < ordered.size(); i++) {
+			ordered[i] = transparent[previousOrder[i]];
+		}
+		transparent.swap(ordered);
+		stats.transparentCoherent = DepthSort::sortCoherent(transparent, transparentScratch);
+	}
+	else {
+		DepthSort::radixSort(transparent, transparentScratch);
+	}
+
+	previousSubmitted.swap(transparentSubmitted);
+	previousOrder.resize(transparent.size());
+	for (size_t i = 0; i < transparent.size(); i++) {
+		previousOrder[i] = transparent[i].index;
+	}
+}
+
+std::pair<size_t, size_t> RenderQueue::passRange(Pass pass) const {
+	auto first = std::lower_bound(entries.begin(), entries.end(), uint64_t(pass), [](const SortEntry& entry, uint64_t pass) { return (entry.key >> 60) < pass; });
+	auto last = std::lower_bound(first, entries.end(), uint64_t(pass) + 1, [](const SortEntry& entry, uint64_t pass) { return (entry.key >> 60) < pass; });
+	return { size_t(first - entries.begin()), size_t(last - entries.begin()) };
+}
+
+void RenderQueue::record(const CameraFrame& frame, JobSystem* jobs) {
+	// below this the job overhead outweighs what a slice saves
+	const size_t RECORD_GRAIN = 256;
+
+	// drawAt(i) gives the key and item of the pass's i-th draw in drawing order. the replayer orders the lists by key,
+	// unsorted draws use their position instead
+	auto recordPass = [&](Pass pass, size_t count, auto drawAt) {
+		// about one slice per worker, each records into its own list starting from the state the slice before it ends in
+		size_t grain = count;
+		if (jobs)
+			grain = std::max(RECORD_GRAIN, (count + jobs->workerCount() - 1) / jobs->workerCount());
+		std::vector<CommandList>& lists = commandLists[pass];
+		lists.resize(count ? (count + grain - 1) / grain : 0);
+
+		auto recordSlice = [&](size_t first, size_t last) {
+			CommandList& list = lists[first / grain];
+			list.clear();
+			const Item* previous = first > 0 ? drawAt(first - 1).second : nullptr;
+			for (size_t i = first; i < last; i++) {
+				auto [key, item] = drawAt(i);
+				recordItem(list, key, *item, previous, frame);
+				previous = item;
+			}
+		};
+		if (jobs)
+			jobs->parallelFor(count, grain, recordSlice);
+		else if (count > 0)
+			recordSlice(0, count);
+	};
+
+	for (Pass pass : { PASS_OPAQUE, PASS_GBUFFER, PASS_OIT }) {
+		auto [first, last] = passRange(pass);
+		recordPass(pass, last - first, [&, first = first](size_t i) {
+			const SortEntry& entry = entries[first + i];
+			return std::pair<uint64_t, const Item*>(sorted ? entry.key : i, &items[entry.item]);
+		});
+	}
+	recordPass(PASS_TRANSPARENT, transparent.size(), [&](size_t i) {
+		const DepthSort::Entry& entry = transparent[i];
+		return std::pair<uint64_t, const Item*>(sorted ? entry.key : i, &items[transparentItems[entry.index]]);
+	});
+
+	for (auto& lists : commandLists) {
+		for (auto& list : lists) {
+			const CommandList::Counts& counts = list.getCounts();
+			stats.draws += counts.draws;
+			stats.programChanges += counts.programs;
+			stats.materialChanges += counts.materials;
+			stats.vaoChanges += counts.vertexArrays;
+			stats.commandLists++;
+			stats.packets += int(list.getPacketCount());
+		}
+	}
+}
+
+void RenderQueue::execute(Pass pass) {
+	std::vector<const CommandList*> lists;
+	for (auto& list : commandLists[pass]) {
+		lists.push_back(&list);
+	}
+	replayer.replay(lists);
+}
+
+void RenderQueue::executeDepthOnly(Pass pass, Shader& depthShader) {
+	depthShader.use();
+
+	GLuint boundVAO = 0;
+	const SceneObject* object = nullptr;
+	auto [first, last] = passRange(pass);
+	for (size_t i = first; i < last; i++) {
+		const Item& item = items[entries[i].item];
+		if (item.mesh->getVAO() != boundVAO) {
+			boundVAO = item.mesh->getVAO();
+			glBindVertexArray(boundVAO);
+		}
+		if (item.object != object) {
+			object = item.object;
+			depthShader.setMat4("model", object->getModelmatrix());
+		}
+		item.mesh->drawGeometry();
+	}
+	glBindVertexArray(0);
+}
+
+void RenderQueue::recordItem(CommandList& list, uint64_t key, const Item& item, const Item* previous, const CameraFrame& frame) {
+	// decided on the real state, not the key's ids (see denseId)
+	bool programChanged = !previous || item.shader != previous->shader;
+	if (programChanged)
+		list.bindProgram(*item.shader);
+	// samplers and the material index are program state, a new program needs them again
+	if (hasMaterial(*item.mesh) && (programChanged || !sameMaterial(*item.mesh, *previous->mesh)))
+		list.bindMaterial(*item.mesh);
+	if (!previous || item.mesh->getVAO() != previous->mesh->getVAO())
+		list.bindVertexArray(item.mesh->getVAO());
+	if (programChanged || item.object != previous->object)
+		list.setObjectUniforms(item.object->getUniforms(frame));
+
+	list.draw(key, *item.mesh);
+}
+
+void RenderQueue::radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+	size_t count = entries.size();
+	if (count < 2)
+		return;
+	scratch.resize(count);
+
+	// histograms of all 8 bytes in one read
+	size_t histograms[8][256] = {};
+	for (auto& entry : entries) {
+		for (int byte = 0; byte < 8; byte++) {
+			histograms[byte][(entry.key >> (byte * 8)) & 0xFF]++;
+		}
+	}
+
+	for (int byte = 0; byte < 8; byte++) {
+		size_t* histogram = histograms[byte];
+		if (histogram[(entries[0].key >> (byte * 8)) & 0xFF] == count)
+			continue;
+
+		size_t offset = 0;
+		for (int digit = 0; digit < 256; digit++) {
+			size_t bucket = histogram[digit];
+			histogram[digit] = offset;
+			offset += bucket;
+		}
+		for (auto& entry : entries) {
+			scratch[histogram[(entry.key >> (byte * 8)) & 0xFF]++] = entry;
+		}
+		entries.swap(scratch);
+	}
+}
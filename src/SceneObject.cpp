@@ -1,19 +1,38 @@
 #include "SceneObject.h"
+#include "TextureStreamer.h"
 
+#include <algorithm>
 
-SceneObject::SceneObject(Model* model) : model(model) {}
-SceneObject::SceneObject(Mesh* mesh) : mesh(mesh) {}
 
-void SceneObject::draw(Shader& shader, Camera& camera) {
-	shader.use();
+SceneObject::SceneObject(Model* model, TransformSystem& transforms) : model(model), transforms(&transforms), transform(transforms.create()) {}
+SceneObject::SceneObject(Mesh* mesh, TransformSystem& transforms) : mesh(mesh), transforms(&transforms), transform(transforms.create()) {}
+
+void SceneObject::setPosition(const glm::vec3& position) {
+	transforms->setPosition(transform, position);
+}
+
+void SceneObject::setRotation(const glm::vec3& rotation) {
+	glm::quat q = glm::angleAxis(glm::radians(rotation.x), glm::vec3(1, 0, 0))
+		* glm::angleAxis(glm::radians(rotation.y), glm::vec3(0, 1, 0))
+		* glm::angleAxis(glm::radians(rotation.z), glm::vec3(0, 0, 1));
+	transforms->setRotation(transform, q);
+}
+
+void SceneObject::setScale(const glm::vec3& scale) {
+	transforms->setScale(transform, scale);
+}
+
+glm::vec3 SceneObject::getPosition() const {
+	return transforms->getPosition(transform);
+}
 
-	//update model matrix
-	glm::mat4 model = getModelmatrix();
-	shader.setMat4("model", model);
+glm::vec3 SceneObject::getScale() const {
+	return transforms->getScale(transform);
+}
 
-	//update normal matrix
-	glm::mat3 normalMat = glm::transpose(glm::inverse(camera.getViewMatrix() * model));
-	shader.setMat3("normalMat", normalMat);
+void SceneObject::draw(Shader& shader, const CameraFrame& frame) {
+	shader.use();
+	setUniforms(shader, frame);
 
 	if (this->model) {
 		this->model->draw(shader);
@@ -23,21 +42,66 @@ void SceneObject::draw(Shader& shader, Camera& camera) {
 	}
 }
 
-glm::mat4 SceneObject::getModelmatrix() const{
-	glm::mat4 model(1.0f);
+void SceneObject::setUniforms(Shader& shader, const CameraFrame& frame) const {
+	Uniforms uniforms = getUniforms(frame);
+	shader.setMat4("model", uniforms.model);
+	shader.setMat3("normalMat", uniforms.normalMat);
+	if (uniforms.emissive)
+		shader.setVec3("lightColor", uniforms.lightColor);
+}
+
+SceneObject::Uniforms SceneObject::getUniforms(const CameraFrame& frame) const {
+	Uniforms uniforms;
+	uniforms.model = getModelmatrix();
+	//normal matrix, the view has no scale so only its rotation applies to the world space one
+	uniforms.normalMat = glm::mat3(frame.view) * transforms->getNormalMatrix(transform);
+	uniforms.emissive = emissiveColor.has_value();
+	uniforms.lightColor = emissiveColor.value_or(glm::vec3(0.0f));
+	return uniforms;
+}
+
+void SceneObject::requestTextureDetail(TextureStreamer& streamer, const glm::vec3& cameraPosition, float pixelsPerUnit) const {
+	glm::vec3 scale = getScale();
+	glm::vec3 position = getPosition();
+	float maxScale = std::max(std::abs(scale.x), std::max(std::abs(scale.y), std::abs(scale.z)));
+	auto request = [&](const Mesh& mesh) {
+		// projected diameter of the bounding sphere, assuming the texture spans the object once
+		float radius = mesh.getBoundingRadius() * maxScale;
+		float distance = std::max(glm::length(cameraPosition - position) - radius, 0.1f);
+		float pixelSize = 2.0f * radius * pixelsPerUnit / distance;
 
-	//apply translation
-	model = glm::translate(model, position);
+		for (auto& texture : mesh.getTextures()) {
+			streamer.request(texture.id, pixelSize);
+		}
+	};
+
+	if (model) {
+		for (auto& mesh : model->getMeshes()) {
+			request(mesh);
+		}
+	}
+	else {
+		request(*mesh);
+	}
+}
 
-	//apply rotations
-	model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1, 0, 0));
-	model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0, 1, 0));
-	model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0, 0, 1));
+Culling::AABB SceneObject::getWorldBounds() const {
+	Culling::AABB local;
+	if (model) {
+		const std::vector<Mesh>& meshes = model->getMeshes();
+		for (size_t i = 0; i < meshes.size(); i++) {
+			local = i == 0 ? meshes[i].getLocalBounds() : Culling::merge(local, meshes[i].getLocalBounds());
+		}
+	}
+	else {
+		local = mesh->getLocalBounds();
+	}
 
-	//apply scale
-	model = glm::scale(model, scale);
+	return Culling::transformAABB(local, getModelmatrix());
+}
 
-	return model;
+const glm::mat4& SceneObject::getModelmatrix() const{
+	return transforms->getWorldMatrix(transform);
 }
 
 
@@ -3,34 +3,16 @@
 
 // constructor generates the shader on the fly
 // ------------------------------------------------------------------------
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines) :
+    defines(defines) {
     // 1. retrieve the vertex/fragment source code from filePath
     std::string vertexCode;
     std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
 
-    // ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     try
     {
-        // open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-
-        // read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-
-        // close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
-
-        // convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        vertexCode = injectDefines(readSource(vertexPath), defines);
+        fragmentCode = injectDefines(readSource(fragmentPath), defines);
     }
     catch (std::ifstream::failure& e)
     {
@@ -68,6 +50,99 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 }
 
 
+// compute shader constructor
+// ------------------------------------------------------------------------
+Shader::Shader(const char* computePath, const std::vector<std::string>& defines) :
+    defines(defines) {
+    std::string computeCode;
+    try
+    {
+        computeCode = injectDefines(readSource(computePath), defines);
+    }
+    catch (std::ifstream::failure& e)
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+    }
+    const char* cShaderCode = computeCode.c_str();
+
+    unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(compute, 1, &cShaderCode, NULL);
+    glCompileShader(compute);
+    checkCompileErrors(compute, "COMPUTE");
+
+    ID = glCreateProgram();
+    glAttachShader(ID, compute);
+    glLinkProgram(ID);
+    checkCompileErrors(ID, "PROGRAM");
+
+    glDeleteShader(compute);
+}
+
+
+// reads a whole shader file, recursively replacing lines of the form #include "file"
+// ------------------------------------------------------------------------
+std::string Shader::readSource(const std::string& path, int depth) {
+    static constexpr int MAX_INCLUDE_DEPTH = 8;
+
+    std::ifstream file;
+    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    file.open(path);
+    std::stringstream stream;
+    stream << file.rdbuf();
+    file.close();
+
+    std::string directory = path.substr(0, path.find_last_of('/') + 1);
+    std::string line;
+    std::stringstream result;
+    while (std::getline(stream, line)) {
+        size_t first = line.find_first_not_of(" \t");
+        if (first != std::string::npos && line.compare(first, 8, "#include") == 0) {
+            size_t open = line.find('"', first);
+            size_t close = line.find('"', open + 1);
+            if (open == std::string::npos || close == std::string::npos || depth >= MAX_INCLUDE_DEPTH) {
+                std::cout << "ERROR::SHADER::BAD_INCLUDE in " << path << ": " << line << std::endl;
+                continue;
+            }
+            result << readSource(directory + line.substr(open + 1, close - open - 1), depth + 1) << '\n';
+        }
+        else {
+            result << line << '\n';
+        }
+    }
+    return result.str();
+}
+
+// inserts the define lines after the #version directive (which has to stay the first line)
+// ------------------------------------------------------------------------
+std::string Shader::injectDefines(const std::string& source, const std::vector<std::string>& defines) {
+    if (defines.empty())
+        return source;
+
+    std::string defineBlock;
+    for (auto& define : defines)
+        defineBlock += "#define " + define + "\n";
+
+    // no #version directive: the defines simply go first
+    size_t version = source.find("#version");
+    if (version == std::string::npos)
+        return defineBlock + source;
+
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos)
+        return source + "\n" + defineBlock;
+    return source.substr(0, lineEnd + 1) + defineBlock + source.substr(lineEnd + 1);
+}
+
+// true if the shader was compiled with the given define (with or without a value)
+// ------------------------------------------------------------------------
+bool Shader::hasDefine(const std::string& name) const {
+    for (auto& define : defines) {
+        if (define.compare(0, name.size(), name) == 0 && (define.size() == name.size() || define[name.size()] == ' '))
+            return true;
+    }
+    return false;
+}
+
 // activate the shader
 // ------------------------------------------------------------------------
 void Shader::use() {
@@ -127,6 +202,10 @@ void Shader::setMat3(const std::string& name, glm::mat3 value) const {
 }
 
 // ------------------------------------------------------------------------
+void Shader::setVec2(const std::string& name, glm::vec2 value) const {
+    glUniform2f(glGetUniformLocation(ID, name.c_str()), value.x, value.y);
+}
+
 void Shader::setVec3(const std::string& name, glm::vec3 value) const {
     glUniform3f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z);
 }
@@ -134,3 +213,13 @@ void Shader::setVec3(const std::string& name, glm::vec3 value) const {
 void Shader::setVec3(const std::string& name, float x, float y, float z) const {
     glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
 }
+
+// ------------------------------------------------------------------------
+void Shader::setVec4(const std::string& name, glm::vec4 value) const {
+    glUniform4f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z, value.w);
+}
+
+// ------------------------------------------------------------------------
+void Shader::setUint(const std::string& name, unsigned int value) const {
+    glUniform1ui(glGetUniformLocation(ID, name.c_str()), value);
+}
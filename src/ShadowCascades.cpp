@@ -0,0 +1,80 @@
+#include "ShadowCascades.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace ShadowCascades {
+
+	std::vector<float> splitDistances(float nearPlane, float farPlane) {
+		std::vector<float> splits(COUNT + 1);
+		for (int i = 0; i <= COUNT; i++) {
+			float t = float(i) / COUNT;
+			float logarithmic = nearPlane * std::pow(farPlane / nearPlane, t);
+			float uniform = nearPlane + (farPlane - nearPlane) * t;
+			splits[i] = SPLIT_LAMBDA * logarithmic + (1.0f - SPLIT_LAMBDA) * uniform;
+		}
+		splits[0] = nearPlane;
+		splits[COUNT] = farPlane;
+		return splits;
+	}
+
+	glm::mat4 lightView(const glm::vec3& direction) {
+		glm::vec3 forward = glm::normalize(direction);
+		glm::vec3 up = std::abs(forward.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		return glm::lookAt(glm::vec3(0.0f), forward, up);
+	}
+
+	void sliceCorners(const CameraFrame& frame, float splitNear, float splitFar, glm::vec3 corners[8]) {
+		// the near plane's corners, pushed along their rays to the range's depths
+		for (int corner = 0; corner < 4; corner++) {
+			glm::vec2 ndc((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f);
+			glm::vec4 onNearPlane = frame.inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+			glm::vec3 ray = glm::vec3(onNearPlane) / onNearPlane.w;
+			corners[corner] = glm::vec3(frame.inverseView * glm::vec4(ray * (splitNear / -ray.z), 1.0f));
+			corners[corner + 4] = glm::vec3(frame.inverseView * glm::vec4(ray * (splitFar / -ray.z), 1.0f));
+		}
+	}
+
+	Cascade fit(const CameraFrame& frame, float splitNear, float splitFar, const glm::mat4& lightView, int resolution,
+		const Cascade* previous) {
+		glm::vec3 corners[8];
+		sliceCorners(frame, splitNear, splitFar, corners);
+		glm::vec3 center(0.0f);
+		for (const glm::vec3& corner : corners) {
+			center += corner / 8.0f;
+		}
+		float radius = 0.0f;
+		for (const glm::vec3& corner : corners) {
+			radius = std::max(radius, glm::length(corner - center));
+		}
+
+		Cascade cascade;
+		cascade.splitNear = splitNear;
+		cascade.splitFar = splitFar;
+		// the range only turns and moves with the camera, its radius changes by rounding errors alone
+		cascade.radius = std::ceil(radius * 16.0f) / 16.0f;
+		float halfSize = cascade.radius * (1.0f + MARGIN);
+		cascade.texelSize = 2.0f * halfSize / float(resolution);
+
+		// the box holds the sphere as long as the sphere's center is within slack of the box's on every axis
+		glm::vec3 sphereCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+		float slack = MARGIN * cascade.radius;
+		if (previous && previous->radius == cascade.radius && glm::all(glm::lessThanEqual(glm::abs(sphereCenter - previous->center), glm::vec3(slack)))) {
+			cascade.center = previous->center;
+		}
+		else {
+			// whole texels, and at most twice the slack so the sphere is still inside after rounding
+			float step = std::max(std::floor(2.0f * slack / cascade.texelSize), 1.0f) * cascade.texelSize;
+			cascade.center = glm::round(sphereCenter / step) * step;
+		}
+
+		// the light looks down -z. casters between the light and the box are clamped onto the near plane (depth
+		// clamp while rendering), so the box only has to hold the receivers
+		glm::vec3 c = cascade.center;
+		glm::mat4 projection = glm::ortho(c.x - halfSize, c.x + halfSize, c.y - halfSize, c.y + halfSize, -c.z - halfSize, -c.z + halfSize);
+		cascade.viewProjection = projection * lightView;
+		return cascade;
+	}
+}
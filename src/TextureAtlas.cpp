@@ -0,0 +1,136 @@
+#include "TextureAtlas.h"
+#include "TextureCache.h"
+#include "Utils.h"
+#include "GPUMemory.h"
+
+#include <algorithm>
+#include <iostream>
+
+// imgui_draw.cpp compiles its own static copy of stb_rect_pack, do the same here
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+
+TextureAtlas::TextureAtlas(int pageSize, int mipLevels, int maxImageSize) :
+	pageSize(pageSize),
+	mipLevels(std::max(1, mipLevels)),
+	maxImageSize(maxImageSize) {}
+
+TextureAtlas::~TextureAtlas() {
+	for (GLuint page : pages)
+		GPUMemory::untrack(GL_TEXTURE, page);
+	if (!pages.empty())
+		glDeleteTextures((GLsizei)pages.size(), pages.data());
+}
+
+bool TextureAtlas::add(const std::string& name, const std::string& path) {
+	TextureCache::Image image = TextureCache::loadImage(path, Utils::getFlipVerticallyOnLoad());
+	if (!image.data()) {
+		std::cout << "Atlas texture failed to load at path: " << path << std::endl;
+		return false;
+	}
+
+	if (image.width > maxImageSize || image.height > maxImageSize || image.width + 2 * gutter() > pageSize || image.height + 2 * gutter() > pageSize)
+		return false;
+
+	// expand to RGBA so every page can be a single RGBA8 texture
+	PendingImage pendingImage{ name, image.width, image.height, {} };
+	pendingImage.rgba.resize(size_t(image.width) * image.height * 4);
+	const unsigned char* src = image.data();
+	for (size_t i = 0; i < size_t(image.width) * image.height; i++) {
+		unsigned char* dst = &pendingImage.rgba[i * 4];
+		switch (image.channels) {
+		case 1: dst[0] = dst[1] = dst[2] = src[i]; dst[3] = 255; break;
+		case 2: dst[0] = dst[1] = dst[2] = src[i * 2]; dst[3] = src[i * 2 + 1]; break;
+		case 3: dst[0] = src[i * 3]; dst[1] = src[i * 3 + 1]; dst[2] = src[i * 3 + 2]; dst[3] = 255; break;
+		default: std::copy(src + i * 4, src + i * 4 + 4, dst); break;
+		}
+	}
+
+	pending.push_back(std::move(pendingImage));
+	return true;
+}
+
+bool TextureAtlas::build() {
+	// pack in units of the mip alignment so every cell starts and ends on a texel of the coarsest kept mip level
+	const int block = alignment();
+	const int pageBlocks = pageSize / block;
+
+	std::vector<stbrp_rect> remaining;
+	for (int i = 0; i < (int)pending.size(); i++) {
+		stbrp_rect rect{};
+		rect.id = i;
+		rect.w = (pending[i].width + 2 * gutter() + block - 1) / block;
+		rect.h = (pending[i].height + 2 * gutter() + block - 1) / block;
+		remaining.push_back(rect);
+	}
+
+	std::vector<stbrp_node> nodes(pageBlocks);
+	while (!remaining.empty()) {
+		stbrp_context context;
+		stbrp_init_target(&context, pageBlocks, pageBlocks, nodes.data(), (int)nodes.size());
+		stbrp_pack_rects(&context, remaining.data(), (int)remaining.size());
+
+		int page = (int)pages.size();
+		std::vector<unsigned char> pixels(size_t(pageSize) * pageSize * 4, 0);
+		std::vector<stbrp_rect> leftOver;
+
+		for (auto& rect : remaining) {
+			if (!rect.was_packed) {
+				leftOver.push_back(rect);
+				continue;
+			}
+
+			// fill the whole cell, clamping into the image so the gutter replicates its edge texels
+			const PendingImage& image = pending[rect.id];
+			int cellX = rect.x * block, cellY = rect.y * block;
+			int cellW = rect.w * block, cellH = rect.h * block;
+			for (int y = 0; y < cellH; y++) {
+				int srcY = std::clamp(y - gutter(), 0, image.height - 1);
+				for (int x = 0; x < cellW; x++) {
+					int srcX = std::clamp(x - gutter(), 0, image.width - 1);
+					const unsigned char* src = &image.rgba[(size_t(srcY) * image.width + srcX) * 4];
+					unsigned char* dst = &pixels[(size_t(cellY + y) * pageSize + cellX + x) * 4];
+					std::copy(src, src + 4, dst);
+				}
+			}
+
+			Region region;
+			region.uvOffset = glm::vec2(cellX + gutter(), cellY + gutter()) / float(pageSize);
+			region.uvScale = glm::vec2(image.width, image.height) / float(pageSize);
+			region.page = page;
+			regions[image.name] = region;
+		}
+
+		if (leftOver.size() == remaining.size()) {
+			std::cout << "ERROR::TEXTURE_ATLAS:: " << leftOver.size() << " image(s) don't fit on an empty page" << std::endl;
+			return false;
+		}
+
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pageSize, pageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipLevels - 1); // coarser levels would mix images
+		glGenerateMipmap(GL_TEXTURE_2D);
+		GPUMemory::track(GL_TEXTURE, texture, GPUMemory::TEXTURE, GPUMemory::textureBytes(GL_RGBA8, pageSize, pageSize, 1, mipLevels), "atlas page " + std::to_string(page));
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		pages.push_back(texture);
+		remaining = std::move(leftOver);
+	}
+
+	pending.clear();
+	return true;
+}
+
+const TextureAtlas::Region* TextureAtlas::find(const std::string& name) const {
+	auto it = regions.find(name);
+	return it == regions.end() ? nullptr : &it->second;
+}
@@ -0,0 +1,309 @@
+#include <stb_image/stb_image.h>
+
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "TextureCache.h"
+
+namespace fs = std::filesystem;
+
+namespace TextureCache {
+
+	static constexpr uint32_t BLOB_MAGIC = 0x58545443; // "CTTX"
+	static constexpr uint32_t BLOB_VERSION = 1;
+
+	static std::string cacheDirectory = "./cache/textures";
+	static bool cacheEnabled = true;
+
+	// read-only view of a whole file
+	struct Mapping {
+		const unsigned char* data = nullptr;
+		size_t size = 0;
+#ifdef _WIN32
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = NULL;
+#endif
+	};
+
+	static Mapping* mapFile(const std::string& path) {
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return nullptr;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			CloseHandle(file);
+			return nullptr;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			CloseHandle(file);
+			return nullptr;
+		}
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!view) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return nullptr;
+		}
+
+		Mapping* result = new Mapping;
+		result->data = static_cast<const unsigned char*>(view);
+		result->size = static_cast<size_t>(size.QuadPart);
+		result->file = file;
+		result->mapping = mapping;
+		return result;
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return nullptr;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			close(fd);
+			return nullptr;
+		}
+
+		void* view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // the mapping keeps the file alive
+		if (view == MAP_FAILED)
+			return nullptr;
+
+		Mapping* result = new Mapping;
+		result->data = static_cast<const unsigned char*>(view);
+		result->size = static_cast<size_t>(st.st_size);
+		return result;
+#endif
+	}
+
+	static void unmapFile(Mapping* mapping) {
+		if (!mapping)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(mapping->data);
+		CloseHandle(mapping->mapping);
+		CloseHandle(mapping->file);
+#else
+		munmap(const_cast<unsigned char*>(mapping->data), mapping->size);
+#endif
+		delete mapping;
+	}
+
+	// 64 bit FNV-1a
+	static uint64_t hashString(const std::string& str, uint64_t hash = 14695981039346656037ull) {
+		for (unsigned char c : str) {
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	static uint64_t sourceKey(const std::string& path, bool flipVertically) {
+		std::error_code ec;
+		fs::path canonical = fs::weakly_canonical(path, ec);
+		return hashString(flipVertically ? "flip:" : "noflip:", hashString(ec ? path : canonical.generic_string()));
+	}
+
+	static std::string blobPath(uint64_t key) {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+		return cacheDirectory + '/' + name;
+	}
+
+	static bool sourceStats(const std::string& path, int64_t& mtime, uint64_t& size) {
+		std::error_code ec;
+		auto writeTime = fs::last_write_time(path, ec);
+		if (ec)
+			return false;
+		auto fileSize = fs::file_size(path, ec);
+		if (ec)
+			return false;
+
+		mtime = static_cast<int64_t>(writeTime.time_since_epoch().count());
+		size = static_cast<uint64_t>(fileSize);
+		return true;
+	}
+
+	static bool writeBlob(const std::string& blob, const BlobHeader& header, const unsigned char* pixels) {
+		std::error_code ec;
+		fs::create_directories(cacheDirectory, ec);
+
+		// write to a temporary file first so a crash never leaves a truncated blob behind
+		std::string tmp = blob + ".tmp";
+		{
+			std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+			if (!out)
+				return false;
+
+			size_t pixelBytes = size_t(header.width) * header.height * header.channels;
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char*>(pixels), pixelBytes);
+			if (!out)
+				return false;
+		}
+
+		fs::rename(tmp, blob, ec);
+		if (ec) {
+			fs::remove(tmp, ec);
+			return false;
+		}
+		return true;
+	}
+
+	// -------------------------------------------------------------------------------------------------------
+
+	Image::~Image() {
+		release();
+	}
+
+	Image::Image(Image&& other) noexcept {
+		*this = std::move(other);
+	}
+
+	Image& Image::operator=(Image&& other) noexcept {
+		if (this != &other) {
+			release();
+			width = other.width;
+			height = other.height;
+			channels = other.channels;
+			pixels = other.pixels;
+			decoded = other.decoded;
+			mapping = other.mapping;
+
+			other.pixels = nullptr;
+			other.decoded = nullptr;
+			other.mapping = nullptr;
+		}
+		return *this;
+	}
+
+	void Image::release() {
+		if (decoded)
+			stbi_image_free(decoded);
+		unmapFile(static_cast<Mapping*>(mapping));
+
+		pixels = nullptr;
+		decoded = nullptr;
+		mapping = nullptr;
+	}
+
+	// -------------------------------------------------------------------------------------------------------
+
+	void setCacheDirectory(const std::string& directory) {
+		cacheDirectory = directory;
+	}
+
+	void setEnabled(bool enabled) {
+		cacheEnabled = enabled;
+	}
+
+	Image loadImage(const std::string& path, bool flipVertically) {
+		Image image;
+
+		int64_t mtime = 0;
+		uint64_t size = 0;
+		bool haveStats = sourceStats(path, mtime, size);
+		uint64_t key = sourceKey(path, flipVertically);
+		std::string blob = blobPath(key);
+
+		// warm path: map the blob and validate it against the source file
+		if (cacheEnabled && haveStats) {
+			Mapping* mapping = mapFile(blob);
+			if (mapping) {
+				bool valid = false;
+				if (mapping->size >= sizeof(BlobHeader)) {
+					const BlobHeader* header = reinterpret_cast<const BlobHeader*>(mapping->data);
+					size_t pixelBytes = size_t(header->width) * header->height * header->channels;
+					valid = header->magic == BLOB_MAGIC && header->version == BLOB_VERSION &&
+						header->sourceHash == key && header->sourceMTime == mtime && header->sourceSize == size &&
+						header->flipped == uint32_t(flipVertically) &&
+						mapping->size == sizeof(BlobHeader) + pixelBytes;
+
+					if (valid) {
+						image.width = header->width;
+						image.height = header->height;
+						image.channels = header->channels;
+						image.pixels = mapping->data + sizeof(BlobHeader);
+						image.mapping = mapping;
+						return image;
+					}
+				}
+				unmapFile(mapping);
+			}
+		}
+
+		// cold path: decode and write the blob for next time
+		stbi_set_flip_vertically_on_load_thread(flipVertically); // loadImage may run on several threads
+		image.decoded = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+		image.pixels = image.decoded;
+
+		if (image.decoded && cacheEnabled && haveStats) {
+			BlobHeader header{};
+			header.magic = BLOB_MAGIC;
+			header.version = BLOB_VERSION;
+			header.sourceHash = key;
+			header.sourceMTime = mtime;
+			header.sourceSize = size;
+			header.width = image.width;
+			header.height = image.height;
+			header.channels = image.channels;
+			header.flipped = flipVertically;
+
+			if (!writeBlob(blob, header, image.decoded))
+				std::cout << "WARNING::TEXTURE_CACHE:: Failed to write cache blob for: " << path << std::endl;
+		}
+
+		return image;
+	}
+
+	int warm(const std::string& directory, bool flipVertically) {
+		std::error_code ec;
+		int written = 0;
+
+		for (auto it = fs::recursive_directory_iterator(directory, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+			if (!it->is_regular_file())
+				continue;
+
+			std::string ext = it->path().extension().string();
+			for (auto& c : ext)
+				c = static_cast<char>(tolower(c));
+			if (ext != ".png" && ext != ".jpg" && ext != ".jpeg" && ext != ".tga" && ext != ".bmp")
+				continue;
+
+			std::string path = it->path().generic_string();
+			Image image = loadImage(path, flipVertically);
+			if (!image.data()) {
+				std::cout << "WARNING::TEXTURE_CACHE:: Failed to decode: " << path << std::endl;
+				continue;
+			}
+
+			if (!image.fromCache()) {
+				std::cout << "cached " << path << " (" << image.width << "x" << image.height << "x" << image.channels << ")" << std::endl;
+				written++;
+			}
+		}
+
+		if (ec)
+			std::cout << "WARNING::TEXTURE_CACHE:: Failed to walk directory " << directory << ": " << ec.message() << std::endl;
+
+		return written;
+	}
+}
@@ -0,0 +1,228 @@
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "TextureStreamer.h"
+#include "TextureCache.h"
+#include "GPUMemory.h"
+
+
+TextureStreamer::TextureStreamer(size_t uploadBudgetBytes) : uploadBudget(uploadBudgetBytes) {
+	worker = std::thread(&TextureStreamer::workerLoop, this);
+}
+
+TextureStreamer::~TextureStreamer() {
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+	worker.join();
+}
+
+GLuint TextureStreamer::createTexture(const std::string& path, bool flipVertically) {
+	// only the header is read here, the decode happens on the worker
+	int width, height, channels;
+	if (!stbi_info(path.c_str(), &width, &height, &channels))
+		return 0;
+
+	GLenum internalFormat = GL_RGBA8;
+	if (channels == 1)
+		internalFormat = GL_R8;
+	else if (channels == 3)
+		internalFormat = GL_RGB8;
+
+	auto entry = std::make_unique<Entry>();
+	entry->path = path;
+	entry->flip = flipVertically;
+	entry->width = width;
+	entry->height = height;
+	entry->channels = channels;
+	entry->levelCount = 1 + (int)std::floor(std::log2(std::max(width, height)));
+	entry->residentBase = entry->levelCount - 1;
+	entry->wantedLevel = entry->levelCount - 1;
+
+	GLuint textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexStorage2D(GL_TEXTURE_2D, entry->levelCount, internalFormat, width, height);
+	GPUMemory::track(GL_TEXTURE, textureID, GPUMemory::TEXTURE, GPUMemory::textureBytes(internalFormat, width, height, 1, entry->levelCount), path);
+
+	// grey placeholder in the coarsest level until the real data arrives
+	const unsigned char grey[4] = { 128, 128, 128, 255 };
+	glClearTexImage(textureID, entry->residentBase, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry->residentBase);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, channels == 4 ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, channels == 4 ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	Entry* queued = entry.get();
+	entries[textureID] = std::move(entry);
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		decodeQueue.push_back(queued);
+	}
+	queueCondition.notify_one();
+
+	return textureID;
+}
+
+void TextureStreamer::request(GLuint texture, float pixelSize) {
+	auto it = entries.find(texture);
+	if (it == entries.end())
+		return;
+
+	// the level whose size roughly matches the on-screen footprint
+	Entry& entry = *it->second;
+	float texels = float(std::max(entry.width, entry.height));
+	int level = pixelSize <= 1.0f ? entry.levelCount - 1 : (int)std::floor(std::log2(std::max(texels / pixelSize, 1.0f)));
+	entry.wantedLevel = std::min(entry.wantedLevel, std::clamp(level, 0, entry.levelCount - 1));
+}
+
+void TextureStreamer::update() {
+	size_t budget = uploadBudget;
+	bool alignmentChanged = false;
+
+	for (auto& [texture, entryPtr] : entries) {
+		Entry& entry = *entryPtr;
+		if (entry.residentBase == 0 || entry.failed || !entry.decoded.load(std::memory_order_acquire))
+			continue;
+
+		if (entry.levels.empty()) {
+			std::cout << "Texture failed to load at path: " << entry.path << std::endl;
+			entry.failed = true;
+			continue;
+		}
+
+		if (!alignmentChanged) {
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // small mips of RGB textures have rows that aren't 4 byte aligned
+			alignmentChanged = true;
+		}
+
+		GLenum format = GL_RGBA;
+		if (entry.channels == 1)
+			format = GL_RED;
+		else if (entry.channels == 3)
+			format = GL_RGB;
+
+		// walk from the coarsest missing level towards the wanted one. small levels ignore demand and budget, and one
+		// large level per frame may exceed the budget so levels bigger than the whole budget still make progress
+		int finest = entry.residentBase;
+		bool uploaded = false;
+		for (int level = entry.placeholder ? entry.levelCount - 1 : entry.residentBase - 1; level >= 0; level--) {
+			const Level& data = entry.levels[level];
+			bool small = data.width <= IMMEDIATE_MIP_SIZE && data.height <= IMMEDIATE_MIP_SIZE;
+			if (!small && (level < entry.wantedLevel || (data.pixels.size() > budget && budget != uploadBudget)))
+				break;
+
+			glTextureSubImage2D(texture, level, 0, 0, data.width, data.height, format, GL_UNSIGNED_BYTE, data.pixels.data());
+			if (!small)
+				budget -= std::min(budget, data.pixels.size());
+			finest = level;
+			uploaded = true;
+		}
+
+		if (uploaded) {
+			entry.placeholder = false;
+			setResidentBase(texture, entry, finest);
+		}
+
+		// everything is on the GPU, the CPU copy isn't needed anymore
+		if (entry.residentBase == 0) {
+			entry.levels.clear();
+			entry.levels.shrink_to_fit();
+		}
+
+		// requests only hold for one frame
+		entry.wantedLevel = entry.levelCount - 1;
+	}
+
+	if (alignmentChanged)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+int TextureStreamer::residentBaseLevel(GLuint texture) const {
+	auto it = entries.find(texture);
+	return it == entries.end() ? 0 : it->second->residentBase;
+}
+
+void TextureStreamer::lockParameters(GLuint texture) {
+	auto it = entries.find(texture);
+	if (it == entries.end() || it->second->locked)
+		return;
+
+	it->second->locked = true;
+	glTextureParameteri(texture, GL_TEXTURE_BASE_LEVEL, 0);
+}
+
+size_t TextureStreamer::pendingCount() const {
+	size_t count = 0;
+	for (auto& [texture, entry] : entries) {
+		if (entry->residentBase != 0 && !entry->failed)
+			count++;
+	}
+	return count;
+}
+
+void TextureStreamer::setResidentBase(GLuint texture, Entry& entry, int level) {
+	entry.residentBase = level;
+	if (!entry.locked)
+		glTextureParameteri(texture, GL_TEXTURE_BASE_LEVEL, level);
+	version++;
+}
+
+void TextureStreamer::workerLoop() {
+	while (true) {
+		Entry* entry;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this] { return stopping || !decodeQueue.empty(); });
+			if (stopping)
+				return;
+			entry = decodeQueue.front();
+			decodeQueue.pop_front();
+		}
+
+		TextureCache::Image image = TextureCache::loadImage(entry->path, entry->flip);
+		if (image.data() && image.width == entry->width && image.height == entry->height && image.channels == entry->channels)
+			buildMipChain(*entry, image.data());
+
+		entry->decoded.store(true, std::memory_order_release);
+	}
+}
+
+void TextureStreamer::buildMipChain(Entry& entry, const unsigned char* pixels) {
+	const int c = entry.channels;
+	entry.levels.resize(entry.levelCount);
+
+	Level& base = entry.levels[0];
+	base.width = entry.width;
+	base.height = entry.height;
+	base.pixels.assign(pixels, pixels + size_t(entry.width) * entry.height * c);
+
+	// 2x2 box filter, clamping at the edge of odd sized levels
+	for (int i = 1; i < entry.levelCount; i++) {
+		const Level& src = entry.levels[i - 1];
+		Level& dst = entry.levels[i];
+		dst.width = std::max(1, src.width / 2);
+		dst.height = std::max(1, src.height / 2);
+		dst.pixels.resize(size_t(dst.width) * dst.height * c);
+
+		for (int y = 0; y < dst.height; y++) {
+			int y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+			for (int x = 0; x < dst.width; x++) {
+				int x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+				for (int k = 0; k < c; k++) {
+					int sum = src.pixels[(size_t(y0) * src.width + x0) * c + k] + src.pixels[(size_t(y0) * src.width + x1) * c + k]
+						+ src.pixels[(size_t(y1) * src.width + x0) * c + k] + src.pixels[(size_t(y1) * src.width + x1) * c + k];
+					dst.pixels[(size_t(y) * dst.width + x) * c + k] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+}
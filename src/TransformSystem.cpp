@@ -0,0 +1,198 @@
+#include "TransformSystem.h"
+#include "JobSystem.h"
+
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#define TRANSFORMS_SSE
+#endif
+
+TransformSystem::Handle TransformSystem::create(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+	Handle handle = Handle(world.size());
+	posX.push_back(0.0f); posY.push_back(0.0f); posZ.push_back(0.0f);
+	rotX.push_back(0.0f); rotY.push_back(0.0f); rotZ.push_back(0.0f); rotW.push_back(1.0f);
+	scaleX.push_back(1.0f); scaleY.push_back(1.0f); scaleZ.push_back(1.0f);
+	dirty.push_back(0);
+	world.push_back(glm::mat4(1.0f));
+	normal.push_back(glm::mat3(1.0f));
+
+	setPosition(handle, position);
+	setRotation(handle, rotation);
+	setScale(handle, scale);
+	return handle;
+}
+
+void TransformSystem::markDirty(Handle handle) {
+	if (!dirty[handle]) {
+		dirty[handle] = 1;
+		dirtyCount++;
+	}
+}
+
+void TransformSystem::setPosition(Handle handle, const glm::vec3& position) {
+	posX[handle] = position.x; posY[handle] = position.y; posZ[handle] = position.z;
+	markDirty(handle);
+}
+
+void TransformSystem::setRotation(Handle handle, const glm::quat& rotation) {
+	glm::quat q = glm::normalize(rotation);
+	rotX[handle] = q.x; rotY[handle] = q.y; rotZ[handle] = q.z; rotW[handle] = q.w;
+	markDirty(handle);
+}
+
+void TransformSystem::setScale(Handle handle, const glm::vec3& scale) {
+	scaleX[handle] = scale.x; scaleY[handle] = scale.y; scaleZ[handle] = scale.z;
+	markDirty(handle);
+}
+
+size_t TransformSystem::update() {
+	if (dirtyCount == 0)
+		return 0;
+
+	size_t recomposed = updateRange(0, world.size());
+	dirtyCount = 0;
+	return recomposed;
+}
+
+size_t TransformSystem::update(JobSystem& jobs) {
+	if (dirtyCount == 0)
+		return 0;
+	// a few dirty transforms are quicker to find and compose than to hand out
+	if (dirtyCount < PARALLEL_GRAIN)
+		return update();
+
+	// ranges start at multiples of 4, so the SSE blocks never straddle two jobs
+	std::atomic<size_t> recomposed = 0;
+	jobs.parallelFor(world.size(), PARALLEL_GRAIN, [&](size_t first, size_t last) {
+		recomposed += updateRange(first, last);
+	});
+	dirtyCount = 0;
+	return recomposed;
+}
+
+size_t TransformSystem::updateRange(size_t first, size_t last) {
+	size_t recomposed = 0;
+	size_t i = first;
+
+#if defined(TRANSFORMS_SSE)
+	// blocks of 4 neighbours, skipped as a whole when none of them changed
+	for (; i + 4 <= last; i += 4) {
+		uint32_t blockDirty = dirty[i] | dirty[i + 1] | dirty[i + 2] | dirty[i + 3];
+		if (!blockDirty)
+			continue;
+		composeBlock(i);
+		for (size_t j = i; j < i + 4; j++) {
+			recomposed += dirty[j];
+			dirty[j] = 0;
+		}
+	}
+#endif
+
+	for (; i < last; i++) {
+		if (dirty[i]) {
+			composeScalar(i);
+			dirty[i] = 0;
+			recomposed++;
+		}
+	}
+	return recomposed;
+}
+
+// columns of the rotation matrix of a unit quaternion (same as glm::mat3_cast)
+//   c0 = (1 - 2(yy + zz), 2(xy + wz), 2(xz - wy))
+//   c1 = (2(xy - wz), 1 - 2(xx + zz), 2(yz + wx))
+//   c2 = (2(xz + wy), 2(yz - wx), 1 - 2(xx + yy))
+// world = [c0 * sx, c1 * sy, c2 * sz, position], normal = [c0 / sx, c1 / sy, c2 / sz]
+void TransformSystem::composeScalar(size_t index) {
+	float x = rotX[index], y = rotY[index], z = rotZ[index], w = rotW[index];
+	glm::vec3 c0(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y));
+	glm::vec3 c1(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x));
+	glm::vec3 c2(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y));
+
+	glm::vec3 scale(scaleX[index], scaleY[index], scaleZ[index]);
+	glm::vec3 inverseScale = glm::vec3(scale.x != 0.0f ? 1.0f / scale.x : 0.0f, scale.y != 0.0f ? 1.0f / scale.y : 0.0f, scale.z != 0.0f ? 1.0f / scale.z : 0.0f);
+
+	glm::mat4& m = world[index];
+	m[0] = glm::vec4(c0 * scale.x, 0.0f);
+	m[1] = glm::vec4(c1 * scale.y, 0.0f);
+	m[2] = glm::vec4(c2 * scale.z, 0.0f);
+	m[3] = glm::vec4(posX[index], posY[index], posZ[index], 1.0f);
+
+	glm::mat3& n = normal[index];
+	n[0] = c0 * inverseScale.x;
+	n[1] = c1 * inverseScale.y;
+	n[2] = c2 * inverseScale.z;
+}
+
+void TransformSystem::composeBlock(size_t first) {
+#if defined(TRANSFORMS_SSE)
+	const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+
+	__m128 x = _mm_loadu_ps(&rotX[first]), y = _mm_loadu_ps(&rotY[first]), z = _mm_loadu_ps(&rotZ[first]), w = _mm_loadu_ps(&rotW[first]);
+	__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+	__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+	__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+	// rotation columns, one register per component across the 4 transforms
+	__m128 c[3][3] = {
+		{ _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), _mm_mul_ps(two, _mm_add_ps(xy, wz)), _mm_mul_ps(two, _mm_sub_ps(xz, wy)) },
+		{ _mm_mul_ps(two, _mm_sub_ps(xy, wz)), _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), _mm_mul_ps(two, _mm_add_ps(yz, wx)) },
+		{ _mm_mul_ps(two, _mm_add_ps(xz, wy)), _mm_mul_ps(two, _mm_sub_ps(yz, wx)), _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))) }
+	};
+
+	__m128 scale[3] = { _mm_loadu_ps(&scaleX[first]), _mm_loadu_ps(&scaleY[first]), _mm_loadu_ps(&scaleZ[first]) };
+	__m128 inverseScale[3];
+	for (int axis = 0; axis < 3; axis++) {
+		// zero scale gets a zero normal column instead of infinities
+		__m128 nonZero = _mm_cmpneq_ps(scale[axis], zero);
+		inverseScale[axis] = _mm_and_ps(_mm_div_ps(one, scale[axis]), nonZero);
+	}
+
+	// world matrix columns: transpose each column from "component per register" to "transform per register"
+	for (int column = 0; column < 3; column++) {
+		__m128 r0 = _mm_mul_ps(c[column][0], scale[column]);
+		__m128 r1 = _mm_mul_ps(c[column][1], scale[column]);
+		__m128 r2 = _mm_mul_ps(c[column][2], scale[column]);
+		__m128 r3 = zero;
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_storeu_ps(&world[first + 0][column][0], r0);
+		_mm_storeu_ps(&world[first + 1][column][0], r1);
+		_mm_storeu_ps(&world[first + 2][column][0], r2);
+		_mm_storeu_ps(&world[first + 3][column][0], r3);
+	}
+	__m128 t0 = _mm_loadu_ps(&posX[first]), t1 = _mm_loadu_ps(&posY[first]), t2 = _mm_loadu_ps(&posZ[first]), t3 = one;
+	_MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+	_mm_storeu_ps(&world[first + 0][3][0], t0);
+	_mm_storeu_ps(&world[first + 1][3][0], t1);
+	_mm_storeu_ps(&world[first + 2][3][0], t2);
+	_mm_storeu_ps(&world[first + 3][3][0], t3);
+
+	// normal matrices are 3x3, written out per lane
+	alignas(16) float lanes[3][3][4];
+	for (int column = 0; column < 3; column++) {
+		for (int row = 0; row < 3; row++) {
+			_mm_store_ps(lanes[column][row], _mm_mul_ps(c[column][row], inverseScale[column]));
+		}
+	}
+	for (int lane = 0; lane < 4; lane++) {
+		glm::mat3& n = normal[first + lane];
+		for (int column = 0; column < 3; column++) {
+			n[column] = glm::vec3(lanes[column][0][lane], lanes[column][1][lane], lanes[column][2][lane]);
+		}
+	}
+#else
+	for (size_t i = first; i < first + 4; i++) {
+		composeScalar(i);
+	}
+#endif
+}
+
+const char* TransformSystem::simdPath() {
+#if defined(TRANSFORMS_SSE)
+	return "SSE";
+#else
+	return "scalar";
+#endif
+}
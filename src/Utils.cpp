@@ -1,18 +1,41 @@
-#include <stb_image/stb_image.h>
-
 #include "Utils.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "GPUMemory.h"
 
 namespace Utils {
 
+    static bool flipOnLoad = false;
+    static TextureStreamer* textureStreamer = nullptr;
+
+    void setFlipVerticallyOnLoad(bool flip) {
+        flipOnLoad = flip;
+    }
+
+    bool getFlipVerticallyOnLoad() {
+        return flipOnLoad;
+    }
+
+    void setTextureStreamer(TextureStreamer* streamer) {
+        textureStreamer = streamer;
+    }
+
     GLuint textureFromFile(const char* path, const std::string& directory) {
         std::string filename = std::string(path);
         filename = directory + '/' + filename;
 
+        if (textureStreamer) {
+            GLuint streamed = textureStreamer->createTexture(filename, flipOnLoad);
+            if (streamed)
+                return streamed;
+        }
+
         GLuint textureID;
         glGenTextures(1, &textureID);
 
-        int width, height, nrComponents;
-        unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+        TextureCache::Image image = TextureCache::loadImage(filename, flipOnLoad);
+        int width = image.width, height = image.height, nrComponents = image.channels;
+        const unsigned char* data = image.data();
 
         if (data) {
             GLenum format;
@@ -26,6 +49,7 @@ namespace Utils {
             glBindTexture(GL_TEXTURE_2D, textureID);
             glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
             glGenerateMipmap(GL_TEXTURE_2D);
+            GPUMemory::track(GL_TEXTURE, textureID, GPUMemory::TEXTURE, GPUMemory::textureBytes(format, width, height, 1, GPUMemory::fullMipCount(width, height)), filename);
 
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT); 
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
@@ -36,7 +60,6 @@ namespace Utils {
         else {
             std::cout << "Texture failed to load at path: " << path << std::endl;
         }
-        stbi_image_free(data);
 
         return textureID;
     }
@@ -59,9 +82,11 @@ namespace Utils {
         glGenTextures(1, &textureID);
         glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-        int width, height, nrChannels;
+        size_t bytes = 0;
         for (unsigned int i = 0; i < faces.size(); i++){
-            unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
+            TextureCache::Image image = TextureCache::loadImage(faces[i], flipOnLoad);
+            int width = image.width, height = image.height, nrChannels = image.channels;
+            const unsigned char* data = image.data();
             if (data){
                 GLenum format;
                 if (nrChannels == 1)
@@ -72,11 +97,11 @@ namespace Utils {
                     format = GL_RGBA;
 
                 glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+                bytes += GPUMemory::textureBytes(format, width, height);
             }
             else{
                 std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
             }
-            stbi_image_free(data);
         }
 
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -84,6 +109,7 @@ namespace Utils {
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        GPUMemory::track(GL_TEXTURE, textureID, GPUMemory::CUBEMAP, bytes, faces.empty() ? "" : faces[0]);
 
         return textureID;
     }
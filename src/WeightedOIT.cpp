@@ -0,0 +1,46 @@
+#include "WeightedOIT.h"
+
+WeightedOIT::WeightedOIT() {
+	// the composite triangle is generated from gl_VertexID, core profile still wants a vertex array bound
+	glCreateVertexArrays(1, &emptyVAO);
+}
+
+WeightedOIT::~WeightedOIT() {
+	glDeleteVertexArrays(1, &emptyVAO);
+}
+
+void WeightedOIT::begin(GLuint framebuffer) {
+	const float noColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const float fullyRevealed[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+	glClearNamedFramebufferfv(framebuffer, GL_COLOR, 0, noColor);
+	glClearNamedFramebufferfv(framebuffer, GL_COLOR, 1, fullyRevealed);
+
+	// tested against the opaque depth, never written: every transparent layer contributes
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	glBlendFunci(0, GL_ONE, GL_ONE);
+	glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+}
+
+void WeightedOIT::end() {
+	glDepthMask(GL_TRUE);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void WeightedOIT::composite(Shader& compositeShader, GLuint accumulation, GLuint revealage) {
+	compositeShader.use();
+	compositeShader.setInt("accumulation", 0);
+	compositeShader.setInt("revealage", 1);
+	glBindTextureUnit(0, accumulation);
+	glBindTextureUnit(1, revealage);
+
+	glDisable(GL_DEPTH_TEST);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glBindVertexArray(emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+
+	glBindTextureUnit(0, 0);
+	glBindTextureUnit(1, 0);
+}
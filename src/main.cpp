@@ -17,6 +17,8 @@
 #include <vector>
 #include <map>
 #include <array>
+#include <cstdlib>
+#include <numeric>
 
 #include "Shader.h"
 #include "Camera.h"
@@ -25,6 +27,28 @@
 #include "SceneObject.h"
 #include "Cubemap.h"
 #include "GUI.h"
+#include "TextureCache.h"
+#include "MaterialTable.h"
+#include "TextureAtlas.h"
+#include "GPUMemory.h"
+#include "TextureStreamer.h"
+#include "BVH.h"
+#include "Benchmarks.h"
+#include "GPUCulling.h"
+#include "HiZ.h"
+#include "TransformSystem.h"
+#include "RenderQueue.h"
+#include "ClusteredLighting.h"
+#include "LightManager.h"
+#include "DeferredShading.h"
+#include "CascadedShadows.h"
+#include "WeightedOIT.h"
+#include "FragmentCounter.h"
+#include "PostProcessStack.h"
+#include "DynamicResolution.h"
+#include "RenderGraph.h"
+#include "JobSystem.h"
+#include "Profiler.h"
 
 
 // function prototypes
@@ -33,12 +57,16 @@ void processInput(GLFWwindow* window);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 
 void orbitLights(SceneObject& light1, SceneObject& light2);
+LightManager::PointLight randomPointLight();
+void buildPostProcessStack(PostProcessStack& stack, int mode);
 
 // global variables
 const unsigned int WINDOW_WIDTH = 1920;
 const unsigned int WINDOW_HEIGHT = 1080;
+int screenWidth = WINDOW_WIDTH, screenHeight = WINDOW_HEIGHT; // framebuffer size, kept up to date by framebuffer_size_callback
 
 float deltaTime = 0.0f;	// Time between current frame and last frame
 float lastFrame = 0.0f; // Time of last frame
@@ -49,9 +77,41 @@ bool firstMouse = true;
 
 bool enableFlashLight = false;
 bool mouseGUIEnabled = false;
+bool pickRequested = false;
 
 
-int main() {
+int main(int argc, char** argv) {
+    // command line flags
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        // decode every resource into the texture cache and exit, so the next run starts warm
+        if (arg == "--warm-texture-cache") {
+            int written = TextureCache::warm("./resources/textures", false);
+            written += TextureCache::warm("./resources/models", true); // models are loaded flipped, see below
+            std::cout << "Texture cache warmed, " << written << " blob(s) written" << std::endl;
+            return 0;
+        }
+        else if (arg == "--no-texture-cache") {
+            TextureCache::setEnabled(false);
+        }
+        else if (arg == "--bench-bvh") {
+            return Benchmarks::bvh(i + 1 < argc ? std::atoi(argv[i + 1]) : 100000);
+        }
+        else if (arg == "--bench-transforms") {
+            return Benchmarks::transforms(i + 1 < argc ? std::atoi(argv[i + 1]) : 100000);
+        }
+        else if (arg == "--bench-transparent-sort") {
+            return Benchmarks::transparentSort(i + 1 < argc ? std::atoi(argv[i + 1]) : 20000);
+        }
+        else if (arg == "--bench-clusters") {
+            return Benchmarks::clusters(i + 1 < argc ? std::atoi(argv[i + 1]) : 4096);
+        }
+        else if (arg == "--bench-shadows") {
+            return Benchmarks::shadows(i + 1 < argc ? std::atoi(argv[i + 1]) : 3600);
+        }
+    }
+
     // initialize GLFW (create window and OpenGL context)
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -81,31 +141,55 @@ int main() {
 
     // set callbacks
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwGetFramebufferSize(window, &screenWidth, &screenHeight);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetKeyCallback(window, keyCallback);
+    glfwSetMouseButtonCallback(window, mouseButtonCallback);
 
     //initialize GUI
     GUI::initGUI(window);
 
+    // bindless textures if available, texture arrays otherwise
+    MaterialTable::loadBindlessExtension((GLADloadproc)glfwGetProcAddress);
+    std::vector<std::string> materialDefines = MaterialTable::shaderDefines();
+
     // set up shaders
     std::vector<Shader*> shaders;
 
-    Shader objectShader("./shaders/objectVS.glsl", "./shaders/objectFS.glsl");
+    Shader objectShader("./shaders/objectVS.glsl", "./shaders/objectFS.glsl", materialDefines);
     shaders.push_back(&objectShader);
+    Shader gbufferShader("./shaders/objectVS.glsl", "./shaders/gbufferFS.glsl", materialDefines);
+    shaders.push_back(&gbufferShader);
     Shader lightShader("./shaders/lightVS.glsl", "./shaders/lightFS.glsl");
     shaders.push_back(&lightShader);
     Shader depthShader("./shaders/depthTestVS.glsl", "./shaders/depthTestFS.glsl");
     shaders.push_back(&depthShader);
-    Shader simpleShader("./shaders/simpleVS.glsl", "./shaders/simpleFS.glsl");
+    Shader depthIndirectShader("./shaders/depthTestVS.glsl", "./shaders/depthTestFS.glsl", { "GPU_CULLING" });
+    shaders.push_back(&depthIndirectShader);
+    Shader simpleShader("./shaders/simpleVS.glsl", "./shaders/simpleFS.glsl", materialDefines);
     shaders.push_back(&simpleShader);
+    Shader oitAccumulateShader("./shaders/simpleVS.glsl", "./shaders/oitAccumulateFS.glsl", materialDefines);
+    shaders.push_back(&oitAccumulateShader);
     Shader singleColorShader("./shaders/simpleVS.glsl", "./shaders/singleColorFS.glsl");
     shaders.push_back(&singleColorShader);
     Shader skyboxShader("./shaders/skyboxVS.glsl", "./shaders/skyboxFS.glsl");
     shaders.push_back(&skyboxShader);
+    Shader depthPrepassShader("./shaders/depthPrepassVS.glsl", "./shaders/depthPrepassFS.glsl");
+    shaders.push_back(&depthPrepassShader);
+
 
+    Shader frameBufferShader("./shaders/fullscreenTriangleVS.glsl", "./shaders/frameBufferFS.glsl");
+    Shader oitCompositeShader("./shaders/fullscreenTriangleVS.glsl", "./shaders/oitCompositeFS.glsl");
+    Shader deferredLightingShader("./shaders/fullscreenTriangleVS.glsl", "./shaders/deferredLightingFS.glsl");
+    Shader skyboxTriangleShader("./shaders/skyboxTriangleVS.glsl", "./shaders/skyboxFS.glsl");
+    Shader shadowDepthShader("./shaders/shadowDepthVS.glsl", "./shaders/depthPrepassFS.glsl");
 
-    Shader frameBufferShader("./shaders/frameBufferVS.glsl", "./shaders/frameBufferFS.glsl");
+    // compute shaders (not in shaders, they have no view/projection)
+    Shader cullInstancesShader("./shaders/cullInstancesCS.glsl");
+    Shader hiZDownsampleShader("./shaders/hiZDownsampleCS.glsl");
+    Shader postProcessShader("./shaders/postProcessCS.glsl");
+    Shader assignLightsShader("./shaders/assignLightsCS.glsl");
 
     // ++++++++++++++++++++++++++++++++++++++++++++++++++++ VERTEX DATA ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
     
@@ -266,17 +350,6 @@ int main() {
         1.0f,  0.5f,  0.0f,  1.0f,  0.0f
     };
 
-    std::vector<float> quadVertices = {
-        // positions   // texCoords
-        -1.0f,  1.0f,  0.0f, 1.0f,
-        -1.0f, -1.0f,  0.0f, 0.0f,
-         1.0f, -1.0f,  1.0f, 0.0f,
-
-        -1.0f,  1.0f,  0.0f, 1.0f,
-         1.0f, -1.0f,  1.0f, 0.0f,
-         1.0f,  1.0f,  1.0f, 1.0f
-    };
-
 
     std::vector<glm::vec3> lightColors = {
         glm::vec3(1.0f, 0.0f, 0.0f),
@@ -303,45 +376,38 @@ int main() {
     windowPositions.push_back(glm::vec3(0.7f, 0.0f, -2.3f));
     windowPositions.push_back(glm::vec3(1.5f, 0.0f, -0.6f));
 
-    GLuint framebuffer;
-    glGenFramebuffers(1, &framebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-
-    // generate texture
-    GLuint textureColorbuffer;
-    glGenTextures(1, &textureColorbuffer);
-    glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    // attach it to currently bound framebuffer object
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorbuffer, 0);
-
-    GLuint rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, WINDOW_WIDTH, WINDOW_HEIGHT);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    // the offscreen targets are transient textures of the render graph, declared again every frame. the graph pools
+    // them across frames and only reallocates the screen sized ones when the window is resized
+    RenderGraph renderGraph(screenWidth, screenHeight);
 
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+    // the targets are screen sized, the scene renders into the part of them the dynamic resolution picks
+    DynamicResolution dynamicResolution(screenWidth, screenHeight);
 
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // blend state and composite for order independent transparency, its targets come from the graph
+    WeightedOIT weightedOIT;
+    DeferredShading deferredShading;
 
     // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
     GUI::GUISettings guiSettings;
 
+    // 2D textures stream in their mip levels progressively, finest levels only once they are needed on screen
+    TextureStreamer textureStreamer;
+    Utils::setTextureStreamer(&textureStreamer);
+
     // load textures
     GLuint container2DiffuseMap = Utils::textureFromFile("container2.png", "./resources/textures");
     GLuint container2SpecularMap = Utils::textureFromFile("container2_specular.png", "./resources/textures");
     GLuint marbleDiffuseMap = Utils::textureFromFile("marble.jpg", "./resources/textures");
     GLuint metalDiffuseMap = Utils::textureFromFile("metal.png", "./resources/textures");
-    GLuint grassDiffuseMap = Utils::textureFromFile("grass.png", "./resources/textures");
-    GLuint redWindowDiffMap = Utils::textureFromFile("blending_transparent_window.png", "./resources/textures");
+
+    // small sprite textures share an atlas page (so their quads share a material), they only get their own texture if packing fails
+    TextureAtlas spriteAtlas(1024);
+    bool spritesAtlased = spriteAtlas.add("grass", "./resources/textures/grass.png")
+        && spriteAtlas.add("window", "./resources/textures/blending_transparent_window.png")
+        && spriteAtlas.build();
+    GLuint grassDiffuseMap = spritesAtlased ? 0 : Utils::textureFromFile("grass.png", "./resources/textures");
+    GLuint redWindowDiffMap = spritesAtlased ? 0 : Utils::textureFromFile("blending_transparent_window.png", "./resources/textures");
 
 
     // cubemaps
@@ -356,17 +422,28 @@ int main() {
 
     const int numSkyBoxes = 10;
 
-    std::array<GLuint, numSkyBoxes> skyboxes = {
-        Utils::loadCubemap(skybox1Faces),
-        Utils::loadCubemap("./resources/textures/cubemaps/SkyHighFluffyCloud"),
-        Utils::loadCubemap("./resources/textures/cubemaps/PlanetaryEarth"),
-        Utils::loadCubemap("./resources/textures/cubemaps/MegaSun"),
-        Utils::loadCubemap("./resources/textures/cubemaps/highFantasy"),
-        Utils::loadCubemap("./resources/textures/cubemaps/underTheSea"),
-        Utils::loadCubemap("./resources/textures/cubemaps/CasualDay"),
-        Utils::loadCubemap("./resources/textures/cubemaps/DayInTheClouds"),
-        Utils::loadCubemap("./resources/textures/cubemaps/DarkStorm"),
-        Utils::loadCubemap("./resources/textures/cubemaps/CoriolisNight")
+    // skyboxes are loaded the first time they're selected and may be evicted again when over the memory budget
+    // (they're the biggest textures by far and only one is on screen at a time)
+    const char* skyboxFolders[numSkyBoxes] = {
+        nullptr, // uses skybox1Faces
+        "./resources/textures/cubemaps/SkyHighFluffyCloud",
+        "./resources/textures/cubemaps/PlanetaryEarth",
+        "./resources/textures/cubemaps/MegaSun",
+        "./resources/textures/cubemaps/highFantasy",
+        "./resources/textures/cubemaps/underTheSea",
+        "./resources/textures/cubemaps/CasualDay",
+        "./resources/textures/cubemaps/DayInTheClouds",
+        "./resources/textures/cubemaps/DarkStorm",
+        "./resources/textures/cubemaps/CoriolisNight"
+    };
+
+    std::array<GLuint, numSkyBoxes> skyboxes{};
+    auto loadSkybox = [&](int index) {
+        skyboxes[index] = skyboxFolders[index] ? Utils::loadCubemap(skyboxFolders[index]) : Utils::loadCubemap(skybox1Faces);
+        GPUMemory::setEvictable(GL_TEXTURE, skyboxes[index], [&skyboxes, index]() {
+            glDeleteTextures(1, &skyboxes[index]);
+            skyboxes[index] = 0;
+        });
     };
 
     const char* skyboxOptions[numSkyBoxes] = {
@@ -386,91 +463,183 @@ int main() {
     guiSettings.numSkyBoxOptions = numSkyBoxes;
 
     //meshes and models
-    stbi_set_flip_vertically_on_load(true);
+    Utils::setFlipVerticallyOnLoad(true);
     Model backpackModel("./resources/models/backpack/backpack.obj");
 
-    Mesh cubeContainer2(verticesCube, { 3, 3, 2 }, { {container2DiffuseMap, "texture_diffuse", ""}, {container2SpecularMap, "texture_specular", ""} });
+    // the container cube is indexed so that GPU culling can draw it with indirect elements commands
+    std::vector<unsigned int> cubeIndices(verticesCube.size() / 8);
+    std::iota(cubeIndices.begin(), cubeIndices.end(), 0);
+    Mesh cubeContainer2(verticesCube, { 3, 3, 2 }, { {container2DiffuseMap, "texture_diffuse", ""}, {container2SpecularMap, "texture_specular", ""} }, cubeIndices);
     Mesh cubeMarble(verticesCubeNoNorms, { 3, 2 }, { {marbleDiffuseMap, "texture_diffuse", ""} });
     Mesh lightMesh(verticesCube, { 3, 3, 2 }, {});
     Mesh plane(verticesPlane, { 3, 2 }, { {metalDiffuseMap, "texture_diffuse", ""} });
     Mesh grassQuad(transparentVertices, { 3, 2 }, { {grassDiffuseMap, "texture_diffuse", ""} });
     Mesh windowQuad(transparentVertices, { 3, 2 }, { {redWindowDiffMap, "texture_diffuse", ""} });
-    Mesh frameBufferQuadMesh(quadVertices, { 2, 2 }, { {textureColorbuffer, "texture_diffuse", ""} });
 
+    if (spritesAtlased) {
+        grassQuad.useAtlasRegion(spriteAtlas, "grass", 1);
+        windowQuad.useAtlasRegion(spriteAtlas, "window", 1);
+    }
+
+    // material table
+    MaterialTable materialTable;
+    materialTable.setStreamer(&textureStreamer);
+    backpackModel.registerMaterials(materialTable);
+    for (Mesh* mesh : { &cubeContainer2, &cubeMarble, &plane, &grassQuad, &windowQuad }) {
+        mesh->registerMaterial(materialTable);
+    }
+    materialTable.upload();
+    materialTable.bind(shaders);
 
-    //scene objects
-    SceneObject backpack(&backpackModel);
-    backpack.position = glm::vec3(0.0f, 8.0f, 0.0f);
-    SceneObject floor(&plane);
 
-    SceneObject cube1(&cubeMarble);
-    cube1.position = glm::vec3(-2.0f, 0.01, 3.0f);
-    SceneObject cube2(&cubeMarble);
-    cube2.position = glm::vec3(-1.4f, 0.01, -2.8f);
+    //scene objects, their matrices are recomposed by transforms.update() whenever they move
+    TransformSystem transforms;
+    SceneObject backpack(&backpackModel, transforms);
+    backpack.setPosition(glm::vec3(0.0f, 8.0f, 0.0f));
+    SceneObject floor(&plane, transforms);
+
+    SceneObject cube1(&cubeMarble, transforms);
+    cube1.setPosition(glm::vec3(-2.0f, 0.01, 3.0f));
+    SceneObject cube2(&cubeMarble, transforms);
+    cube2.setPosition(glm::vec3(-1.4f, 0.01, -2.8f));
 
     std::vector<SceneObject> cubes;
     for (int i = 0; i < cubePositions.size(); i++) {
-        cubes.push_back(SceneObject(&cubeContainer2));
-        cubes[i].position = cubePositions[i];
+        cubes.push_back(SceneObject(&cubeContainer2, transforms));
+        cubes[i].setPosition(cubePositions[i]);
+    }
+    transforms.update();
+
+    // the cubes never move, their transforms are uploaded once for GPU culling
+    GPUCulling cubeCulling(cubeContainer2);
+    std::vector<glm::mat4> cubeTransforms;
+    for (auto& cube : cubes) {
+        cubeTransforms.push_back(cube.getModelmatrix());
     }
+    cubeCulling.setInstances(cubeTransforms);
 
-    SceneObject light1(&lightMesh);
-    light1.scale = glm::vec3(0.2f);
-    SceneObject light2(&lightMesh);
-    light2.scale = glm::vec3(0.2f);
+    // farthest depth pyramid for occlusion culling the cubes, rebuilt every frame after the occluders are drawn
+    HiZ hiZ(screenWidth, screenHeight);
+
+    SceneObject light1(&lightMesh, transforms);
+    light1.setScale(glm::vec3(0.2f));
+    light1.emissiveColor = lightColors[0];
+    SceneObject light2(&lightMesh, transforms);
+    light2.setScale(glm::vec3(0.2f));
+    light2.emissiveColor = lightColors[1];
 
 
     std::vector<SceneObject> vegetation;
     for (int i = 0; i < grassPositions.size(); i++) {
-        vegetation.push_back(SceneObject(&grassQuad));
-        vegetation[i].position = grassPositions[i];
+        vegetation.push_back(SceneObject(&grassQuad, transforms));
+        vegetation[i].setPosition(grassPositions[i]);
     }
 
 
     std::vector<SceneObject> transparentObjects;
     for (int i = 0; i < windowPositions.size(); i++) {
-        SceneObject obj(&windowQuad);
-        obj.position = windowPositions[i];
+        SceneObject obj(&windowQuad, transforms);
+        obj.setPosition(windowPositions[i]);
         transparentObjects.push_back(obj);
     }
+    transforms.update();
+
+    // everything in the world goes through frustum culling (pointers into the vectors stay valid, they're never resized)
+    std::vector<SceneObject*> cullableObjects{ &backpack, &floor, &cube1, &cube2, &light1, &light2 };
+    for (auto* objects : { &cubes, &vegetation, &transparentObjects }) {
+        for (auto& obj : *objects) {
+            cullableObjects.push_back(&obj);
+        }
+    }
+    Culling::BoxList cullingBoxes;
+    std::vector<uint8_t> cullingVisibility;
+    std::vector<uint32_t> visibleObjects;
+
+    // the BVH is built once and refit every frame (the lights orbit)
+    std::vector<Culling::AABB> worldBounds;
+    for (SceneObject* obj : cullableObjects) {
+        worldBounds.push_back(obj->getWorldBounds());
+    }
+    BVH sceneBVH;
+    sceneBVH.build(worldBounds);
 
-    SceneObject frameBufferQuad(&frameBufferQuadMesh);
+    // post processing runs as compute passes over the scene's color texture, rebuilt when the mode changes
+    PostProcessStack postProcessStack;
+    int postProcessingMode = -1;
+
+    // the frame's CPU work that doesn't touch GL (transforms, bounds, culling, building and sorting the draw list) is
+    // spread over all cores, the main thread works on it too while it waits
+    JobSystem jobs;
+
+    // CPU and GPU time of the frame's scopes and render graph passes, shown in the GUI a few frames late
+    Profiler profiler;
+    guiSettings.profiler = &profiler;
+
+    // everything but the skybox, the GPU culled cubes and the screen quad is drawn through the queue
+    RenderQueue renderQueue;
+    const float nearDepth = 0.1f, farDepth = 100.0f;
+
+    // shaded fragments of the opaque pass and the skybox, for the overdraw numbers in the GUI
+    FragmentCounter opaqueFragments, skyboxFragments;
     Cubemap skybox(skyboxVertices, 0);
 
-    // material properties
+    // material properties, the deferred path has them for every pixel
     objectShader.use();
     objectShader.setFloat("material.shininess", 32.0f);
+    deferredLightingShader.use();
+    deferredLightingShader.setFloat("shininess", 32.0f);
+
+    // every light lives in LightManager's buffers, the lit shaders index them directly. the fragment shaders only
+    // loop over the point lights listed for their cluster
+    LightManager lightManager;
+    ClusteredLighting clusteredLighting(nearDepth, farDepth);
+    clusteredLighting.setUniforms(objectShader);
+    clusteredLighting.setUniforms(deferredLightingShader);
 
     // directional light
-    objectShader.setVec3("dirLight.ambient", 0.1f, 0.1f, 0.1f);
-    objectShader.setVec3("dirLight.diffuse", 0.3f, 0.3f, 0.3f);
-    objectShader.setVec3("dirLight.specular", 1.0f, 1.0f, 1.0f);
-    objectShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-
-    // point lights
-    objectShader.setFloat("pointLights[0].constant", 1.0f);
-    objectShader.setFloat("pointLights[0].linear", 0.022f);
-    objectShader.setFloat("pointLights[0].quadratic", 0.0019f);
-    objectShader.setVec3("pointLights[0].ambient", lightColors[0] * 0.1f);
-    objectShader.setVec3("pointLights[0].diffuse", lightColors[0]);
-    objectShader.setVec3("pointLights[0].specular", lightColors[0]);
-
-    objectShader.setFloat("pointLights[1].constant", 1.0f);
-    objectShader.setFloat("pointLights[1].linear", 0.022f);
-    objectShader.setFloat("pointLights[1].quadratic", 0.0019f);
-    objectShader.setVec3("pointLights[1].ambient", lightColors[1] * 0.1f);
-    objectShader.setVec3("pointLights[1].diffuse", lightColors[1]);
-    objectShader.setVec3("pointLights[1].specular", lightColors[1]);
-
-    // spot light
-    objectShader.setFloat("spotLight.constant", 1.0f);
-    objectShader.setFloat("spotLight.linear", 0.022f);
-    objectShader.setFloat("spotLight.quadratic", 0.0019f);
-    objectShader.setVec3("spotLight.ambient", 0.2f, 0.2f, 0.2f);
-    objectShader.setVec3("spotLight.diffuse", 0.5f, 0.5f, 0.5f);
-    objectShader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-    objectShader.setFloat("spotLight.innerCutOff", glm::cos(glm::radians(12.5f)));
-    objectShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(17.5f)));
+    LightManager::DirectionalLight sun;
+    sun.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+    sun.ambient = glm::vec3(0.1f);
+    sun.diffuse = glm::vec3(0.3f);
+    sun.specular = glm::vec3(1.0f);
+    lightManager.add(sun);
+
+    // the sun's shadows. the floor and the cubes never move, their depth is cached per cascade and only redrawn when
+    // a cascade moves; the backpack and the light cubes are drawn into the shadow maps every frame
+    const float shadowDistance = 60.0f;
+    CascadedShadows cascadedShadows(nearDepth, shadowDistance);
+    std::vector<SceneObject*> staticCasters{ &floor, &cube1, &cube2 };
+    for (auto& cube : cubes) {
+        staticCasters.push_back(&cube);
+    }
+    cascadedShadows.setStaticCasters(staticCasters);
+    cascadedShadows.setDynamicCasters({ &backpack, &light1, &light2 });
+
+    // the orbiting point lights, moved every frame. extra ones are added and removed as the GUI asks
+    std::vector<LightManager::Handle> orbitLightHandles, extraLightHandles;
+    for (const glm::vec3& color : lightColors) {
+        LightManager::PointLight light;
+        light.constant = 1.0f;
+        light.linear = 0.022f;
+        light.quadratic = 0.0019f;
+        light.ambient = color * 0.1f;
+        light.diffuse = color;
+        light.specular = color;
+        light.radius = Clusters::lightRadius(light);
+        orbitLightHandles.push_back(lightManager.add(light));
+    }
+
+    // spot light, the flash light follows the camera while it's on
+    LightManager::SpotLight flashLight;
+    flashLight.constant = 1.0f;
+    flashLight.linear = 0.022f;
+    flashLight.quadratic = 0.0019f;
+    flashLight.ambient = glm::vec3(0.2f);
+    flashLight.diffuse = glm::vec3(0.5f);
+    flashLight.specular = glm::vec3(1.0f);
+    flashLight.innerCutOff = glm::cos(glm::radians(12.5f));
+    flashLight.outerCutOff = glm::cos(glm::radians(17.5f));
+    LightManager::Handle flashLightHandle = LightManager::NONE;
 
 
     // ++++++++++++++++++++++++++++++++++++++++++++++++++ MAIN RENDER LOOP +++++++++++++++++++++++++++++++++++++++++++++++++++++++    
@@ -488,103 +657,503 @@ int main() {
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        // minimized, nothing to draw into
+        if (screenWidth == 0 || screenHeight == 0) {
+            glfwWaitEvents();
+            continue;
+        }
+
+        // resized: only what depends on the screen size is reallocated
+        if (renderGraph.getScreenSize() != glm::ivec2(screenWidth, screenHeight)) {
+            renderGraph.setScreenSize(screenWidth, screenHeight);
+            dynamicResolution.resize(screenWidth, screenHeight);
+            hiZ.resize(screenWidth, screenHeight);
+        }
+
+        profiler.beginFrame();
+        jobs.beginFrame();
+
         // input
         processInput(window);
 
         GUI::setUpGUI(guiSettings);
 
         //update positions
+        profiler.begin("Update");
         orbitLights(light1, light2);
-
-        //sort transparent (partially or requiring blending) objects in descending dist from camera
-        std::sort(transparentObjects.begin(), transparentObjects.end(), [](const SceneObject& obj1, const SceneObject& obj2) {
-            return glm::length2(camera.position - obj1.position) > glm::length2(camera.position - obj2.position);
+        transforms.update(jobs);
+
+        //calculate matrices, everything below uses this snapshot of the camera
+        CameraFrame frame = camera.getFrame(float(screenWidth) / float(screenHeight), nearDepth, farDepth);
+
+        // frustum culling, bounds are recomputed every frame since objects move freely
+        bool flatCulling = guiSettings.cullingMode == GUI::GUISettings::CULLING_FLAT;
+        if (flatCulling)
+            cullingBoxes.resize(cullableObjects.size());
+        jobs.parallelFor(cullableObjects.size(), 256, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                worldBounds[i] = cullableObjects[i]->getWorldBounds();
+                if (flatCulling)
+                    cullingBoxes.set(i, worldBounds[i]);
+            }
         });
+        sceneBVH.refit(worldBounds);
+
+        size_t visibleCount = cullableObjects.size();
+        if (flatCulling) {
+            visibleCount = Culling::cullBoxes(frame.frustum, cullingBoxes, cullingVisibility, jobs);
+            for (size_t i = 0; i < cullableObjects.size(); i++) {
+                cullableObjects[i]->culled = !cullingVisibility[i];
+            }
+        }
+        else if (guiSettings.cullingMode == GUI::GUISettings::CULLING_BVH || guiSettings.cullingMode == GUI::GUISettings::CULLING_GPU) {
+            visibleObjects.clear();
+            sceneBVH.queryFrustum(frame.frustum, visibleObjects);
+            visibleCount = visibleObjects.size();
+            for (SceneObject* obj : cullableObjects) {
+                obj->culled = true;
+            }
+            for (uint32_t index : visibleObjects) {
+                cullableObjects[index]->culled = false;
+            }
+        }
+        else {
+            for (SceneObject* obj : cullableObjects) {
+                obj->culled = false;
+            }
+        }
 
-        //calculate matrices
-        glm::mat4 view = camera.getViewMatrix();
-        glm::mat4 projection = glm::perspective(glm::radians(camera.zoom), float(WINDOW_WIDTH) / float(WINDOW_HEIGHT), 0.1f, 100.0f);
+        // GPU culling: everything but the cubes goes through the BVH, the cubes are culled and drawn without the CPU
+        // knowing which of them are visible. the counts shown are read back a few frames late. the BVH's frustum
+        // test of the cubes is still what picks their textures to stream, they're only marked culled after that.
+        // with occlusion culling the main phase tests against last frame's Hi-Z pyramid, the retest phase runs below
+        bool gpuCulling = guiSettings.cullingMode == GUI::GUISettings::CULLING_GPU;
+        bool occlusionCulling = gpuCulling && guiSettings.occlusionCulling;
+        if (gpuCulling) {
+            for (auto& cube : cubes) {
+                visibleCount -= cube.culled ? 0 : 1;
+            }
+            cubeCulling.cull(cullInstancesShader, GPUCulling::MAIN, frame.frustum, frame.viewProjection, occlusionCulling ? &hiZ : nullptr);
+
+            GPUCulling::Counts counts = cubeCulling.visibleCounts();
+            guiSettings.gpuVisibleInstances = int(counts.drawnMain + counts.drawnRetest);
+            guiSettings.gpuOccludedInstances = int(counts.occluded - counts.drawnRetest);
+            guiSettings.gpuRetestedInstances = int(counts.drawnRetest);
+            visibleCount += guiSettings.gpuVisibleInstances;
+        }
+        guiSettings.visibleObjects = int(visibleCount);
+        guiSettings.culledObjects = int(cullableObjects.size() - visibleCount);
+        profiler.end();
+
+        // ray picking, through the cursor when it's visible and through the screen center otherwise
+        if (pickRequested) {
+            pickRequested = false;
+
+            // the cursor is in window coordinates, which differ from the framebuffer's on high DPI screens
+            int windowWidth, windowHeight;
+            glfwGetWindowSize(window, &windowWidth, &windowHeight);
+            double cursorX = windowWidth * 0.5, cursorY = windowHeight * 0.5;
+            if (mouseGUIEnabled)
+                glfwGetCursorPos(window, &cursorX, &cursorY);
+            glm::vec2 ndc(2.0f * float(cursorX) / windowWidth - 1.0f, 1.0f - 2.0f * float(cursorY) / windowHeight);
+
+            glm::vec4 nearPoint = frame.inverseViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+            glm::vec4 farPoint = frame.inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+            glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+            glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+            guiSettings.pickedObject = sceneBVH.raycast(origin, direction, guiSettings.pickedDistance);
+        }
+
+        // stream in the texture detail the visible objects need
+        profiler.begin("Streaming");
+        float pixelsPerUnit = screenHeight * 0.5f * frame.projection[1][1];
+        for (SceneObject* obj : { &backpack, &floor, &cube1, &cube2 }) {
+            if (!obj->culled)
+                obj->requestTextureDetail(textureStreamer, frame.position, pixelsPerUnit);
+        }
+        for (auto& cube : cubes) {
+            if (!cube.culled)
+                cube.requestTextureDetail(textureStreamer, frame.position, pixelsPerUnit);
+            // drawn by the GPU, nothing below should see them as visible
+            if (gpuCulling)
+                cube.culled = true;
+        }
+        textureStreamer.update();
+        materialTable.refresh();
+        profiler.end();
+
+        // queue the visible draws. opaque ones are grouped by program, material and vertex array, front to back inside
+        // a group, transparent ones (partially or requiring blending) go from farthest to nearest
+        profiler.begin("Draw lists");
+        renderQueue.begin(frame, farDepth);
+        for (SceneObject* obj : { &floor, &cube1, &cube2 }) {
+            if (!obj->culled)
+                renderQueue.submit(RenderQueue::PASS_OPAQUE, simpleShader, *obj);
+        }
+        // the lit geometry, shaded as it's drawn or written to the G-buffer and shaded once per pixel after
+        bool deferred = guiSettings.deferredShading;
+        if (!backpack.culled) {
+            if (deferred)
+                renderQueue.submit(RenderQueue::PASS_GBUFFER, gbufferShader, backpack);
+            else
+                renderQueue.submit(RenderQueue::PASS_OPAQUE, objectShader, backpack);
+        }
+        if (!gpuCulling)
+            renderQueue.submitAll(RenderQueue::PASS_OPAQUE, depthShader, cubes, jobs);
+        for (SceneObject* light : { &light1, &light2 }) {
+            if (!light->culled)
+                renderQueue.submit(RenderQueue::PASS_OPAQUE, lightShader, *light);
+        }
+        bool oit = guiSettings.transparencyMode == GUI::GUISettings::TRANSPARENCY_OIT;
+        for (auto* objects : { &vegetation, &transparentObjects }) {
+            for (auto& obj : *objects) {
+                if (obj.culled)
+                    continue;
+                if (oit)
+                    renderQueue.submit(RenderQueue::PASS_OIT, oitAccumulateShader, obj);
+                else
+                    renderQueue.submit(RenderQueue::PASS_TRANSPARENT, simpleShader, obj);
+            }
+        }
+        renderQueue.sort(guiSettings.sortDraws, &jobs);
+        // the draws become command lists on the workers now, the passes below only replay them
+        renderQueue.record(frame, &jobs);
+        profiler.end();
 
         //update view and projection matrices for all shaders
         for (auto shader : shaders) {
             shader->use();
 
-            shader->setMat4("view", view);
-            shader->setMat4("projection", projection);
+            shader->setMat4("view", frame.view);
+            shader->setMat4("projection", frame.projection);
         }
 
-        // object shader specific uniforms
-        objectShader.use();
-        objectShader.setBool("enableFlashLight", enableFlashLight);
-        objectShader.setVec3("spotLight.position", camera.position);
-        objectShader.setVec3("spotLight.direction", camera.front);
-        objectShader.setVec3("pointLights[0].position", light1.position);
-        objectShader.setVec3("pointLights[1].position", light2.position);
+        // lighting uniforms
+        cascadedShadows.update(frame, sun.direction);
+        for (Shader* litShader : { &objectShader, &deferredLightingShader }) {
+            litShader->use();
+            litShader->setMat4("view", frame.view);
+            cascadedShadows.setUniforms(*litShader, frame, guiSettings.shadows);
+        }
 
-        // post processing 
-        frameBufferShader.use();
-        frameBufferShader.setFloat("offset", 1.0f / guiSettings.convMatrixOffset);
-        frameBufferShader.setInt("postProcessingMode", guiSettings.postProcessingMode);
+        // only what changed is uploaded: the orbiting lights, the flash light and lights added or removed
+        profiler.begin("Lights");
+        while (int(extraLightHandles.size()) < guiSettings.extraPointLights) {
+            extraLightHandles.push_back(lightManager.add(randomPointLight()));
+        }
+        while (int(extraLightHandles.size()) > guiSettings.extraPointLights) {
+            lightManager.remove(extraLightHandles.back());
+            extraLightHandles.pop_back();
+        }
+        for (size_t i = 0; i < orbitLightHandles.size(); i++) {
+            LightManager::PointLight light = lightManager.getPointLight(orbitLightHandles[i]);
+            light.position = (i == 0 ? light1 : light2).getPosition();
+            lightManager.set(orbitLightHandles[i], light);
+        }
+        if (enableFlashLight) {
+            flashLight.position = frame.position;
+            flashLight.direction = frame.front;
+            if (flashLightHandle == LightManager::NONE)
+                flashLightHandle = lightManager.add(flashLight);
+            else
+                lightManager.set(flashLightHandle, flashLight);
+        }
+        else if (flashLightHandle != LightManager::NONE) {
+            lightManager.remove(flashLightHandle);
+            flashLightHandle = LightManager::NONE;
+        }
+        lightManager.upload();
+        profiler.end();
+        guiSettings.pointLights = int(lightManager.getPointLights().size());
+        guiSettings.lightUploads = lightManager.getStats().uploads;
+        guiSettings.lightUploadKB = float(lightManager.getStats().bytes) / 1024.0f;
+        ClusteredLighting::Counts clusterCounts = clusteredLighting.listCounts();
+        guiSettings.clusterListedLights = int(clusterCounts.listed);
+        guiSettings.clusterOverflows = int(clusterCounts.overflowed);
+
+        // post processing, the kernels' taps are 1 / offset of the screen apart
+        if (postProcessingMode != guiSettings.postProcessingMode) {
+            postProcessingMode = guiSettings.postProcessingMode;
+            buildPostProcessStack(postProcessStack, postProcessingMode);
+        }
 
-        skybox.setTexture(skyboxes[guiSettings.skyboxTextureIndex]);
+        // dynamic resolution, the scale for this frame is picked from the finished frames' GPU times
+        dynamicResolution.setBudget(guiSettings.frameBudgetMS);
+        dynamicResolution.setScaleRange(guiSettings.minRenderScale, 1.0f);
+        dynamicResolution.setEnabled(guiSettings.dynamicResolution);
+        if (!guiSettings.dynamicResolution)
+            dynamicResolution.setScale(guiSettings.renderScale);
+        dynamicResolution.update();
+        const glm::ivec2 renderSize = dynamicResolution.getRenderSize();
+        guiSettings.renderScale = dynamicResolution.getScale();
+        guiSettings.renderWidth = renderSize.x;
+        guiSettings.renderHeight = renderSize.y;
+        guiSettings.gpuFrameMS = dynamicResolution.getGPUMilliseconds();
+
+        float tapOffset = 1.0f / guiSettings.convMatrixOffset;
+        postProcessStack.setSpacing(glm::ivec2(glm::round(glm::vec2(renderSize) * tapOffset)));
+
+        int skyboxIndex = guiSettings.skyboxTextureIndex;
+        if (skyboxes[skyboxIndex] == 0)
+            loadSkybox(skyboxIndex);
+        GPUMemory::markUsed(GL_TEXTURE, skyboxes[skyboxIndex]);
+        skybox.setTexture(skyboxes[skyboxIndex]);
 
         // --------------------------------------------- rendering --------------------------------------------------
 
-        //before rendering bind to the framebuffer
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-        glEnable(GL_DEPTH_TEST);
-
-        //clear screen
-        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-
-        //render SceneObjects
-        skybox.draw(skyboxShader, camera);
-
-        floor.draw(simpleShader, camera);
-
-        cube1.draw(simpleShader, camera);
-        cube2.draw(simpleShader, camera);
-
-        backpack.draw(objectShader, camera);
+        // the frame's passes and what they use, the graph culls, allocates and orders the barriers from this
+        struct {
+            RenderGraph::Resource sceneColor = -1, sceneDepth = -1;
+            RenderGraph::Resource accumulation = -1, revealage = -1;
+            RenderGraph::Resource albedoSpecular = -1, normals = -1;
+            std::vector<RenderGraph::Resource> postProcessed;
+        } targets;
+        renderGraph.reset();
+
+        // the cluster light lists the lit shaders read, they only depend on the camera and the lights (kept in
+        // buffers outside of the graph, so it can't see who reads them)
+        renderGraph.addPass("Light assignment", [&](RenderGraph::PassBuilder& builder) {
+            builder.sideEffect();
+        }, [&](const RenderGraph::PassContext&) {
+            clusteredLighting.assign(assignLightsShader, frame);
+            if (guiSettings.checkClusters) {
+                guiSettings.checkClusters = false;
+                guiSettings.clusterMismatches = clusteredLighting.verify(frame, lightManager.getPointLights());
+            }
+        });
 
-        for (auto cube : cubes) {
-            cube.draw(depthShader, camera);
+        // the sun's shadow maps, outside of the graph like the light buffers. most frames only copy the static
+        // casters' cached depth and draw the dynamic ones over it
+        if (guiSettings.shadows) {
+            renderGraph.addPass("Shadow maps", [&](RenderGraph::PassBuilder& builder) {
+                builder.sideEffect();
+            }, [&](const RenderGraph::PassContext&) {
+                cascadedShadows.render(shadowDepthShader);
+            });
         }
 
-        lightShader.use();
-        lightShader.setVec3("lightColor", lightColors[0]);
-        light1.draw(lightShader, camera);
+        // RGBA8 like the post processing images, so they can share textures
+        const RenderGraph::TextureDesc sceneColorDesc = { GL_RGBA8 };
+        const RenderGraph::TextureDesc sceneDepthDesc = { GL_DEPTH24_STENCIL8 };
+        if (deferred) {
+            // the lit geometry's surfaces, then its lighting into a fresh scene color. the scene pass adds the rest
+            // on top, depth tested against the G-buffer's depth
+            renderGraph.addPass("G-buffer", [&](RenderGraph::PassBuilder& builder) {
+                targets.albedoSpecular = builder.create("g-buffer albedo specular", { DeferredShading::ALBEDO_SPECULAR_FORMAT });
+                targets.normals = builder.create("g-buffer normals", { DeferredShading::NORMAL_FORMAT });
+                targets.sceneDepth = builder.create("scene depth stencil", sceneDepthDesc);
+            }, [&](const RenderGraph::PassContext& context) {
+                glViewport(0, 0, renderSize.x, renderSize.y);
+                glEnable(GL_DEPTH_TEST);
+                glDisable(GL_BLEND);
+                deferredShading.begin(context.framebuffer);
+                renderQueue.execute(RenderQueue::PASS_GBUFFER);
+                glEnable(GL_BLEND);
+            });
+
+            renderGraph.addPass("Deferred lighting", [&](RenderGraph::PassBuilder& builder) {
+                targets.sceneColor = builder.create("scene color", sceneColorDesc);
+                builder.read(targets.albedoSpecular);
+                builder.read(targets.normals);
+                builder.read(targets.sceneDepth);
+            }, [&](const RenderGraph::PassContext& context) {
+                glViewport(0, 0, renderSize.x, renderSize.y);
+                glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+                deferredShading.light(deferredLightingShader, context.texture(targets.albedoSpecular), context.texture(targets.normals),
+                    context.texture(targets.sceneDepth), frame, renderSize);
+            });
+        }
 
-        lightShader.setVec3("lightColor", lightColors[1]);
-        light2.draw(lightShader, camera);
+        renderGraph.addPass("Scene", [&](RenderGraph::PassBuilder& builder) {
+            if (deferred) {
+                builder.read(targets.sceneColor, RenderGraph::ATTACHMENT);
+                builder.write(targets.sceneColor);
+                builder.read(targets.sceneDepth, RenderGraph::ATTACHMENT);
+                builder.write(targets.sceneDepth);
+            }
+            else {
+                targets.sceneColor = builder.create("scene color", sceneColorDesc);
+                targets.sceneDepth = builder.create("scene depth stencil", sceneDepthDesc);
+            }
+        }, [&](const RenderGraph::PassContext& context) {
+            glViewport(0, 0, renderSize.x, renderSize.y);
+            glEnable(GL_DEPTH_TEST);
+
+            //clear screen (all of it, the Hi-Z pyramid relies on the unrendered part holding the far plane)
+            if (!deferred) {
+                glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            }
+
+            //render SceneObjects. with the G-buffer's depth in place only the skybox drawn behind the scene is correct
+            if (!guiSettings.skyboxLast && !deferred) {
+                Profiler::ScopedTimer timer(&profiler, "Skybox");
+                skyboxFragments.begin();
+                skybox.draw(skyboxShader, frame);
+                skyboxFragments.end();
+            }
+
+            // depth only first, the color pass then passes the depth test (GL_LEQUAL) once per pixel and the expensive
+            // fragment shaders only run for visible surfaces
+            if (guiSettings.depthPrepass) {
+                Profiler::ScopedTimer timer(&profiler, "Depth pre-pass");
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                renderQueue.executeDepthOnly(RenderQueue::PASS_OPAQUE, depthPrepassShader);
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                glDepthFunc(GL_LEQUAL);
+            }
+            profiler.begin("Opaque");
+            opaqueFragments.begin();
+            renderQueue.execute(RenderQueue::PASS_OPAQUE);
+            opaqueFragments.end();
+            glDepthFunc(GL_LESS);
+
+            if (gpuCulling) {
+                cubeCulling.draw(depthIndirectShader, GPUCulling::MAIN);
+
+                // everything opaque that occludes is drawn now: rebuild the pyramid from this frame's depth, then give
+                // the cubes the main phase rejected a second chance against it (the pyramid is reused next frame)
+                if (occlusionCulling) {
+                    hiZ.build(hiZDownsampleShader, context.texture(targets.sceneDepth), renderSize);
+                    cubeCulling.cull(cullInstancesShader, GPUCulling::RETEST, frame.frustum, frame.viewProjection, &hiZ);
+                    cubeCulling.draw(depthIndirectShader, GPUCulling::RETEST);
+                }
+            }
+            profiler.end();
+
+            // all opaque geometry is in the depth buffer, the skybox only fills what's left
+            if (guiSettings.skyboxLast || deferred) {
+                Profiler::ScopedTimer timer(&profiler, "Skybox");
+                skyboxFragments.begin();
+                skybox.drawBehindScene(skyboxTriangleShader, frame);
+                skyboxFragments.end();
+            }
+        });
 
-        //render transparent objects from farthest to nearest distance from Camera
-        for (auto& grass : vegetation) {
-            grass.draw(simpleShader, camera);
+        if (oit) {
+            renderGraph.addPass("OIT accumulate", [&](RenderGraph::PassBuilder& builder) {
+                targets.accumulation = builder.create("oit accumulation", { WeightedOIT::ACCUMULATION_FORMAT });
+                targets.revealage = builder.create("oit revealage", { WeightedOIT::REVEALAGE_FORMAT });
+                builder.read(targets.sceneDepth, RenderGraph::ATTACHMENT);
+            }, [&](const RenderGraph::PassContext& context) {
+                weightedOIT.begin(context.framebuffer);
+                renderQueue.execute(RenderQueue::PASS_OIT);
+                weightedOIT.end();
+            });
+
+            renderGraph.addPass("OIT composite", [&](RenderGraph::PassBuilder& builder) {
+                builder.read(targets.accumulation);
+                builder.read(targets.revealage);
+                builder.read(targets.sceneColor, RenderGraph::ATTACHMENT);
+                builder.write(targets.sceneColor);
+            }, [&](const RenderGraph::PassContext& context) {
+                weightedOIT.composite(oitCompositeShader, context.texture(targets.accumulation), context.texture(targets.revealage));
+            });
+        }
+        else {
+            renderGraph.addPass("Transparent", [&](RenderGraph::PassBuilder& builder) {
+                builder.read(targets.sceneColor, RenderGraph::ATTACHMENT);
+                builder.write(targets.sceneColor);
+                builder.read(targets.sceneDepth, RenderGraph::ATTACHMENT);
+            }, [&](const RenderGraph::PassContext&) {
+                renderQueue.execute(RenderQueue::PASS_TRANSPARENT);
+            });
         }
 
-        for (auto& obj : transparentObjects) {
-            obj.draw(simpleShader, camera);
+        // every post processing pass reads the previous one's image and writes its own, the graph lets the later ones
+        // reuse the textures of those already consumed
+        targets.postProcessed.push_back(targets.sceneColor);
+        for (size_t i = 0; i < postProcessStack.getPassCount(); i++) {
+            renderGraph.addPass(postProcessStack.getPassName(i), [&](RenderGraph::PassBuilder& builder) {
+                builder.read(targets.postProcessed.back());
+                targets.postProcessed.push_back(builder.create("post process " + std::to_string(i), { GL_RGBA8 }, RenderGraph::IMAGE));
+            }, [&, i](const RenderGraph::PassContext& context) {
+                postProcessStack.execute(i, postProcessShader, context.texture(targets.postProcessed[i]), context.texture(targets.postProcessed[i + 1]), renderSize);
+            });
         }
 
-        // now bind back to default framebuffer and draw a quad plane with the attached framebuffer color texture
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
-        // clear all relevant buffers
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // set clear color to white (not really necessary actually, since we won't be able to see behind the quad anyways)
-        glClear(GL_COLOR_BUFFER_BIT);
+        // draw the post processed image over the whole screen, upscaling and sharpening when rendered below full
+        // resolution
+        renderGraph.addPass("Present", [&](RenderGraph::PassBuilder& builder) {
+            builder.read(targets.postProcessed.back());
+            builder.sideEffect();
+        }, [&](const RenderGraph::PassContext& context) {
+            glViewport(0, 0, screenWidth, screenHeight);
+            glDisable(GL_DEPTH_TEST); // disable depth test so the screen triangle isn't discarded due to depth test.
+            // clear all relevant buffers
+            glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // set clear color to white (not really necessary actually, since we won't be able to see behind the triangle anyways)
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            bool upscaled = renderSize != renderGraph.getScreenSize();
+            glm::vec2 uvScale = glm::vec2(renderSize) / glm::vec2(context.size(targets.postProcessed.back()));
+            postProcessStack.present(frameBufferShader, context.texture(targets.postProcessed.back()), uvScale, upscaled ? guiSettings.upscaleSharpness : 0.0f);
+        });
+
+        renderGraph.compile();
+        dynamicResolution.begin();
+        renderGraph.execute(&profiler);
+        dynamicResolution.end();
+
+        const float screenPixels = float(renderSize.x) * float(renderSize.y);
+        guiSettings.opaqueFragmentsPerPixel = float(opaqueFragments.latest()) / screenPixels;
+        guiSettings.skyboxFragmentsPerPixel = float(skyboxFragments.latest()) / screenPixels;
+
+        const RenderQueue::Stats& queueStats = renderQueue.getStats();
+        guiSettings.queueDraws = queueStats.draws;
+        guiSettings.queueStateChanges = queueStats.programChanges + queueStats.materialChanges + queueStats.vaoChanges;
+        guiSettings.queueProgramChanges = queueStats.programChanges;
+        guiSettings.queueMaterialChanges = queueStats.materialChanges;
+        guiSettings.queueVAOChanges = queueStats.vaoChanges;
+        guiSettings.queueUnsortedChanges = queueStats.unsortedChanges;
+        guiSettings.queueTransparentCoherent = queueStats.transparentCoherent;
+        guiSettings.queueCommandLists = queueStats.commandLists;
+        guiSettings.queuePackets = queueStats.packets;
+
+        guiSettings.postProcessTimings.clear();
+        for (auto& timing : postProcessStack.getTimings()) {
+            guiSettings.postProcessTimings.push_back({ timing.name, timing.milliseconds });
+        }
 
-        // draw screen quad (postprocessing)
-        frameBufferQuad.draw(frameBufferShader, camera);
+        const CascadedShadows::Stats& shadowStats = cascadedShadows.getStats();
+        guiSettings.shadowCacheRenders = shadowStats.staticRenders;
+        guiSettings.shadowCacheRendersTotal = shadowStats.totalStaticRenders;
+        guiSettings.shadowStaticDraws = shadowStats.staticDraws;
+        guiSettings.shadowDynamicDraws = shadowStats.dynamicDraws;
+        guiSettings.shadowCopies = shadowStats.copies;
+
+        const RenderGraph::Stats& graphStats = renderGraph.getStats();
+        guiSettings.graphPasses = renderGraph.getPassNames();
+        guiSettings.graphCulledPasses = graphStats.culledPasses;
+        guiSettings.graphResources = graphStats.resources;
+        guiSettings.graphTextures = graphStats.textures;
+        guiSettings.graphPooledTextures = graphStats.pooledTextures;
+        guiSettings.graphPooledMB = float(graphStats.pooledBytes) / (1024.0f * 1024.0f);
+        guiSettings.graphBarriers = graphStats.barriers;
 
         // Then render ImGui 
+        profiler.begin("ImGui");
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        profiler.end();
 
         // check for/call events and then swap buffers
         glfwPollEvents();
+        profiler.begin("Swap");
         glfwSwapBuffers(window);
+        profiler.end();
+
+        jobs.endFrame();
+        profiler.endFrame();
+        guiSettings.workerUtilization.clear();
+        for (auto& worker : jobs.getStats()) {
+            guiSettings.workerUtilization.push_back({ worker.utilization, int(worker.jobs), int(worker.steals) });
+        }
+
+        // free least recently used evictable resources if over budget
+        GPUMemory::setBudget(size_t(guiSettings.memoryBudgetMB) * 1024 * 1024);
+        GPUMemory::endFrame();
     }
 
     GUI::shutDownGUI();
@@ -626,10 +1195,19 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
     }
 }
 
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && !ImGui::GetIO().WantCaptureMouse) {
+        pickRequested = true;
+    }
+}
+
 // callback function when window is resized
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    // the render graph picks the new size up at the start of the next frame
+    screenWidth = width;
+    screenHeight = height;
 }
 
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn) {
@@ -675,14 +1253,62 @@ void orbitLights(SceneObject& light1, SceneObject& light2) {
     basePos.y = 0.0f;
     basePos.z = cos(glfwGetTime() * 2) * lightOrbitRadius;
     glm::mat4 tilt = glm::rotate(glm::mat4(1.0f), glm::radians(30.0f), glm::normalize(glm::vec3(0.0f, 0.0f, 1.0f)));
-    light1.position = glm::vec3(tilt * glm::vec4(basePos, 1.0f)) + glm::vec3(0.0f, 8.0f, 0.0f);
+    light1.setPosition(glm::vec3(tilt * glm::vec4(basePos, 1.0f)) + glm::vec3(0.0f, 8.0f, 0.0f));
 
     basePos.x = sin((glfwGetTime() + 2.14) * 2) * lightOrbitRadius;
     basePos.y = 0.0f;
     basePos.z = cos((glfwGetTime() + 2.14) * 2) * lightOrbitRadius;
     tilt = glm::rotate(glm::mat4(1.0f), glm::radians(30.0f), glm::normalize(glm::vec3(0.0f, 0.0f, -1.0f)));
-    light2.position = glm::vec3(tilt * glm::vec4(basePos, 1.0f)) + glm::vec3(0.0f, 8.0f, 0.0f);
+    light2.setPosition(glm::vec3(tilt * glm::vec4(basePos, 1.0f)) + glm::vec3(0.0f, 8.0f, 0.0f));
 }
 
 
+// the passes for each of the GUI's post processing modes
+void buildPostProcessStack(PostProcessStack& stack, int mode) {
+    stack.clear();
+    switch (mode) {
+    case 1: stack.addColor("Inverse", PostProcessStack::COLOR_INVERSE); break;
+    case 2: stack.addColor("Grey scale", PostProcessStack::COLOR_GREY); break;
+    case 3: stack.addColor("Weighted grey scale", PostProcessStack::COLOR_GREY_WEIGHTED); break;
+    case 4:
+        stack.addKernel("Sharpen", 3, {
+            -2, -1, -2,
+            -1, 13, -1,
+            -2, -1, -2 });
+        break;
+    case 5:
+        stack.addKernel("Emboss", 3, {
+            -2, -1, 0,
+            -1,  1, 1,
+             0,  1, 2 });
+        break;
+    case 6:
+        // the 3x3 box blur is separable: two passes of 3 taps instead of one of 9
+        stack.addSeparable("Box blur", { 1.0f / 3.0f, 1.0f / 3.0f, 1.0f / 3.0f }, { 1.0f / 3.0f, 1.0f / 3.0f, 1.0f / 3.0f });
+        break;
+    case 7:
+        // not separable, the 5x5 tile path
+        stack.addKernel("Edge detect", 5, {
+            0,  0, -1,  0, 0,
+            0, -1, -2, -1, 0,
+           -1, -2, 16, -2, -1,
+            0, -1, -2, -1, 0,
+            0,  0, -1,  0, 0 });
+        break;
+    default: break;
+    }
+}
 
+
+// a short ranged light somewhere around the backpack
+LightManager::PointLight randomPointLight() {
+    LightManager::PointLight light;
+    light.position = glm::vec3(Utils::randomFloat(-12.0f, 12.0f), Utils::randomFloat(0.0f, 16.0f), Utils::randomFloat(-12.0f, 12.0f));
+    light.constant = 1.0f;
+    light.linear = 0.7f;
+    light.quadratic = 1.8f;
+    light.diffuse = glm::vec3(Utils::randomFloat(0.2f, 1.0f), Utils::randomFloat(0.2f, 1.0f), Utils::randomFloat(0.2f, 1.0f));
+    light.specular = light.diffuse;
+    light.radius = Clusters::lightRadius(light);
+    return light;
+}